@@ -0,0 +1,122 @@
+#include <pthread.h>
+#include <time.h>
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "dberror.h"
+#include "test_helper.h"
+
+// Pin/unpin throughput of one buffer pool shared by 1 to 32 threads. The pages touched fill half
+// of the frames, so every shard keeps its pages resident and the benchmark measures the latching
+// of the pool, not I/O. Build with -DBM_MAX_SHARDS=1
+// to compare with a pool that is not partitioned.
+
+#define NUM_FRAMES 4096
+#define NUM_PAGES (NUM_FRAMES / 2)
+#define NUM_PAIRS 4000000 // pin/unpin pairs per run, split evenly over the threads
+#define MAX_THREADS 32
+
+// var to store the current test's name
+char *testName;
+
+// arguments of a benchmark thread
+typedef struct BenchWorker {
+	BM_BufferPool *bm;
+	unsigned int seed;
+	int numPairs;
+	int errors;
+} BenchWorker;
+
+static void *pinUnpinWorker (void *arg);
+static double runThreads (BM_BufferPool *bm, int numThreads, int *errors);
+static double now (void);
+
+// main method
+int
+main (void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle h;
+	double base = 0;
+	int i, numThreads, errors = 0;
+	testName = "pin/unpin benchmark";
+
+	initStorageManager();
+	TEST_CHECK(createPageFile("benchbuffer.bin"));
+	TEST_CHECK(initBufferPool(bm, "benchbuffer.bin", NUM_FRAMES, RS_CLOCK, NULL));
+
+	// load every page once, the runs only hit resident pages
+	for (i = 0; i < NUM_PAGES; i++)
+	{
+		TEST_CHECK(pinPage(bm, &h, i));
+		TEST_CHECK(unpinPage(bm, &h));
+	}
+
+	printf("%d frames, %d pages, %d shards, %d pin/unpin pairs per run\n", NUM_FRAMES, NUM_PAGES,
+			((BM_MGMT_DATA *) bm->mgmtData)->numShards, NUM_PAIRS);
+	printf("threads  Mpairs/s  speedup\n");
+	for (numThreads = 1; numThreads <= MAX_THREADS; numThreads *= 2)
+	{
+		double rate = runThreads(bm, numThreads, &errors) / 1e6;
+		if (numThreads == 1)
+			base = rate;
+		printf("%7d  %8.2f  %7.2f\n", numThreads, rate, rate / base);
+	}
+	ASSERT_EQUALS_INT(0, errors, "no failed pins or unpins");
+	ASSERT_EQUALS_INT(0, getNumReadIO(bm) - NUM_PAGES, "runs only hit resident pages");
+
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(destroyPageFile("benchbuffer.bin"));
+	free(bm);
+	return 0;
+}
+
+// Run the threads, add their failed calls to *errors, and return the number of pin/unpin pairs per second
+double
+runThreads (BM_BufferPool *bm, int numThreads, int *errors)
+{
+	pthread_t threads[MAX_THREADS];
+	BenchWorker workers[MAX_THREADS];
+	double start;
+	int t;
+
+	start = now();
+	for (t = 0; t < numThreads; t++)
+	{
+		workers[t].bm = bm;
+		workers[t].seed = t + 1;
+		workers[t].numPairs = NUM_PAIRS / numThreads;
+		workers[t].errors = 0;
+		pthread_create(&threads[t], NULL, pinUnpinWorker, &workers[t]);
+	}
+	for (t = 0; t < numThreads; t++)
+	{
+		pthread_join(threads[t], NULL);
+		*errors += workers[t].errors;
+	}
+
+	return NUM_PAIRS / numThreads * numThreads / (now() - start);
+}
+
+// Pin and unpin random pages
+void *
+pinUnpinWorker (void *arg)
+{
+	BenchWorker *w = (BenchWorker *) arg;
+	BM_PageHandle h;
+	int i;
+
+	for (i = 0; i < w->numPairs; i++)
+	{
+		if (pinPage(w->bm, &h, rand_r(&w->seed) % NUM_PAGES) != RC_OK || unpinPage(w->bm, &h) != RC_OK)
+			w->errors++;
+	}
+	return NULL;
+}
+
+double
+now (void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
@@ -0,0 +1,803 @@
+#include <stdlib.h>
+#include <string.h>
+#include "dberror.h"
+#include "tables.h"
+#include "record_mgr.h"
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "btree_mgr.h"
+
+#define BT_MAGIC 0x42547265 // marks the header page of an index
+
+// Header page of an index
+typedef struct BT_Header
+{
+    int magic;
+    int n;           // maximum number of entries per node
+    int keySize;     // size of a key in bytes
+    PageNumber root; // root node, a leaf while the tree has a single node
+    int numNodes;
+    int numEntries;
+} BT_Header;
+
+// Layout of a node page:
+//   BT_NodeHeader | n + 1 entries (key followed by RID) | n + 2 child page numbers (inner nodes only)
+// A node holds up to n entries, the extra entry and child make room for an insert before the node splits.
+// Separator i of an inner node is not greater than any entry below child i + 1 and greater than every entry
+// below child i. Leaves are linked in key order.
+typedef struct BT_NodeHeader
+{
+    int isLeaf;
+    int numEntries;
+    PageNumber nextLeaf; // next leaf in key order, NO_PAGE for the last leaf and for inner nodes
+} BT_NodeHeader;
+
+#define NODE_HEADER(data) ((BT_NodeHeader *)(data))
+
+// Bookkeeping of an open index, stored in BTreeHandle.mgmtData
+typedef struct BT_TreeInfo
+{
+    BM_BufferPool *bm;
+    int *numPages; // number of pages in the page file, new nodes are appended
+    Schema *schema;
+    int n;
+    int keySize;
+    int entrySize; // key followed by its RID
+    PageNumber root;
+    int numNodes;
+    int numEntries;
+    char *entries; // room for the entry being inserted and the separator a split passes up
+} BT_TreeInfo;
+
+// Position of a scan, the next entry to return
+typedef struct BT_ScanInfo
+{
+    PageNumber leaf; // NO_PAGE after the last leaf
+    int pos;
+} BT_ScanInfo;
+
+// An entry searched for; without a RID the probe is smaller than every entry with its key
+typedef struct BT_Probe
+{
+    char *key;
+    RID *rid;
+} BT_Probe;
+
+// Largest n for which a node fits on a page
+static int maxEntriesPerNode(int entrySize)
+{
+    return (int)((PAGE_SIZE - sizeof(BT_NodeHeader) - sizeof(PageNumber)) / (entrySize + sizeof(PageNumber))) - 1;
+}
+
+// Minimum number of entries of a node other than the root
+static int minEntries(BT_TreeInfo *t)
+{
+    return t->n / 2;
+}
+
+static char *entryAt(BT_TreeInfo *t, char *data, int i)
+{
+    return data + sizeof(BT_NodeHeader) + i * t->entrySize;
+}
+
+static RID entryRid(BT_TreeInfo *t, char *entry)
+{
+    RID rid;
+    memcpy(&rid, entry + t->keySize, sizeof(RID));
+    return rid;
+}
+
+// The child page numbers follow the entries; they are not necessarily aligned
+static char *childAt(BT_TreeInfo *t, char *data, int i)
+{
+    return data + sizeof(BT_NodeHeader) + (t->n + 1) * t->entrySize + i * sizeof(PageNumber);
+}
+
+static PageNumber getChild(BT_TreeInfo *t, char *data, int i)
+{
+    PageNumber child;
+    memcpy(&child, childAt(t, data, i), sizeof(PageNumber));
+    return child;
+}
+
+static void setChild(BT_TreeInfo *t, char *data, int i, PageNumber child)
+{
+    memcpy(childAt(t, data, i), &child, sizeof(PageNumber));
+}
+
+// Insert an entry at a position of a node
+static void insertEntry(BT_TreeInfo *t, char *data, int pos, char *entry)
+{
+    BT_NodeHeader *header = NODE_HEADER(data);
+    memmove(entryAt(t, data, pos + 1), entryAt(t, data, pos), (header->numEntries - pos) * t->entrySize);
+    memcpy(entryAt(t, data, pos), entry, t->entrySize);
+    header->numEntries++;
+}
+
+static void removeEntry(BT_TreeInfo *t, char *data, int pos)
+{
+    BT_NodeHeader *header = NODE_HEADER(data);
+    memmove(entryAt(t, data, pos), entryAt(t, data, pos + 1), (header->numEntries - pos - 1) * t->entrySize);
+    header->numEntries--;
+}
+
+// Insert a child at a position of an inner node that has numChildren children
+static void insertChild(BT_TreeInfo *t, char *data, int pos, PageNumber child, int numChildren)
+{
+    memmove(childAt(t, data, pos + 1), childAt(t, data, pos), (numChildren - pos) * sizeof(PageNumber));
+    setChild(t, data, pos, child);
+}
+
+static void removeChild(BT_TreeInfo *t, char *data, int pos, int numChildren)
+{
+    memmove(childAt(t, data, pos), childAt(t, data, pos + 1), (numChildren - pos - 1) * sizeof(PageNumber));
+}
+
+// Compare a probe with an entry, by key and then by RID
+static int compareProbe(BT_TreeInfo *t, BT_Probe *probe, char *entry)
+{
+    int cmp = compareKeys(t->schema, probe->key, entry);
+    if (cmp != 0)
+    {
+        return cmp;
+    }
+    if (probe->rid == NULL)
+    {
+        return -1;
+    }
+
+    RID rid = entryRid(t, entry);
+    if (probe->rid->page != rid.page)
+    {
+        return (probe->rid->page < rid.page) ? -1 : 1;
+    }
+    return (probe->rid->slot > rid.slot) - (probe->rid->slot < rid.slot);
+}
+
+// Index of the first entry of a node that is not smaller than the probe
+static int lowerBound(BT_TreeInfo *t, char *data, BT_Probe *probe)
+{
+    int lo = 0, hi = NODE_HEADER(data)->numEntries;
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (compareProbe(t, probe, entryAt(t, data, mid)) > 0)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Index of the child of an inner node whose subtree covers the probe: the number of separators not greater than it
+static int childIndex(BT_TreeInfo *t, char *data, BT_Probe *probe)
+{
+    int lo = 0, hi = NODE_HEADER(data)->numEntries;
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (compareProbe(t, probe, entryAt(t, data, mid)) >= 0)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Mark a modified node dirty and release it
+static RC releaseNode(BT_TreeInfo *t, BM_PageHandle *page)
+{
+    RC rc = markDirty(t->bm, page);
+    unpinPage(t->bm, page);
+    return rc;
+}
+
+// Append a new empty node to the page file and return it pinned
+static RC allocateNode(BT_TreeInfo *t, BM_PageHandle *page, bool isLeaf)
+{
+    // Take the next page number atomically, other users of the file may append pages concurrently;
+    // pinning a page behind the last page of the file grows the file
+    RC rc = pinPage(t->bm, page, __atomic_fetch_add(t->numPages, 1, __ATOMIC_SEQ_CST));
+    if (rc != RC_OK)
+    {
+        return rc;
+    }
+
+    memset(page->data, 0, PAGE_SIZE);
+    NODE_HEADER(page->data)->isLeaf = isLeaf;
+    NODE_HEADER(page->data)->numEntries = 0;
+    NODE_HEADER(page->data)->nextLeaf = NO_PAGE;
+    t->numNodes++;
+    return RC_OK;
+}
+
+// Split an overfull node; the separator for its parent is returned in upEntry and the new right node in upChild
+static RC splitNode(BT_TreeInfo *t, BM_PageHandle *page, char *upEntry, PageNumber *upChild)
+{
+    BT_NodeHeader *left = NODE_HEADER(page->data);
+    BM_PageHandle rightPage;
+    RC rc;
+
+    if ((rc = allocateNode(t, &rightPage, left->isLeaf)) != RC_OK)
+    {
+        unpinPage(t->bm, page);
+        return rc;
+    }
+
+    BT_NodeHeader *right = NODE_HEADER(rightPage.data);
+    int mid = left->numEntries / 2;
+    if (left->isLeaf)
+    {
+        // The upper half moves to the new leaf, whose first entry separates the two leaves
+        right->numEntries = left->numEntries - mid;
+        memcpy(entryAt(t, rightPage.data, 0), entryAt(t, page->data, mid), right->numEntries * t->entrySize);
+        right->nextLeaf = left->nextLeaf;
+        left->nextLeaf = rightPage.pageNum;
+        memcpy(upEntry, entryAt(t, rightPage.data, 0), t->entrySize);
+    }
+    else
+    {
+        // The middle separator moves up, the separators and children after it move to the new node
+        right->numEntries = left->numEntries - mid - 1;
+        memcpy(upEntry, entryAt(t, page->data, mid), t->entrySize);
+        memcpy(entryAt(t, rightPage.data, 0), entryAt(t, page->data, mid + 1), right->numEntries * t->entrySize);
+        memcpy(childAt(t, rightPage.data, 0), childAt(t, page->data, mid + 1), (right->numEntries + 1) * sizeof(PageNumber));
+    }
+    left->numEntries = mid;
+    *upChild = rightPage.pageNum;
+
+    rc = releaseNode(t, &rightPage);
+    RC rcLeft = releaseNode(t, page);
+    return (rc != RC_OK) ? rc : rcLeft;
+}
+
+// Insert an entry into the subtree of a node; if the node splits, split is set and the separator
+// and new right node for the parent are returned in upEntry and upChild
+static RC insertInto(BT_TreeInfo *t, PageNumber node, BT_Probe *probe, char *entry, bool *split, char *upEntry, PageNumber *upChild)
+{
+    BM_PageHandle page;
+    RC rc;
+    int pos;
+
+    *split = false;
+    if ((rc = pinPage(t->bm, &page, node)) != RC_OK)
+    {
+        return rc;
+    }
+
+    if (NODE_HEADER(page.data)->isLeaf)
+    {
+        pos = lowerBound(t, page.data, probe);
+        if (pos < NODE_HEADER(page.data)->numEntries && compareProbe(t, probe, entryAt(t, page.data, pos)) == 0)
+        {
+            unpinPage(t->bm, &page);
+            return RC_IM_KEY_ALREADY_EXISTS;
+        }
+        insertEntry(t, page.data, pos, entry);
+    }
+    else
+    {
+        // Insert below the child covering the entry, the node only changes if the child splits
+        pos = childIndex(t, page.data, probe);
+        PageNumber child = getChild(t, page.data, pos);
+        bool childSplit;
+
+        unpinPage(t->bm, &page);
+        if ((rc = insertInto(t, child, probe, entry, &childSplit, upEntry, upChild)) != RC_OK || !childSplit)
+        {
+            return rc;
+        }
+
+        if ((rc = pinPage(t->bm, &page, node)) != RC_OK)
+        {
+            return rc;
+        }
+        insertChild(t, page.data, pos + 1, *upChild, NODE_HEADER(page.data)->numEntries + 1);
+        insertEntry(t, page.data, pos, upEntry);
+    }
+
+    if (NODE_HEADER(page.data)->numEntries <= t->n)
+    {
+        return releaseNode(t, &page);
+    }
+
+    *split = true;
+    return splitNode(t, &page, upEntry, upChild);
+}
+
+// Fix the underflowing child c of an inner node by merging it with a sibling or moving an entry over
+// from the sibling; underflow is set if the node itself is left with too few entries
+static RC rebalance(BT_TreeInfo *t, PageNumber node, int c, bool *underflow)
+{
+    BM_PageHandle parent, leftPage, rightPage;
+    RC rc;
+
+    if ((rc = pinPage(t->bm, &parent, node)) != RC_OK)
+    {
+        return rc;
+    }
+
+    // Pair the child with its left sibling, or with its right sibling if it is the first child
+    int sep = (c > 0) ? c - 1 : c;
+    if ((rc = pinPage(t->bm, &leftPage, getChild(t, parent.data, sep))) != RC_OK)
+    {
+        unpinPage(t->bm, &parent);
+        return rc;
+    }
+    if ((rc = pinPage(t->bm, &rightPage, getChild(t, parent.data, sep + 1))) != RC_OK)
+    {
+        unpinPage(t->bm, &leftPage);
+        unpinPage(t->bm, &parent);
+        return rc;
+    }
+
+    BT_NodeHeader *left = NODE_HEADER(leftPage.data);
+    BT_NodeHeader *right = NODE_HEADER(rightPage.data);
+    char *sepEntry = entryAt(t, parent.data, sep);
+    bool merged = false;
+
+    if (left->isLeaf && left->numEntries + right->numEntries <= t->n)
+    {
+        // Append the right leaf to the left one
+        memcpy(entryAt(t, leftPage.data, left->numEntries), entryAt(t, rightPage.data, 0), right->numEntries * t->entrySize);
+        left->numEntries += right->numEntries;
+        left->nextLeaf = right->nextLeaf;
+        merged = true;
+    }
+    else if (!left->isLeaf && left->numEntries + right->numEntries + 1 <= t->n)
+    {
+        // Pull the separator down and append the right node to the left one
+        memcpy(entryAt(t, leftPage.data, left->numEntries), sepEntry, t->entrySize);
+        memcpy(entryAt(t, leftPage.data, left->numEntries + 1), entryAt(t, rightPage.data, 0), right->numEntries * t->entrySize);
+        memcpy(childAt(t, leftPage.data, left->numEntries + 1), childAt(t, rightPage.data, 0), (right->numEntries + 1) * sizeof(PageNumber));
+        left->numEntries += right->numEntries + 1;
+        merged = true;
+    }
+    else if (left->numEntries > right->numEntries)
+    {
+        // Move the last entry of the left node to the right one
+        if (left->isLeaf)
+        {
+            insertEntry(t, rightPage.data, 0, entryAt(t, leftPage.data, left->numEntries - 1));
+            left->numEntries--;
+            memcpy(sepEntry, entryAt(t, rightPage.data, 0), t->entrySize);
+        }
+        else
+        {
+            // Rotate through the parent: its separator moves down, the last separator of the left node moves up
+            insertChild(t, rightPage.data, 0, getChild(t, leftPage.data, left->numEntries), right->numEntries + 1);
+            insertEntry(t, rightPage.data, 0, sepEntry);
+            memcpy(sepEntry, entryAt(t, leftPage.data, left->numEntries - 1), t->entrySize);
+            left->numEntries--;
+        }
+    }
+    else
+    {
+        // Move the first entry of the right node to the left one
+        if (left->isLeaf)
+        {
+            insertEntry(t, leftPage.data, left->numEntries, entryAt(t, rightPage.data, 0));
+            removeEntry(t, rightPage.data, 0);
+            memcpy(sepEntry, entryAt(t, rightPage.data, 0), t->entrySize);
+        }
+        else
+        {
+            insertChild(t, leftPage.data, left->numEntries + 1, getChild(t, rightPage.data, 0), left->numEntries + 1);
+            insertEntry(t, leftPage.data, left->numEntries, sepEntry);
+            memcpy(sepEntry, entryAt(t, rightPage.data, 0), t->entrySize);
+            removeChild(t, rightPage.data, 0, right->numEntries + 1);
+            removeEntry(t, rightPage.data, 0);
+        }
+    }
+
+    // A merged right node is dropped from the parent, its page is not reused
+    if (merged)
+    {
+        removeChild(t, parent.data, sep + 1, NODE_HEADER(parent.data)->numEntries + 1);
+        removeEntry(t, parent.data, sep);
+        t->numNodes--;
+    }
+    *underflow = NODE_HEADER(parent.data)->numEntries < minEntries(t);
+
+    RC rcRight = releaseNode(t, &rightPage);
+    RC rcLeft = releaseNode(t, &leftPage);
+    rc = releaseNode(t, &parent);
+    return (rcRight != RC_OK) ? rcRight : (rcLeft != RC_OK) ? rcLeft : rc;
+}
+
+// Delete an entry from the subtree of a node; underflow is set if the node is left with too few entries
+static RC deleteFrom(BT_TreeInfo *t, PageNumber node, BT_Probe *probe, bool *underflow)
+{
+    BM_PageHandle page;
+    RC rc;
+
+    *underflow = false;
+    if ((rc = pinPage(t->bm, &page, node)) != RC_OK)
+    {
+        return rc;
+    }
+
+    if (NODE_HEADER(page.data)->isLeaf)
+    {
+        int pos = lowerBound(t, page.data, probe);
+        if (pos == NODE_HEADER(page.data)->numEntries || compareProbe(t, probe, entryAt(t, page.data, pos)) != 0)
+        {
+            unpinPage(t->bm, &page);
+            return RC_IM_KEY_NOT_FOUND;
+        }
+        removeEntry(t, page.data, pos);
+        *underflow = NODE_HEADER(page.data)->numEntries < minEntries(t);
+        return releaseNode(t, &page);
+    }
+
+    // Delete below the child covering the entry, the node only changes if the child underflows
+    int c = childIndex(t, page.data, probe);
+    PageNumber child = getChild(t, page.data, c);
+    bool childUnderflow;
+
+    unpinPage(t->bm, &page);
+    if ((rc = deleteFrom(t, child, probe, &childUnderflow)) != RC_OK || !childUnderflow)
+    {
+        return rc;
+    }
+    return rebalance(t, node, c, underflow);
+}
+
+// Position a scan before the first entry not smaller than the probe, or before the first entry without a probe
+static RC positionScan(BT_TreeInfo *t, BT_Probe *probe, BT_ScanInfo *pos)
+{
+    BM_PageHandle page;
+    PageNumber node = t->root;
+    RC rc;
+
+    // Descend to the leaf covering the probe
+    for (;;)
+    {
+        if ((rc = pinPage(t->bm, &page, node)) != RC_OK)
+        {
+            return rc;
+        }
+        if (NODE_HEADER(page.data)->isLeaf)
+        {
+            break;
+        }
+        node = getChild(t, page.data, (probe != NULL) ? childIndex(t, page.data, probe) : 0);
+        unpinPage(t->bm, &page);
+    }
+
+    pos->leaf = node;
+    pos->pos = (probe != NULL) ? lowerBound(t, page.data, probe) : 0;
+    unpinPage(t->bm, &page);
+    return RC_OK;
+}
+
+// Copy the entry at a scan position and advance the position
+static RC readEntry(BT_TreeInfo *t, BT_ScanInfo *pos, char *entry)
+{
+    BM_PageHandle page;
+    RC rc;
+
+    while (pos->leaf != NO_PAGE)
+    {
+        if ((rc = pinPage(t->bm, &page, pos->leaf)) != RC_OK)
+        {
+            return rc;
+        }
+
+        if (pos->pos < NODE_HEADER(page.data)->numEntries)
+        {
+            memcpy(entry, entryAt(t, page.data, pos->pos), t->entrySize);
+            pos->pos++;
+            unpinPage(t->bm, &page);
+            return RC_OK;
+        }
+
+        // Continue on the next leaf
+        pos->leaf = NODE_HEADER(page.data)->nextLeaf;
+        pos->pos = 0;
+        unpinPage(t->bm, &page);
+    }
+    return RC_IM_NO_MORE_ENTRIES;
+}
+
+// create, open, and close a b-tree index
+RC createBtree(BM_BufferPool *bm, int *numPages, Schema *schema, int n, PageNumber *headerPage)
+{
+    BT_TreeInfo t;
+    BM_PageHandle page, root;
+    RC rc;
+
+    t.bm = bm;
+    t.numPages = numPages;
+    t.schema = schema;
+    t.keySize = getKeySize(schema);
+    t.entrySize = t.keySize + sizeof(RID);
+    t.numNodes = 0;
+
+    if (t.keySize == 0)
+    {
+        THROW(RC_ERROR, "an index needs a schema with key attributes");
+    }
+    if (n > maxEntriesPerNode(t.entrySize))
+    {
+        return RC_IM_N_TO_LAGE;
+    }
+    if (n != 0 && n < 2)
+    {
+        THROW(RC_ERROR, "an index node needs room for at least two entries");
+    }
+    t.n = (n == 0) ? maxEntriesPerNode(t.entrySize) : n;
+
+    // The header page comes first, followed by the root, an empty leaf
+    if ((rc = pinPage(bm, &page, __atomic_fetch_add(numPages, 1, __ATOMIC_SEQ_CST))) != RC_OK)
+    {
+        return rc;
+    }
+    *headerPage = page.pageNum;
+
+    if ((rc = allocateNode(&t, &root, true)) != RC_OK)
+    {
+        unpinPage(bm, &page);
+        return rc;
+    }
+
+    BT_Header *header = (BT_Header *)page.data;
+    memset(page.data, 0, PAGE_SIZE);
+    header->magic = BT_MAGIC;
+    header->n = t.n;
+    header->keySize = t.keySize;
+    header->root = root.pageNum;
+    header->numNodes = t.numNodes;
+    header->numEntries = 0;
+
+    rc = releaseNode(&t, &root);
+    RC rcHeader = releaseNode(&t, &page);
+    return (rc != RC_OK) ? rc : rcHeader;
+}
+
+RC openBtree(BTreeHandle **tree, BM_BufferPool *bm, int *numPages, Schema *schema, PageNumber headerPage)
+{
+    BM_PageHandle page;
+    RC rc = pinPage(bm, &page, headerPage);
+    if (rc != RC_OK)
+    {
+        return rc;
+    }
+
+    // Check that the page holds an index over keys of this schema
+    BT_Header *header = (BT_Header *)page.data;
+    if (header->magic != BT_MAGIC || header->keySize != getKeySize(schema))
+    {
+        unpinPage(bm, &page);
+        THROW(RC_ERROR, "page is not the header of an index over this schema");
+    }
+
+    BT_TreeInfo *t = (BT_TreeInfo *)malloc(sizeof(BT_TreeInfo));
+    t->bm = bm;
+    t->numPages = numPages;
+    t->schema = schema;
+    t->n = header->n;
+    t->keySize = header->keySize;
+    t->entrySize = t->keySize + sizeof(RID);
+    t->root = header->root;
+    t->numNodes = header->numNodes;
+    t->numEntries = header->numEntries;
+    t->entries = (char *)malloc(2 * t->entrySize);
+    unpinPage(bm, &page);
+
+    *tree = (BTreeHandle *)malloc(sizeof(BTreeHandle));
+    (*tree)->schema = schema;
+    (*tree)->headerPage = headerPage;
+    (*tree)->mgmtData = t;
+    return RC_OK;
+}
+
+RC closeBtree(BTreeHandle *tree)
+{
+    BT_TreeInfo *t = (BT_TreeInfo *)tree->mgmtData;
+    BM_PageHandle page;
+
+    // Write back the root and the size of the tree
+    RC rc = pinPage(t->bm, &page, tree->headerPage);
+    if (rc == RC_OK)
+    {
+        BT_Header *header = (BT_Header *)page.data;
+        header->root = t->root;
+        header->numNodes = t->numNodes;
+        header->numEntries = t->numEntries;
+        rc = releaseNode(t, &page);
+    }
+
+    free(t->entries);
+    free(t);
+    free(tree);
+    return rc;
+}
+
+RC deleteBtree(BM_BufferPool *bm, PageNumber headerPage)
+{
+    BM_PageHandle page;
+
+    // Invalidate the header, the pages of the index are not reused
+    RC rc = pinPage(bm, &page, headerPage);
+    if (rc != RC_OK)
+    {
+        return rc;
+    }
+    if (((BT_Header *)page.data)->magic != BT_MAGIC)
+    {
+        unpinPage(bm, &page);
+        THROW(RC_ERROR, "page is not the header of an index");
+    }
+    ((BT_Header *)page.data)->magic = 0;
+
+    rc = markDirty(bm, &page);
+    unpinPage(bm, &page);
+    return rc;
+}
+
+// access information about a b-tree
+RC getNumNodes(BTreeHandle *tree, int *result)
+{
+    *result = ((BT_TreeInfo *)tree->mgmtData)->numNodes;
+    return RC_OK;
+}
+
+RC getNumEntries(BTreeHandle *tree, int *result)
+{
+    *result = ((BT_TreeInfo *)tree->mgmtData)->numEntries;
+    return RC_OK;
+}
+
+// index access
+RC findKey(BTreeHandle *tree, char *key, RID *result)
+{
+    BT_TreeInfo *t = (BT_TreeInfo *)tree->mgmtData;
+    BT_Probe probe = {key, NULL};
+    BT_ScanInfo pos;
+    RC rc;
+
+    // The first entry not smaller than the key holds the key if the key is in the tree
+    if ((rc = positionScan(t, &probe, &pos)) != RC_OK)
+    {
+        return rc;
+    }
+    rc = readEntry(t, &pos, t->entries);
+    if (rc == RC_IM_NO_MORE_ENTRIES || (rc == RC_OK && compareKeys(t->schema, key, t->entries) != 0))
+    {
+        return RC_IM_KEY_NOT_FOUND;
+    }
+    if (rc == RC_OK)
+    {
+        *result = entryRid(t, t->entries);
+    }
+    return rc;
+}
+
+RC insertKey(BTreeHandle *tree, char *key, RID rid)
+{
+    BT_TreeInfo *t = (BT_TreeInfo *)tree->mgmtData;
+    BT_Probe probe = {key, &rid};
+    char *entry = t->entries;
+    char *upEntry = t->entries + t->entrySize;
+    PageNumber upChild;
+    bool split;
+    RC rc;
+
+    memcpy(entry, key, t->keySize);
+    memcpy(entry + t->keySize, &rid, sizeof(RID));
+    if ((rc = insertInto(t, t->root, &probe, entry, &split, upEntry, &upChild)) != RC_OK)
+    {
+        return rc;
+    }
+    t->numEntries++;
+
+    // A split root is replaced by a new root above the two halves
+    if (split)
+    {
+        BM_PageHandle page;
+        if ((rc = allocateNode(t, &page, false)) != RC_OK)
+        {
+            return rc;
+        }
+        insertEntry(t, page.data, 0, upEntry);
+        setChild(t, page.data, 0, t->root);
+        setChild(t, page.data, 1, upChild);
+        t->root = page.pageNum;
+        return releaseNode(t, &page);
+    }
+    return RC_OK;
+}
+
+RC deleteKey(BTreeHandle *tree, char *key, RID rid)
+{
+    BT_TreeInfo *t = (BT_TreeInfo *)tree->mgmtData;
+    BT_Probe probe = {key, &rid};
+    BM_PageHandle page;
+    bool underflow;
+    RC rc;
+
+    if ((rc = deleteFrom(t, t->root, &probe, &underflow)) != RC_OK)
+    {
+        return rc;
+    }
+    t->numEntries--;
+
+    // An inner root left without separators is replaced by its only child
+    if ((rc = pinPage(t->bm, &page, t->root)) != RC_OK)
+    {
+        return rc;
+    }
+    if (!NODE_HEADER(page.data)->isLeaf && NODE_HEADER(page.data)->numEntries == 0)
+    {
+        t->root = getChild(t, page.data, 0);
+        t->numNodes--;
+    }
+    unpinPage(t->bm, &page);
+    return RC_OK;
+}
+
+// scans
+static RC openScanAt(BTreeHandle *tree, BT_Probe *probe, BT_ScanHandle **handle)
+{
+    BT_ScanInfo *pos = (BT_ScanInfo *)malloc(sizeof(BT_ScanInfo));
+    RC rc = positionScan((BT_TreeInfo *)tree->mgmtData, probe, pos);
+    if (rc != RC_OK)
+    {
+        free(pos);
+        return rc;
+    }
+
+    *handle = (BT_ScanHandle *)malloc(sizeof(BT_ScanHandle));
+    (*handle)->tree = tree;
+    (*handle)->mgmtData = pos;
+    return RC_OK;
+}
+
+RC openTreeScan(BTreeHandle *tree, BT_ScanHandle **handle)
+{
+    return openScanAt(tree, NULL, handle);
+}
+
+RC openTreeScanFrom(BTreeHandle *tree, char *key, BT_ScanHandle **handle)
+{
+    BT_Probe probe = {key, NULL};
+    return openScanAt(tree, &probe, handle);
+}
+
+RC nextEntry(BT_ScanHandle *handle, RID *result)
+{
+    BT_TreeInfo *t = (BT_TreeInfo *)handle->tree->mgmtData;
+    RC rc = readEntry(t, (BT_ScanInfo *)handle->mgmtData, t->entries);
+    if (rc == RC_OK)
+    {
+        *result = entryRid(t, t->entries);
+    }
+    return rc;
+}
+
+RC nextEntryWithKey(BT_ScanHandle *handle, RID *result, char *key)
+{
+    BT_TreeInfo *t = (BT_TreeInfo *)handle->tree->mgmtData;
+    RC rc = nextEntry(handle, result);
+    if (rc == RC_OK)
+    {
+        memcpy(key, t->entries, t->keySize);
+    }
+    return rc;
+}
+
+RC closeTreeScan(BT_ScanHandle *handle)
+{
+    free(handle->mgmtData);
+    free(handle);
+    return RC_OK;
+}
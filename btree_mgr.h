@@ -0,0 +1,50 @@
+#ifndef BTREE_MGR_H
+#define BTREE_MGR_H
+
+#include "dberror.h"
+#include "tables.h"
+#include "buffer_mgr.h"
+
+// B+-tree index mapping the keys of a table's records (see getRecordKey) to their RIDs.
+// Entries are ordered by key and then by RID, so a key may occur with several RIDs.
+// The nodes are pages of a page file accessed through a buffer pool, new nodes are
+// appended to the file at page *numPages, which other users of the file may share. An index is
+// identified by its header page; its users serialize the calls on one index.
+typedef struct BTreeHandle
+{
+	Schema *schema;        // schema of the indexed records
+	PageNumber headerPage; // page holding the root and the size of the tree
+	void *mgmtData;
+} BTreeHandle;
+
+typedef struct BT_ScanHandle
+{
+	BTreeHandle *tree;
+	void *mgmtData;
+} BT_ScanHandle;
+
+// create, open, and close a b-tree index; n is the maximum number of entries
+// per node, 0 for as many as fit on a page
+extern RC createBtree (BM_BufferPool *bm, int *numPages, Schema *schema, int n, PageNumber *headerPage);
+extern RC openBtree (BTreeHandle **tree, BM_BufferPool *bm, int *numPages, Schema *schema, PageNumber headerPage);
+extern RC closeBtree (BTreeHandle *tree);
+extern RC deleteBtree (BM_BufferPool *bm, PageNumber headerPage);
+
+// access information about a b-tree
+extern RC getNumNodes (BTreeHandle *tree, int *result);
+extern RC getNumEntries (BTreeHandle *tree, int *result);
+
+// index access; findKey returns the smallest RID stored with the key
+extern RC findKey (BTreeHandle *tree, char *key, RID *result);
+extern RC insertKey (BTreeHandle *tree, char *key, RID rid);
+extern RC deleteKey (BTreeHandle *tree, char *key, RID rid);
+
+// scan the entries in key order, starting at the first entry or at the first key >= key
+extern RC openTreeScan (BTreeHandle *tree, BT_ScanHandle **handle);
+extern RC openTreeScanFrom (BTreeHandle *tree, char *key, BT_ScanHandle **handle);
+extern RC nextEntry (BT_ScanHandle *handle, RID *result);
+// like nextEntry, and copies the key of the entry to key
+extern RC nextEntryWithKey (BT_ScanHandle *handle, RID *result, char *key);
+extern RC closeTreeScan (BT_ScanHandle *handle);
+
+#endif // BTREE_MGR_H
@@ -16,15 +16,19 @@ RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName, const
         return RC_FILE_NOT_FOUND;
     }
 
-    FILE *fh = fopen(pageFileName, "rb+");
-    // Prevent init buffer pool for non existing page file
-    if (fh == NULL)
+    // Allocate memory for mgmtData
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)malloc(sizeof(BM_MGMT_DATA));
+
+    // Open the page file, prevent init buffer pool for non existing page file
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdiscarded-qualifiers"
+    if (openPageFile(pageFileName, &mgmtData->fileHandle) != RC_OK)
+#pragma GCC diagnostic pop
     {
+        free(mgmtData);
         return RC_FILE_NOT_FOUND;
     }
 
-    fclose(fh);
-
     // Added #pragma GCC diagnostic push and #pragma GCC diagnostic ignored to suppress the following warning:
     // warning: discarding 'const' qualifier from pointer target type [-Wdiscarded-qualifiers]
     // See https://stackoverflow.com/questions/19452971/why-does-gcc-complain-about-passing-const-parameters-as-arguments for more details
@@ -35,11 +39,20 @@ RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName, const
     bm->numPages = numPages; // Set Number of pages in the buffer pool
     bm->strategy = strategy; // Set Replacement strategy for the buffer pool
 
-    // Allocate memory for mgmtData
-    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)malloc(sizeof(BM_MGMT_DATA));
     mgmtData->numReadIO = 0;  // Initialize number of read IOs to 0
     mgmtData->numWriteIO = 0; // Initialize number of write IOs to 0
-    mgmtData->queueHead = 0;  // Initialize queue head to 0 -> FIFO Strategy
+    pthread_mutex_init(&mgmtData->fileLatch, NULL);
+
+    // Allocate the page buffers of all frames at once
+    if (allocFrameArena(mgmtData, numPages) != RC_OK)
+    {
+        closePageFile(&mgmtData->fileHandle);
+        free(mgmtData);
+        return RC_ERROR;
+    }
+
+    // Batched transfers use the arena as fixed buffers where the storage manager supports them
+    registerBlockBuffers(&mgmtData->fileHandle, mgmtData->frameArena, mgmtData->frameArenaSize);
 
     // Allocate memory for page frames
     mgmtData->frames = (PAGE_FRAME *)malloc(numPages * sizeof(PAGE_FRAME));
@@ -48,12 +61,49 @@ RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName, const
     for (int i = 0; i < numPages; i++)
     {
         mgmtData->frames[i].pageNum = NO_PAGE;     // Set page number to NO_PAGE
-        mgmtData->frames[i].data = NULL;           // Set data to NULL
+        mgmtData->frames[i].data = mgmtData->frameArena + (size_t)i * PAGE_SIZE; // Set data to the frame's buffer in the arena
         mgmtData->frames[i].isDirty = false;       // Set isDirty to false
         mgmtData->frames[i].fixCount = 0;          // Set fixCount to 0
         mgmtData->frames[i].recentAccessCount = 0; // Set recentAccessCount to 0 -> LRU Strategy
+        mgmtData->frames[i].referenced = false;    // Clear reference bit -> CLOCK Strategy
+        mgmtData->frames[i].numPins = 0;
+        mgmtData->frames[i].ioPending = false;
+        mgmtData->frames[i].prefetched = false;
+        mgmtData->frames[i].pageLSN = 0;
+        mgmtData->frames[i].recLSN = 0;
+        pthread_rwlock_init(&mgmtData->frames[i].latch, NULL);
     }
 
+    // Split the frames into shards, then initialize the page table and the free frames of the shards
+    initShards(mgmtData, numPages);
+    initPageTable(mgmtData, numPages);
+
+    // Initialize the access history of LRU-K
+    mgmtData->lruK = 0;
+    if (strategy == RS_LRU_K)
+    {
+        initLRUKHistory(mgmtData, numPages, (stratData != NULL) ? *(int *)stratData : DEFAULT_LRU_K);
+    }
+
+    // The page cleaner is only started by startPageCleaner
+    mgmtData->numDirtyFrames = 0;
+    mgmtData->dirtyHighWater = numPages / 4;
+    mgmtData->cleanerRunning = false;
+    pthread_mutex_init(&mgmtData->cleanerLatch, NULL);
+    pthread_cond_init(&mgmtData->cleanerWakeup, NULL);
+
+    // The read-ahead thread is started by the first prefetchPages
+    mgmtData->prefetchHead = 0;
+    mgmtData->numPrefetchPages = 0;
+    mgmtData->prefetcherRunning = false;
+    mgmtData->stopPrefetcher = false;
+    pthread_mutex_init(&mgmtData->prefetchLatch, NULL);
+    pthread_cond_init(&mgmtData->prefetchWakeup, NULL);
+
+    // Pages are written without a write-ahead log until setWriteAheadLog
+    mgmtData->flushLog = NULL;
+    mgmtData->log = NULL;
+
     // Update mgmtData pointer in the buffer pool
     bm->mgmtData = mgmtData;
 
@@ -72,6 +122,11 @@ RC shutdownBufferPool(BM_BufferPool *const bm)
 
     // Allocate memory for mgmtData
     BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    RC rc = RC_OK;
+
+    // Stop the read-ahead thread and the page cleaner before the frames go away
+    stopPrefetcher(bm);
+    stopPageCleaner(bm);
 
     // TEST CASE FAILING: Hence commented
     //     // Check if there are any pinned pages in the buffer pool
@@ -90,19 +145,30 @@ RC shutdownBufferPool(BM_BufferPool *const bm)
         // If the page is dirty, and has no fix count, write it back to disk
         if (mgmtData->frames[i].isDirty && mgmtData->frames[i].fixCount == 0)
         {
-            // Write the dirty page back to disk
-            writePageToFile(bm, &mgmtData->frames[i]);
-            // Increment the number of write IOs
-            mgmtData->numWriteIO++;
+            // Write the dirty page back to disk, counting the write IO; the first failure is reported
+            RC writeRc = writePageToFile(bm, &mgmtData->frames[i]);
+            rc = (rc == RC_OK) ? writeRc : rc;
         }
     }
 
     // Free the memory allocated for page frames
     for (int i = 0; i < bm->numPages; i++)
     {
-        free(mgmtData->frames[i].data);
+        pthread_rwlock_destroy(&mgmtData->frames[i].latch);
     }
+    pthread_mutex_destroy(&mgmtData->fileLatch);
+    pthread_mutex_destroy(&mgmtData->cleanerLatch);
+    pthread_cond_destroy(&mgmtData->cleanerWakeup);
+    pthread_mutex_destroy(&mgmtData->prefetchLatch);
+    pthread_cond_destroy(&mgmtData->prefetchWakeup);
+    freeShards(mgmtData);
+    freeFrameArena(mgmtData);
     free(mgmtData->frames);
+    freePageTable(mgmtData);
+    freeLRUKHistory(mgmtData);
+
+    // Close the page file
+    closePageFile(&mgmtData->fileHandle);
 
     // Free the memory allocated for mgmtData
     free(mgmtData);
@@ -110,7 +176,7 @@ RC shutdownBufferPool(BM_BufferPool *const bm)
     // Reset the mgmtData pointer in the buffer pool
     bm->mgmtData = NULL;
 
-    return RC_OK;
+    return rc;
 }
 
 RC forceFlushPool(BM_BufferPool *const bm)
@@ -121,24 +187,38 @@ RC forceFlushPool(BM_BufferPool *const bm)
     }
     // Allocate memory for mgmtData
     BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    RC rc = RC_OK;
 
-    // Perform a forced flush operation for all dirty pages with fix count 0 in the buffer pool
-    for (int i = 0; i < bm->numPages; i++)
+    // Perform a forced flush operation for all dirty pages with fix count 0 in the buffer pool, one shard at a time.
+    // The cleaner latch waits for a running cleaning pass, whose writes are not finished yet.
+    pthread_mutex_lock(&mgmtData->cleanerLatch);
+    for (int s = 0; s < mgmtData->numShards; s++)
     {
-        // If the page is dirty, and has no fix count, write it back to disk
-        if (mgmtData->frames[i].isDirty && mgmtData->frames[i].fixCount == 0)
+        BM_SHARD *shard = &mgmtData->shards[s];
+        pthread_mutex_lock(&shard->latch);
+        for (int i = shard->firstFrame; i < shard->firstFrame + shard->numFrames; i++)
         {
-            // Write the dirty page back to disk
-            writePageToFile(bm, &mgmtData->frames[i]);
-            // Increment the number of write IOs
-            mgmtData->numWriteIO++;
-
-            // Mark the page as not dirty after it has been written back to disk
-            mgmtData->frames[i].isDirty = false;
+            // If the page is dirty, and has no fix count, write it back to disk
+            if (__atomic_load_n(&mgmtData->frames[i].isDirty, __ATOMIC_ACQUIRE) && __atomic_load_n(&mgmtData->frames[i].fixCount, __ATOMIC_ACQUIRE) == 0)
+            {
+                // Write the dirty page back to disk, counting the write IO. A page that could not be written
+                // stays dirty, and the first failure is reported once the other pages are written.
+                RC writeRc = writePageToFile(bm, &mgmtData->frames[i]);
+                if (writeRc != RC_OK)
+                {
+                    rc = (rc == RC_OK) ? writeRc : rc;
+                    continue;
+                }
+
+                // Mark the page as not dirty after it has been written back to disk
+                clearFrameDirty(mgmtData, &mgmtData->frames[i]);
+            }
         }
+        pthread_mutex_unlock(&shard->latch);
     }
+    pthread_mutex_unlock(&mgmtData->cleanerLatch);
 
-    return RC_OK;
+    return rc;
 }
 
 // Buffer Manager Interface Access Pages
@@ -156,18 +236,9 @@ RC markDirty(BM_BufferPool *const bm, BM_PageHandle *const page)
     // Get the mgmtData pointer from the buffer pool
     BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
     PAGE_FRAME *frames = mgmtData->frames;
-    int numPages = bm->numPages;
 
-    // Find the target page in the buffer pool
-    int frameIndex = -1;
-    for (int i = 0; i < numPages; i++)
-    {
-        if (frames[i].pageNum == page->pageNum)
-        {
-            frameIndex = i;
-            break;
-        }
-    }
+    // Find the target page in the buffer pool, pinned pages are found without a latch
+    int frameIndex = findPinnedFrame(bm, page);
 
     // If the page is not found in the buffer pool, return an error
     if (frameIndex == -1)
@@ -175,8 +246,8 @@ RC markDirty(BM_BufferPool *const bm, BM_PageHandle *const page)
         return RC_READ_NON_EXISTING_PAGE;
     }
 
-    // Mark the page as dirty
-    frames[frameIndex].isDirty = true;
+    // Mark the page as dirty, the page is only written back once it is unpinned
+    markFrameDirty(mgmtData, &frames[frameIndex]);
 
     return RC_OK;
 }
@@ -191,35 +262,132 @@ RC unpinPage(BM_BufferPool *const bm, BM_PageHandle *const page)
 
     BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
     PAGE_FRAME *frames = mgmtData->frames;
-    int numPages = bm->numPages;
 
-    // Find the target page in the buffer pool
-    int frameIndex = -1;
-    for (int i = 0; i < numPages; i++)
+    // Find the target page in the buffer pool, pinned pages are found without a latch
+    int frameIndex = findPinnedFrame(bm, page);
+
+    // If the page is not found in the buffer pool, return an error
+    if (frameIndex == -1)
     {
-        if (frames[i].pageNum == page->pageNum)
-        {
-            frameIndex = i;
-            break;
-        }
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+
+    // Decrement the fix count atomically, it never drops below zero
+    int fixCount = __atomic_load_n(&frames[frameIndex].fixCount, __ATOMIC_RELAXED);
+    while (fixCount > 0 && !__atomic_compare_exchange_n(&frames[frameIndex].fixCount, &fixCount, fixCount - 1, false,
+                                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        ;
+
+    return RC_OK;
+}
+
+RC forcePage(BM_BufferPool *const bm, BM_PageHandle *const page)
+{
+    // Check if buffer pool is not existing
+    if (bm == NULL || bm->mgmtData == NULL)
+    {
+        return RC_BUFFER_POOL_NOT_EXISTING;
     }
 
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    PAGE_FRAME *frames = mgmtData->frames;
+
+    // Find the target page in the buffer pool, its shard latch keeps the page in its frame
+    BM_SHARD *shard = shardOf(mgmtData, page->pageNum);
+    pthread_mutex_lock(&shard->latch);
+    int frameIndex = findLoadedFrame(mgmtData, shard, page->pageNum);
+
     // If the page is not found in the buffer pool, return an error
     if (frameIndex == -1)
     {
+        pthread_mutex_unlock(&shard->latch);
         return RC_READ_NON_EXISTING_PAGE;
     }
 
-    // Decrement the fix count
-    if (frames[frameIndex].fixCount > 0)
+    // Write the page back to disk, counting the write IO; the page stays dirty if that fails
+    RC rc = writePageToFile(bm, &frames[frameIndex]);
+
+    // Mark the page as not dirty after it has been written back to disk
+    if (rc == RC_OK)
+    {
+        clearFrameDirty(mgmtData, &frames[frameIndex]);
+    }
+    pthread_mutex_unlock(&shard->latch);
+
+    return rc;
+}
+
+// Pin a page with the replacement strategy of the pool, the caller holds the latch of the page's shard
+static RC pinPageLocked(BM_BufferPool *const bm, BM_SHARD *shard, BM_PageHandle *const page, const PageNumber pageNum)
+{
+    switch (bm->strategy)
     {
-        frames[frameIndex].fixCount--;
+    case RS_FIFO:
+        return pinPageUsingFIFO(bm, shard, page, pageNum);
+    case RS_LRU:
+        return pinPageUsingLRU(bm, shard, page, pageNum);
+    case RS_CLOCK:
+        return pinPageUsingCLOCK(bm, shard, page, pageNum);
+    case RS_LRU_K:
+        return pinPageUsingLRU_K(bm, shard, page, pageNum);
+    default:
+        return RC_INVALID_REPLACEMENT_STRATEGY;
     }
+}
 
+RC pinPage(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum)
+{
+    // Check for invalid page number
+    if (pageNum < 0)
+    {
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+    // Check if buffer pool is not existing
+    if (bm == NULL || bm->mgmtData == NULL)
+    {
+        return RC_BUFFER_POOL_NOT_EXISTING;
+    }
+
+    // Only the shard of the page is latched, pins of pages in other shards proceed in parallel
+    BM_SHARD *shard = shardOf((BM_MGMT_DATA *)bm->mgmtData, pageNum);
+    pthread_mutex_lock(&shard->latch);
+    RC rc = pinPageLocked(bm, shard, page, pageNum);
+    pthread_mutex_unlock(&shard->latch);
+
+    return rc;
+}
+
+// Buffer Manager Interface Latches
+
+RC latchPage(BM_BufferPool *const bm, BM_PageHandle *const page, bool exclusive)
+{
+    // Check if buffer pool is not existing
+    if (bm == NULL || bm->mgmtData == NULL)
+    {
+        return RC_BUFFER_POOL_NOT_EXISTING;
+    }
+
+    // The page is pinned, so it stays in its frame
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    int frameIndex = findPinnedFrame(bm, page);
+    if (frameIndex == -1)
+    {
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+
+    // Wait for the frame latch without holding a shard latch
+    if (exclusive)
+    {
+        pthread_rwlock_wrlock(&mgmtData->frames[frameIndex].latch);
+    }
+    else
+    {
+        pthread_rwlock_rdlock(&mgmtData->frames[frameIndex].latch);
+    }
     return RC_OK;
 }
 
-RC forcePage(BM_BufferPool *const bm, BM_PageHandle *const page)
+RC unlatchPage(BM_BufferPool *const bm, BM_PageHandle *const page)
 {
     // Check if buffer pool is not existing
     if (bm == NULL || bm->mgmtData == NULL)
@@ -228,54 +396,378 @@ RC forcePage(BM_BufferPool *const bm, BM_PageHandle *const page)
     }
 
     BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
-    PAGE_FRAME *frames = mgmtData->frames;
-    int numPages = bm->numPages;
+    int frameIndex = findPinnedFrame(bm, page);
+    if (frameIndex == -1)
+    {
+        return RC_READ_NON_EXISTING_PAGE;
+    }
 
-    // Find the target page in the buffer pool
-    int frameIndex = -1;
-    for (int i = 0; i < numPages; i++)
+    pthread_rwlock_unlock(&mgmtData->frames[frameIndex].latch);
+    return RC_OK;
+}
+
+// Buffer Manager Interface Page Cleaner
+
+RC startPageCleaner(BM_BufferPool *const bm, int dirtyHighWater)
+{
+    // Check if buffer pool is not existing
+    if (bm == NULL || bm->mgmtData == NULL)
+    {
+        return RC_BUFFER_POOL_NOT_EXISTING;
+    }
+
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    if (dirtyHighWater < 0)
+    {
+        dirtyHighWater = bm->numPages / 4;
+    }
+    __atomic_store_n(&mgmtData->dirtyHighWater, dirtyHighWater, __ATOMIC_RELAXED);
+
+    // A running cleaner only picks up the new high-water mark
+    if (__atomic_load_n(&mgmtData->cleanerRunning, __ATOMIC_ACQUIRE))
+    {
+        pthread_cond_signal(&mgmtData->cleanerWakeup);
+        return RC_OK;
+    }
+
+    mgmtData->stopCleaner = false;
+    mgmtData->cleanerShard = 0;
+    if (pthread_create(&mgmtData->cleaner, NULL, pageCleanerMain, bm) != 0)
+    {
+        return RC_ERROR;
+    }
+    __atomic_store_n(&mgmtData->cleanerRunning, true, __ATOMIC_RELEASE);
+
+    return RC_OK;
+}
+
+RC stopPageCleaner(BM_BufferPool *const bm)
+{
+    // Check if buffer pool is not existing
+    if (bm == NULL || bm->mgmtData == NULL)
+    {
+        return RC_BUFFER_POOL_NOT_EXISTING;
+    }
+
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    if (!__atomic_load_n(&mgmtData->cleanerRunning, __ATOMIC_ACQUIRE))
+    {
+        return RC_OK;
+    }
+
+    // Wake the cleaner up and wait until it exits, a running cleaning pass is finished first
+    pthread_mutex_lock(&mgmtData->cleanerLatch);
+    mgmtData->stopCleaner = true;
+    pthread_cond_signal(&mgmtData->cleanerWakeup);
+    pthread_mutex_unlock(&mgmtData->cleanerLatch);
+    pthread_join(mgmtData->cleaner, NULL);
+    __atomic_store_n(&mgmtData->cleanerRunning, false, __ATOMIC_RELEASE);
+
+    return RC_OK;
+}
+
+// Buffer Manager Interface Read-Ahead
+
+RC prefetchPages(BM_BufferPool *const bm, const PageNumber first, int count)
+{
+    // Check if buffer pool is not existing
+    if (bm == NULL || bm->mgmtData == NULL)
     {
-        if (frames[i].pageNum == page->pageNum)
+        return RC_BUFFER_POOL_NOT_EXISTING;
+    }
+    // Check for invalid page number
+    if (first < 0)
+    {
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    pthread_mutex_lock(&mgmtData->prefetchLatch);
+
+    // Start the read-ahead thread on first use
+    if (!mgmtData->prefetcherRunning)
+    {
+        if (pthread_create(&mgmtData->prefetcher, NULL, prefetcherMain, bm) != 0)
         {
-            frameIndex = i;
-            break;
+            pthread_mutex_unlock(&mgmtData->prefetchLatch);
+            return RC_ERROR;
         }
+        mgmtData->prefetcherRunning = true;
     }
 
-    // If the page is not found in the buffer pool, return an error
+    // Queue the pages, read-ahead is only a hint, so pages not fitting into the queue are dropped
+    for (int i = 0; i < count && mgmtData->numPrefetchPages < BM_PREFETCH_QUEUE_SIZE; i++)
+    {
+        int tail = (mgmtData->prefetchHead + mgmtData->numPrefetchPages++) % BM_PREFETCH_QUEUE_SIZE;
+        mgmtData->prefetchQueue[tail] = first + i;
+    }
+    pthread_cond_signal(&mgmtData->prefetchWakeup);
+    pthread_mutex_unlock(&mgmtData->prefetchLatch);
+
+    return RC_OK;
+}
+
+// Buffer Manager Interface Write-Ahead Logging
+
+RC setWriteAheadLog(BM_BufferPool *const bm, BM_FlushLog flushLog, void *log)
+{
+    // Check if buffer pool is not existing
+    if (bm == NULL || bm->mgmtData == NULL)
+    {
+        return RC_BUFFER_POOL_NOT_EXISTING;
+    }
+
+    // Set before the pool is shared, pages written from then on follow the log
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    mgmtData->flushLog = flushLog;
+    mgmtData->log = log;
+
+    return RC_OK;
+}
+
+RC setPageLSN(BM_BufferPool *const bm, BM_PageHandle *const page, long lsn)
+{
+    // Check if buffer pool is not existing
+    if (bm == NULL || bm->mgmtData == NULL)
+    {
+        return RC_BUFFER_POOL_NOT_EXISTING;
+    }
+
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    int frameIndex = findPinnedFrame(bm, page);
     if (frameIndex == -1)
     {
         return RC_READ_NON_EXISTING_PAGE;
     }
 
-    // Write the page back to disk
-    writePageToFile(bm, &frames[frameIndex]);
-    mgmtData->numWriteIO++;
+    // The page is pinned and changed under its exclusive latch, so its LSNs only grow; the first change
+    // since the page was last written sets its recLSN
+    __atomic_store_n(&mgmtData->frames[frameIndex].pageLSN, lsn, __ATOMIC_RELAXED);
+    long noLSN = 0;
+    __atomic_compare_exchange_n(&mgmtData->frames[frameIndex].recLSN, &noLSN, lsn, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+    return RC_OK;
+}
 
-    // Mark the page as not dirty after it has been written back to disk
-    frames[frameIndex].isDirty = false;
+// Buffer Manager Interface Checkpoints
+
+RC getDirtyPageTable(BM_BufferPool *const bm, PageNumber *pages, long *recLSNs, int *numPages)
+{
+    // Check if buffer pool is not existing
+    if (bm == NULL || bm->mgmtData == NULL)
+    {
+        return RC_BUFFER_POOL_NOT_EXISTING;
+    }
+
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+
+    // A change logs its record and sets the page's LSNs under the exclusive page latch, so once every
+    // latch was taken once, every change logged so far has set its recLSN
+    for (int i = 0; i < bm->numPages; i++)
+    {
+        pthread_rwlock_rdlock(&mgmtData->frames[i].latch);
+        pthread_rwlock_unlock(&mgmtData->frames[i].latch);
+    }
+
+    // A page only leaves its frame under the shard latch, after it was written
+    *numPages = 0;
+    for (int s = 0; s < mgmtData->numShards; s++)
+    {
+        BM_SHARD *shard = &mgmtData->shards[s];
+        pthread_mutex_lock(&shard->latch);
+        for (int i = shard->firstFrame; i < shard->firstFrame + shard->numFrames; i++)
+        {
+            long recLSN = __atomic_load_n(&mgmtData->frames[i].recLSN, __ATOMIC_RELAXED);
+            if (mgmtData->frames[i].pageNum != NO_PAGE && recLSN != 0)
+            {
+                pages[*numPages] = mgmtData->frames[i].pageNum;
+                recLSNs[(*numPages)++] = recLSN;
+            }
+        }
+        pthread_mutex_unlock(&shard->latch);
+    }
 
     return RC_OK;
 }
 
-RC pinPage(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum)
+RC flushPages(BM_BufferPool *const bm, const PageNumber *pages, int numPages)
 {
+    // Check if buffer pool is not existing
+    if (bm == NULL || bm->mgmtData == NULL)
+    {
+        return RC_BUFFER_POOL_NOT_EXISTING;
+    }
+
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    SM_IORequest requests[BM_CLEANER_BATCH];
+    int numRequests = 0;
+    RC rc = RC_OK;
+
+    for (int p = 0; p < numPages && rc == RC_OK; p++)
+    {
+        // A page that left the pool was written when it did
+        BM_SHARD *shard = shardOf(mgmtData, pages[p]);
+        pthread_mutex_lock(&shard->latch);
+        int frameIndex = findLoadedFrame(mgmtData, shard, pages[p]);
+        if (frameIndex == -1 || __atomic_load_n(&mgmtData->frames[frameIndex].recLSN, __ATOMIC_RELAXED) == 0)
+        {
+            pthread_mutex_unlock(&shard->latch);
+            continue;
+        }
+        PAGE_FRAME *frame = &mgmtData->frames[frameIndex];
+        __atomic_add_fetch(&frame->fixCount, 1, __ATOMIC_ACQUIRE);
+        pthread_mutex_unlock(&shard->latch);
+
+        // Never wait for a page latch while holding others: write the batch first
+        if (pthread_rwlock_tryrdlock(&frame->latch) != 0)
+        {
+            if (numRequests > 0)
+            {
+                rc = writeFlushBatch(bm, requests, numRequests);
+                numRequests = 0;
+            }
+            pthread_rwlock_rdlock(&frame->latch);
+        }
+
+        SM_IORequest *request = &requests[numRequests++];
+        request->pageNum = frame->pageNum;
+        request->memPage = frame->data;
+        request->isWrite = 1;
+        request->callback = NULL;
+        request->context = NULL;
+        if (numRequests == BM_CLEANER_BATCH || rc != RC_OK)
+        {
+            RC rcBatch = writeFlushBatch(bm, requests, numRequests);
+            rc = (rc != RC_OK) ? rc : rcBatch;
+            numRequests = 0;
+        }
+    }
+    if (numRequests > 0)
+    {
+        rc = writeFlushBatch(bm, requests, numRequests);
+    }
+
+    // Make the writes durable, including those of earlier evictions
+    if (rc == RC_OK)
+    {
+        pthread_mutex_lock(&mgmtData->fileLatch);
+        rc = forceBlocks(&mgmtData->fileHandle);
+        pthread_mutex_unlock(&mgmtData->fileLatch);
+    }
+    return rc;
+}
+
+// Buffer Manager Interface Access Rings
+
+BM_AccessRing *createAccessRing(BM_BufferPool *const bm, int numFrames)
+{
+    // A ring never takes more than a quarter of the buffer pool
+    if (numFrames > bm->numPages / 4)
+    {
+        numFrames = bm->numPages / 4;
+    }
+    if (numFrames < 1)
+    {
+        numFrames = 1;
+    }
+
+    BM_AccessRing *ring = (BM_AccessRing *)malloc(sizeof(BM_AccessRing));
+    ring->numFrames = numFrames;
+    ring->next = 0;
+    ring->frames = (int *)malloc(numFrames * sizeof(int));
+    ring->pages = (PageNumber *)malloc(numFrames * sizeof(PageNumber));
+    for (int i = 0; i < numFrames; i++)
+    {
+        ring->frames[i] = -1;
+        ring->pages[i] = NO_PAGE;
+    }
+
+    return ring;
+}
+
+void freeAccessRing(BM_AccessRing *ring)
+{
+    if (ring == NULL)
+    {
+        return;
+    }
+    free(ring->frames);
+    free(ring->pages);
+    free(ring);
+}
+
+// Pin a page through a ring, the caller holds the latch of the page's shard
+static RC pinPageWithRingLocked(BM_BufferPool *const bm, BM_SHARD *shard, BM_AccessRing *ring, BM_PageHandle *const page, const PageNumber pageNum)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    int frameIndex = findLoadedFrame(mgmtData, shard, pageNum);
+
+    if (frameIndex != -1)
+    {
+        // Repeated pins of a page the ring read do not make it look hot to the replacement strategy
+        if (ringOwnsFrame(ring, frameIndex))
+        {
+            return pinResidentFrame(mgmtData, page, frameIndex);
+        }
+        // A page read ahead for the ring takes the place of the next slot's frame
+        if (mgmtData->frames[frameIndex].prefetched)
+        {
+            int slot = ring->next;
+            ring->next = (ring->next + 1) % ring->numFrames;
+            ring->frames[slot] = frameIndex;
+            ring->pages[slot] = pageNum;
+            return pinResidentFrame(mgmtData, page, frameIndex);
+        }
+        return pinPageLocked(bm, shard, page, pageNum);
+    }
+
+    // Reuse the frame of the next ring slot, as long as it belongs to the page's shard, still holds the ring's page,
+    // and is not pinned
+    int slot = ring->next;
+    ring->next = (ring->next + 1) % ring->numFrames;
+    frameIndex = ring->frames[slot];
+    if (frameIndex >= shard->firstFrame && frameIndex < shard->firstFrame + shard->numFrames &&
+        mgmtData->frames[frameIndex].pageNum == ring->pages[slot] &&
+        __atomic_load_n(&mgmtData->frames[frameIndex].fixCount, __ATOMIC_ACQUIRE) == 0)
+    {
+        RC rc = pinPageIntoFrame(bm, shard, page, pageNum, frameIndex);
+        ring->pages[slot] = (rc == RC_OK) ? pageNum : NO_PAGE;
+        return rc;
+    }
+
+    // Otherwise let the replacement strategy pick a frame and add it to the ring
+    RC rc = pinPageLocked(bm, shard, page, pageNum);
+    if (rc == RC_OK)
+    {
+        ring->frames[slot] = findFrame(mgmtData, pageNum);
+        ring->pages[slot] = pageNum;
+    }
+    return rc;
+}
+
+RC pinPageWithRing(BM_BufferPool *const bm, BM_AccessRing *ring, BM_PageHandle *const page, const PageNumber pageNum)
+{
+    // Without a ring, pin the page like any other page
+    if (ring == NULL)
+    {
+        return pinPage(bm, page, pageNum);
+    }
+    // Check if buffer pool is not existing
+    if (bm == NULL || bm->mgmtData == NULL)
+    {
+        return RC_BUFFER_POOL_NOT_EXISTING;
+    }
     // Check for invalid page number
     if (pageNum < 0)
     {
         return RC_READ_NON_EXISTING_PAGE;
     }
-    switch (bm->strategy)
-    {
-    case RS_FIFO:
-        return pinPageUsingFIFO(bm, page, pageNum);
-    case RS_LRU:
-        return pinPageUsingLRU(bm, page, pageNum);
-    case RS_LRU_K:
-        return pinPageUsingLRU_K(bm, page, pageNum);
-    default:
-        return RC_INVALID_REPLACEMENT_STRATEGY;
-    }
+
+    BM_SHARD *shard = shardOf((BM_MGMT_DATA *)bm->mgmtData, pageNum);
+    pthread_mutex_lock(&shard->latch);
+    RC rc = pinPageWithRingLocked(bm, shard, ring, page, pageNum);
+    pthread_mutex_unlock(&shard->latch);
+
+    return rc;
 }
 
 // Statistics Interface
@@ -295,11 +787,13 @@ PageNumber *getFrameContents(BM_BufferPool *const bm) // returns an array of pag
     int POS = 0;                                                   // Creates integer to store POSITION
     int NUMPAG = bm->numPages;                                     // Creates integer which stores number of pages
 
+    lockAllShards(mgmtData);
     while (POS < NUMPAG) // While loop iterates NUMPAG times
     {
         ARR[POS] = frames[POS].pageNum; // Array stores the pagenumber
         POS = POS + 1;                  // Increment position
     }
+    unlockAllShards(mgmtData);
     return ARR; // Return the array
 }
 
@@ -315,11 +809,13 @@ bool *getDirtyFlags(BM_BufferPool *const bm) // returns an array of bools whose
     PAGE_FRAME *frames = mgmtData->frames;                 //  Creates frames of type PAGE_FRAME to store the frames from the buffer pool
     int POS = 0;                                           //  Creates integer to store POSITION
     int NUMPAG = bm->numPages;                             //  Creates integer which stores number of pages
+    lockAllShards(mgmtData);
     while (POS < NUMPAG)                                   // While loop iterates NUMPAG times
     {
         DARR[POS] = frames[POS].isDirty;
         POS = POS + 1; //  Position is incremented
     }
+    unlockAllShards(mgmtData);
     return DARR; // Array is returned
 }
 
@@ -336,11 +832,13 @@ int *getFixCounts(BM_BufferPool *const bm) // returns an array of ints whose ith
     int POS = 0;                                           //  Creates integer to store POSITION
     int NUMPAG = bm->numPages;                             //  Creates integer which stores number of pages
 
+    lockAllShards(mgmtData);
     while (POS < NUMPAG) // While loop iterates NUMPAG times
     {
         FIXARR[POS] = frames[POS].fixCount; //  Array stores appropriate fixCount
         POS = POS + 1;                      //  Position is incremented
     }
+    unlockAllShards(mgmtData);
     return FIXARR; // Array is returned
 }
 
@@ -352,7 +850,7 @@ int getNumReadIO(BM_BufferPool *const bm) // returns the number of pages that ha
         return RC_BUFFER_POOL_NOT_EXISTING;
     }
     BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData; // bufferpool's data is stored in mgmtData
-    return mgmtData->numReadIO;                            // return READPAGES
+    return __atomic_load_n(&mgmtData->numReadIO, __ATOMIC_RELAXED); // return READPAGES
 }
 
 int getNumWriteIO(BM_BufferPool *const bm) // returns the number of pages written to the page file since the buffer pool has been initialized
@@ -363,5 +861,5 @@ int getNumWriteIO(BM_BufferPool *const bm) // returns the number of pages writte
         return RC_BUFFER_POOL_NOT_EXISTING;
     }
     BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData; // bufferpool's data is stored in mgmtData
-    return mgmtData->numWriteIO;                           // return WRITTENPAGES
+    return __atomic_load_n(&mgmtData->numWriteIO, __ATOMIC_RELAXED); // return WRITTENPAGES
 }
\ No newline at end of file
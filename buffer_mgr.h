@@ -7,6 +7,11 @@
 // Include bool DT
 #include "dt.h"
 
+// Include the page file handle
+#include "storage_mgr.h"
+
+#include <pthread.h>
+
 // Replacement Strategies
 typedef enum ReplacementStrategy
 {
@@ -21,21 +26,102 @@ typedef enum ReplacementStrategy
 typedef int PageNumber;
 #define NO_PAGE -1
 
+// Makes a write-ahead log durable up to the record at lsn
+typedef RC (*BM_FlushLog) (void *log, long lsn);
+
+// A frame only holds pages of its shard, and its page only changes under the shard latch
 typedef struct PAGE_FRAME
 {
 	PageNumber pageNum;
 	char *data;
 	bool isDirty;
-	int fixCount;
+	int fixCount;		   // changed atomically: pins hold the shard latch, unpins do not
 	int recentAccessCount; // for LRU
+	bool referenced;	   // for CLOCK, set on every access and cleared by the clock hand
+	int numPins;		   // number of pins of the frame, changed under the shard latch (see the page cleaner)
+	bool ioPending;		   // the page is being read ahead, pins wait for the read to finish
+	bool prefetched;	   // the page was read ahead and has not been pinned since
+	long pageLSN;		   // log position of the last change of the page, see setPageLSN; accessed atomically
+	long recLSN;		   // log position of the oldest change not written to the page file yet, 0 if none; accessed atomically
+	pthread_rwlock_t latch; // protects the page contents, see latchPage
 } PAGE_FRAME;
 
+// maximum number of shards of a pool, and minimum number of frames per shard
+#ifndef BM_MAX_SHARDS
+#define BM_MAX_SHARDS 64
+#endif
+#define BM_MIN_SHARD_FRAMES 64
+
+// maximum number of pages waiting to be read ahead
+#define BM_PREFETCH_QUEUE_SIZE 256
+
+// maximum number of pages read ahead or written back by the page cleaner with one batch of transfers
+#define BM_PREFETCH_BATCH 32
+#define BM_CLEANER_BATCH 32
+
+// Partition of a buffer pool: a page is buffered by the shard its page number hashes to,
+// in one of the shard's frames. The shard latch protects the shard's part of the page table,
+// its free frames, its replacement state, and the pages held by its frames.
+typedef struct BM_SHARD
+{
+	pthread_mutex_t latch;
+	int firstFrame;	   // the shard owns frames firstFrame to firstFrame + numFrames - 1
+	int numFrames;
+	int queueHead;	   // for FIFO
+	int clockHand;	   // for CLOCK, next frame to be examined for replacement
+	int numFreeFrames; // the free frames are on the stack at freeFrames + firstFrame
+	pthread_cond_t ioDone; // signalled under the shard latch when a read-ahead of a page of the shard finishes
+} BM_SHARD;
+
 typedef struct BM_MGMT_DATA
 {
+	pthread_mutex_t fileLatch; // serializes the use of fileHandle
+	SM_FileHandle fileHandle;  // page file, open for the lifetime of the pool
 	PAGE_FRAME *frames;
-	int numReadIO;
-	int numWriteIO;
-	int queueHead; // for FIFO
+	char *frameArena;	   // page buffers of all frames, frame i uses frameArena + i * PAGE_SIZE
+	size_t frameArenaSize; // size of the mapping backing frameArena
+	int numReadIO;		   // updated atomically
+	int numWriteIO;		   // updated atomically
+	BM_SHARD *shards;
+	int numShards; // a power of two, small pools have a single shard
+
+	// for LRU-K: the last K access times of every buffered page, newest first (0 = no access)
+	int lruK;				  // number of accesses remembered per page, set through stratData
+	long accessTime;		  // logical time, advanced atomically on every pin
+	long *frameHistory;		  // access times of the page in frame i at frameHistory[i * lruK]
+	PageNumber *historyPages; // pages whose access times are retained after their eviction
+	long *retainedHistory;	  // access times of historyPages[j] at retainedHistory[j * lruK]
+
+	// page table: hash map from page number to frame index; bucket b belongs to shard b % numShards
+	int *pageTable;		// first frame of each hash bucket, -1 if empty
+	int *pageTableNext; // next frame in the same bucket, per frame
+	int pageTableMask;	// number of buckets - 1, the bucket count is a power of two
+
+	int *freeFrames; // stacks of frames that do not hold a page yet, one per shard
+
+	// background page cleaner, see startPageCleaner
+	int numDirtyFrames;			  // updated atomically
+	int dirtyHighWater;			  // the cleaner runs once more frames than this are dirty, read atomically
+	bool cleanerRunning;		  // read and written atomically
+	bool stopCleaner;			  // tells the cleaner thread to exit, set under cleanerLatch
+	int cleanerShard;			  // shard the next cleaning pass starts with
+	pthread_t cleaner;
+	pthread_mutex_t cleanerLatch; // held by the cleaner during a cleaning pass and by forceFlushPool
+	pthread_cond_t cleanerWakeup;
+
+	// read-ahead, see prefetchPages: a queue of pages served by a background thread
+	PageNumber prefetchQueue[BM_PREFETCH_QUEUE_SIZE];
+	int prefetchHead;			   // next queued page
+	int numPrefetchPages;		   // number of queued pages
+	bool prefetcherRunning;		   // the thread is started by the first prefetchPages
+	bool stopPrefetcher;
+	pthread_t prefetcher;
+	pthread_mutex_t prefetchLatch; // protects the queue and the fields above
+	pthread_cond_t prefetchWakeup;
+
+	// write-ahead log, see setWriteAheadLog; NULL flushLog if pages are written without one
+	BM_FlushLog flushLog;
+	void *log;
 } BM_MGMT_DATA;
 
 typedef struct BM_BufferPool
@@ -53,6 +139,17 @@ typedef struct BM_PageHandle
 	char *data;
 } BM_PageHandle;
 
+// Small private ring of frames for sequential scans: pages a scan reads
+// are recycled within the ring instead of evicting the shared working set.
+// Frames of pages read ahead join the ring when the ring pins them.
+typedef struct BM_AccessRing
+{
+	int numFrames;	   // number of slots in the ring
+	int next;		   // next slot to be reused
+	int *frames;	   // frame used by each slot, -1 if the slot is unused
+	PageNumber *pages; // page the ring read into each slot's frame
+} BM_AccessRing;
+
 // convenience macros
 #define MAKE_POOL() \
 	((BM_BufferPool *)malloc(sizeof(BM_BufferPool)))
@@ -60,7 +157,11 @@ typedef struct BM_PageHandle
 #define MAKE_PAGE_HANDLE() \
 	((BM_PageHandle *)malloc(sizeof(BM_PageHandle)))
 
+// default K for RS_LRU_K when no stratData is given
+#define DEFAULT_LRU_K 2
+
 // Buffer Manager Interface Pool Handling
+// For RS_LRU_K, stratData may point to an int holding K
 RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
 				  const int numPages, ReplacementStrategy strategy,
 				  void *stratData);
@@ -74,6 +175,48 @@ RC forcePage(BM_BufferPool *const bm, BM_PageHandle *const page);
 RC pinPage(BM_BufferPool *const bm, BM_PageHandle *const page,
 		   const PageNumber pageNum);
 
+// Buffer Manager Interface Latches
+// The contents of a pinned page are read under a shared latch and modified under an exclusive one;
+// pages are only latched while pinned, so eviction never waits for a latch
+RC latchPage(BM_BufferPool *const bm, BM_PageHandle *const page, bool exclusive);
+RC unlatchPage(BM_BufferPool *const bm, BM_PageHandle *const page);
+
+// Buffer Manager Interface Page Cleaner
+// A background thread writes dirty unpinned pages back whenever more than dirtyHighWater frames
+// are dirty (a quarter of the frames if dirtyHighWater is negative), starting with the next victims
+// of the replacement strategy, until half that number is left, so pins rarely wait for a write
+#define BM_CLEANER_INTERVAL_MS 10 // the cleaner also checks the dirty frames this often
+RC startPageCleaner(BM_BufferPool *const bm, int dirtyHighWater);
+RC stopPageCleaner(BM_BufferPool *const bm);
+
+// Buffer Manager Interface Read-Ahead
+// Queue pages first to first + count - 1 to be read into the pool by a background thread, so later pins
+// find them resident. Pages that are already buffered or behind the end of the file are skipped, and pages
+// are dropped when the queue is full. A pin of a page that is being read waits for the read.
+RC prefetchPages(BM_BufferPool *const bm, const PageNumber first, int count);
+
+// Buffer Manager Interface Write-Ahead Logging
+// Once a log is set, a page is only written to the page file after flushLog(log, lsn) made the log durable up to
+// the LSN last set for the page, so no change reaches the page file before its log record. The LSN of a page
+// is reset when the page is read into a frame; pages without one are written as before.
+RC setWriteAheadLog(BM_BufferPool *const bm, BM_FlushLog flushLog, void *log);
+RC setPageLSN(BM_BufferPool *const bm, BM_PageHandle *const page, long lsn);
+
+// Buffer Manager Interface Checkpoints
+// getDirtyPageTable first waits for the changes in progress, which hold their page latches, then returns the pages
+// with logged changes not written to the page file yet, each with the LSN of the oldest of them (its recLSN).
+// pages and recLSNs have room for one entry per frame. flushPages writes those of the given pages that still hold
+// such changes back, in the given order and in batches, while other threads keep using the pool, then syncs the
+// page file, so everything logged before the pages' recLSNs is durable in the page file.
+RC getDirtyPageTable(BM_BufferPool *const bm, PageNumber *pages, long *recLSNs, int *numPages);
+RC flushPages(BM_BufferPool *const bm, const PageNumber *pages, int numPages);
+
+// Buffer Manager Interface Access Rings
+BM_AccessRing *createAccessRing(BM_BufferPool *const bm, int numFrames);
+void freeAccessRing(BM_AccessRing *ring);
+RC pinPageWithRing(BM_BufferPool *const bm, BM_AccessRing *ring,
+				   BM_PageHandle *const page, const PageNumber pageNum);
+
 // Statistics Interface
 PageNumber *getFrameContents(BM_BufferPool *const bm);
 bool *getDirtyFlags(BM_BufferPool *const bm);
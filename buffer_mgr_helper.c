@@ -6,64 +6,428 @@
  */
 
 #include <limits.h>
+#include <sys/mman.h>
+#include <time.h>
 #include "buffer_mgr.h"
 #include "storage_mgr.h"
 
-extern char *getPageFromFile(BM_BufferPool *const bm, const PageNumber pageNum)
+extern RC readPageFromFile(BM_BufferPool *const bm, const PageNumber pageNum, char *pageData)
 {
-    SM_FileHandle fileHandle;
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    SM_FileHandle *fileHandle = &mgmtData->fileHandle;
+    RC rc;
 
-    // Open the page file
-    if (openPageFile(bm->pageFile, &fileHandle) != RC_OK)
+    // Pages behind the end of the file are created as empty pages, then read the page into the frame
+    pthread_mutex_lock(&mgmtData->fileLatch);
+    if ((rc = ensureCapacity(pageNum + 1, fileHandle)) != RC_OK ||
+        (rc = readBlock(pageNum, fileHandle, pageData)) != RC_OK)
     {
-        printf("Error opening page file for reading.\n");
-        return NULL;
+        printf("Error reading page from file.\n");
     }
+    pthread_mutex_unlock(&mgmtData->fileLatch);
+
+    return rc;
+}
 
-    // Allocate memory for the page data
-    char *pageData = (char *)malloc(PAGE_SIZE);
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
 
-    // Read the page from the file
-    if (readBlock(pageNum, &fileHandle, pageData) != RC_OK)
+// Map one contiguous, page aligned arena holding the page buffers of all frames.
+// Large arenas are backed by transparent huge pages; compile with -DBM_HUGETLB to try explicit huge pages first.
+extern RC allocFrameArena(BM_MGMT_DATA *mgmtData, int numPages)
+{
+    size_t size = (size_t)numPages * PAGE_SIZE;
+    void *arena = MAP_FAILED;
+
+#ifdef BM_HUGETLB
+    // Explicit huge pages need a size rounded up to the huge page size
+    size_t hugeSize = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    arena = mmap(NULL, hugeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (arena != MAP_FAILED)
     {
-        printf("Error reading page from file.\n");
-        free(pageData);
-        return NULL;
+        size = hugeSize;
     }
+#endif
 
-    // Close the page file
-    if (closePageFile(&fileHandle) != RC_OK)
+    if (arena == MAP_FAILED)
     {
-        printf("Error closing page file after reading.\n");
+        arena = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (arena == MAP_FAILED)
+        {
+            return RC_ERROR;
+        }
+#ifdef MADV_HUGEPAGE
+        if (size >= HUGE_PAGE_SIZE)
+        {
+            madvise(arena, size, MADV_HUGEPAGE);
+        }
+#endif
     }
 
-    return pageData;
+    mgmtData->frameArena = (char *)arena;
+    mgmtData->frameArenaSize = size;
+
+    return RC_OK;
 }
 
-extern int findPage_LRU(const PAGE_FRAME *frames, int numFrames, PageNumber targetPageNum)
+extern void freeFrameArena(BM_MGMT_DATA *mgmtData)
 {
-    int frameIndex = -1;                  // Set the frame index to -1 if the page is not found in the buffer pool
-    int leastRecentAccessCount = INT_MAX; // Set the least recent access count to the maximum integer value
+    munmap(mgmtData->frameArena, mgmtData->frameArenaSize);
+    mgmtData->frameArena = NULL;
+}
 
-    // Find the target page in the buffer pool
-    for (int i = 0; i < numFrames; i++)
+// Hash a page number to a bucket of the page table (multiplicative hashing)
+static int hashPageNum(const BM_MGMT_DATA *mgmtData, PageNumber pageNum)
+{
+    unsigned int hash = (unsigned int)pageNum * 2654435769u;
+    return (int)((hash ^ (hash >> 16)) & (unsigned int)mgmtData->pageTableMask);
+}
+
+// Shard buffering a page. The shard is given by the low bits of the page's page table bucket,
+// so every bucket chain only links frames of one shard.
+extern BM_SHARD *shardOf(const BM_MGMT_DATA *mgmtData, PageNumber pageNum)
+{
+    return &mgmtData->shards[hashPageNum(mgmtData, pageNum) & (mgmtData->numShards - 1)];
+}
+
+// Split the frames of a pool into contiguous shards: as many as BM_MAX_SHARDS allows while every
+// shard keeps at least BM_MIN_SHARD_FRAMES frames, so small pools have a single shard
+extern void initShards(BM_MGMT_DATA *mgmtData, int numPages)
+{
+    int numShards = 1;
+    while (2 * numShards <= BM_MAX_SHARDS && numPages / (2 * numShards) >= BM_MIN_SHARD_FRAMES)
     {
-        // If the page is found in the buffer pool, update the frame index
-        if (frames[i].pageNum == targetPageNum || frames[i].pageNum == NO_PAGE)
+        numShards *= 2;
+    }
+
+    mgmtData->numShards = numShards;
+    mgmtData->shards = (BM_SHARD *)malloc(numShards * sizeof(BM_SHARD));
+    for (int s = 0; s < numShards; s++)
+    {
+        BM_SHARD *shard = &mgmtData->shards[s];
+        pthread_mutex_init(&shard->latch, NULL);
+        pthread_cond_init(&shard->ioDone, NULL);
+        shard->firstFrame = (int)((long)s * numPages / numShards);
+        shard->numFrames = (int)((long)(s + 1) * numPages / numShards) - shard->firstFrame;
+        shard->queueHead = shard->firstFrame; // Initialize queue head to the first frame -> FIFO Strategy
+        shard->clockHand = shard->firstFrame; // Initialize clock hand to the first frame -> CLOCK Strategy
+        shard->numFreeFrames = shard->numFrames;
+    }
+}
+
+extern void freeShards(BM_MGMT_DATA *mgmtData)
+{
+    for (int s = 0; s < mgmtData->numShards; s++)
+    {
+        pthread_mutex_destroy(&mgmtData->shards[s].latch);
+        pthread_cond_destroy(&mgmtData->shards[s].ioDone);
+    }
+    free(mgmtData->shards);
+}
+
+// Latch every shard in order, for operations on the whole pool
+extern void lockAllShards(BM_MGMT_DATA *mgmtData)
+{
+    for (int s = 0; s < mgmtData->numShards; s++)
+    {
+        pthread_mutex_lock(&mgmtData->shards[s].latch);
+    }
+}
+
+extern void unlockAllShards(BM_MGMT_DATA *mgmtData)
+{
+    for (int s = mgmtData->numShards - 1; s >= 0; s--)
+    {
+        pthread_mutex_unlock(&mgmtData->shards[s].latch);
+    }
+}
+
+static int getFixCount(const PAGE_FRAME *frame)
+{
+    return __atomic_load_n(&frame->fixCount, __ATOMIC_ACQUIRE);
+}
+
+// Pin the page in a frame, the caller holds the latch of the frame's shard
+static void fixFrame(PAGE_FRAME *frame)
+{
+    __atomic_add_fetch(&frame->fixCount, 1, __ATOMIC_ACQUIRE);
+    frame->numPins++;
+    frame->prefetched = false;
+}
+
+// Mark the page in a frame dirty and wake the page cleaner up once the high-water mark is crossed
+static void markFrameDirty(BM_MGMT_DATA *mgmtData, PAGE_FRAME *frame)
+{
+    if (__atomic_exchange_n(&frame->isDirty, true, __ATOMIC_ACQ_REL))
+    {
+        return;
+    }
+
+    int numDirty = __atomic_add_fetch(&mgmtData->numDirtyFrames, 1, __ATOMIC_RELAXED);
+    if (__atomic_load_n(&mgmtData->cleanerRunning, __ATOMIC_ACQUIRE) &&
+        numDirty == __atomic_load_n(&mgmtData->dirtyHighWater, __ATOMIC_RELAXED) + 1)
+    {
+        pthread_cond_signal(&mgmtData->cleanerWakeup);
+    }
+}
+
+static void clearFrameDirty(BM_MGMT_DATA *mgmtData, PAGE_FRAME *frame)
+{
+    if (__atomic_exchange_n(&frame->isDirty, false, __ATOMIC_ACQ_REL))
+    {
+        __atomic_sub_fetch(&mgmtData->numDirtyFrames, 1, __ATOMIC_RELAXED);
+    }
+}
+
+// Allocate the page table and the free frame stacks of the shards for a pool of numPages frames
+extern void initPageTable(BM_MGMT_DATA *mgmtData, int numPages)
+{
+    // Use at least twice as many buckets as frames to keep the chains short, and at least one per shard
+    int numBuckets = 1;
+    while (numBuckets < 2 * numPages || numBuckets < mgmtData->numShards)
+    {
+        numBuckets <<= 1;
+    }
+
+    mgmtData->pageTable = (int *)malloc(numBuckets * sizeof(int));
+    mgmtData->pageTableNext = (int *)malloc(numPages * sizeof(int));
+    mgmtData->pageTableMask = numBuckets - 1;
+    for (int i = 0; i < numBuckets; i++)
+    {
+        mgmtData->pageTable[i] = -1;
+    }
+
+    // Push the frames of each shard in reverse order so that they are handed out starting at its first frame
+    mgmtData->freeFrames = (int *)malloc(numPages * sizeof(int));
+    for (int i = 0; i < numPages; i++)
+    {
+        mgmtData->pageTableNext[i] = -1;
+    }
+    for (int s = 0; s < mgmtData->numShards; s++)
+    {
+        BM_SHARD *shard = &mgmtData->shards[s];
+        for (int i = 0; i < shard->numFrames; i++)
         {
-            // Update the frame index
-            if (frames[i].recentAccessCount < leastRecentAccessCount)
-            {
-                // Update the least recent access count
-                leastRecentAccessCount = frames[i].recentAccessCount;
-                frameIndex = i;
-            }
+            mgmtData->freeFrames[shard->firstFrame + i] = shard->firstFrame + shard->numFrames - 1 - i;
+        }
+    }
+}
+
+extern void freePageTable(BM_MGMT_DATA *mgmtData)
+{
+    free(mgmtData->pageTable);
+    free(mgmtData->pageTableNext);
+    free(mgmtData->freeFrames);
+}
+
+// Find the frame holding a page, -1 if the page is not in the buffer pool
+extern int findFrame(const BM_MGMT_DATA *mgmtData, PageNumber pageNum)
+{
+    int frameIndex = mgmtData->pageTable[hashPageNum(mgmtData, pageNum)];
+
+    // Walk the bucket chain until the page is found
+    while (frameIndex != -1 && mgmtData->frames[frameIndex].pageNum != pageNum)
+    {
+        frameIndex = mgmtData->pageTableNext[frameIndex];
+    }
+
+    return frameIndex;
+}
+
+// Find the frame holding a page of a shard once the page is readable, waiting for a read-ahead of the page
+// to finish; -1 if the page is not in the buffer pool. The caller holds the shard latch.
+extern int findLoadedFrame(BM_MGMT_DATA *mgmtData, BM_SHARD *shard, PageNumber pageNum)
+{
+    int frameIndex = findFrame(mgmtData, pageNum);
+
+    // A failed read-ahead drops the page again, so look it up after every wait
+    while (frameIndex != -1 && mgmtData->frames[frameIndex].ioPending)
+    {
+        pthread_cond_wait(&shard->ioDone, &shard->latch);
+        frameIndex = findFrame(mgmtData, pageNum);
+    }
+
+    return frameIndex;
+}
+
+// Take a frame of a shard that does not hold a page yet, -1 if all its frames are in use
+extern int takeFreeFrame(BM_MGMT_DATA *mgmtData, BM_SHARD *shard)
+{
+    if (shard->numFreeFrames == 0)
+    {
+        return -1;
+    }
+    return mgmtData->freeFrames[shard->firstFrame + --shard->numFreeFrames];
+}
+
+// Frame holding the page of a handle: a pinned page's data points into its frame, so the page table is only
+// searched for handles that do not point into the frame arena. -1 if the page is not in the buffer pool.
+extern int findPinnedFrame(BM_BufferPool *const bm, const BM_PageHandle *page)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+
+    if (page->data >= mgmtData->frameArena && page->data < mgmtData->frameArena + (size_t)bm->numPages * PAGE_SIZE)
+    {
+        int frameIndex = (int)((page->data - mgmtData->frameArena) / PAGE_SIZE);
+        if (__atomic_load_n(&mgmtData->frames[frameIndex].pageNum, __ATOMIC_ACQUIRE) == page->pageNum)
+        {
+            return frameIndex;
         }
     }
 
+    BM_SHARD *shard = shardOf(mgmtData, page->pageNum);
+    pthread_mutex_lock(&shard->latch);
+    int frameIndex = findFrame(mgmtData, page->pageNum);
+    pthread_mutex_unlock(&shard->latch);
     return frameIndex;
 }
 
+// Remove the page held by a frame from the page table
+static void removeFromPageTable(BM_MGMT_DATA *mgmtData, int frameIndex)
+{
+    PageNumber pageNum = mgmtData->frames[frameIndex].pageNum;
+    if (pageNum == NO_PAGE)
+    {
+        return;
+    }
+
+    // Unlink the frame from its bucket chain
+    int *link = &mgmtData->pageTable[hashPageNum(mgmtData, pageNum)];
+    while (*link != -1 && *link != frameIndex)
+    {
+        link = &mgmtData->pageTableNext[*link];
+    }
+    if (*link == frameIndex)
+    {
+        *link = mgmtData->pageTableNext[frameIndex];
+    }
+    mgmtData->pageTableNext[frameIndex] = -1;
+}
+
+// Let a frame hold a new page and update the page table accordingly
+extern void assignFrame(BM_MGMT_DATA *mgmtData, int frameIndex, PageNumber pageNum)
+{
+    if (mgmtData->frames[frameIndex].pageNum == pageNum)
+    {
+        return;
+    }
+
+    removeFromPageTable(mgmtData, frameIndex);
+    __atomic_store_n(&mgmtData->frames[frameIndex].pageNum, pageNum, __ATOMIC_RELEASE);
+    __atomic_store_n(&mgmtData->frames[frameIndex].pageLSN, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&mgmtData->frames[frameIndex].recLSN, 0, __ATOMIC_RELAXED);
+
+    // Add the frame to the front of the bucket chain of the new page
+    int bucket = hashPageNum(mgmtData, pageNum);
+    mgmtData->pageTableNext[frameIndex] = mgmtData->pageTable[bucket];
+    mgmtData->pageTable[bucket] = frameIndex;
+}
+
+// Allocate the LRU-K access history of all frames and the retained history of evicted pages
+extern void initLRUKHistory(BM_MGMT_DATA *mgmtData, int numPages, int k)
+{
+    int numRetained = mgmtData->pageTableMask + 1; // as many entries as page table buckets
+
+    mgmtData->lruK = (k > 0) ? k : DEFAULT_LRU_K;
+    mgmtData->accessTime = 0;
+    mgmtData->frameHistory = (long *)calloc((size_t)numPages * mgmtData->lruK, sizeof(long));
+    mgmtData->historyPages = (PageNumber *)malloc(numRetained * sizeof(PageNumber));
+    mgmtData->retainedHistory = (long *)calloc((size_t)numRetained * mgmtData->lruK, sizeof(long));
+    for (int i = 0; i < numRetained; i++)
+    {
+        mgmtData->historyPages[i] = NO_PAGE;
+    }
+}
+
+extern void freeLRUKHistory(BM_MGMT_DATA *mgmtData)
+{
+    if (mgmtData->lruK == 0)
+    {
+        return;
+    }
+    free(mgmtData->frameHistory);
+    free(mgmtData->historyPages);
+    free(mgmtData->retainedHistory);
+}
+
+// Record an access to the page in a frame: shift its history and store the current time as the newest access
+static void recordLRUKAccess(BM_MGMT_DATA *mgmtData, int frameIndex)
+{
+    long *history = &mgmtData->frameHistory[frameIndex * mgmtData->lruK];
+
+    memmove(history + 1, history, (mgmtData->lruK - 1) * sizeof(long));
+    history[0] = __atomic_add_fetch(&mgmtData->accessTime, 1, __ATOMIC_RELAXED);
+}
+
+// Move the history of a frame's page into the retained history before the page is evicted.
+// The retained history is direct mapped, so the history of another page in the same entry is dropped.
+static void retainLRUKHistory(BM_MGMT_DATA *mgmtData, int frameIndex)
+{
+    PageNumber pageNum = mgmtData->frames[frameIndex].pageNum;
+    if (pageNum == NO_PAGE)
+    {
+        return;
+    }
+
+    int entry = hashPageNum(mgmtData, pageNum);
+    mgmtData->historyPages[entry] = pageNum;
+    memcpy(&mgmtData->retainedHistory[entry * mgmtData->lruK], &mgmtData->frameHistory[frameIndex * mgmtData->lruK],
+           mgmtData->lruK * sizeof(long));
+}
+
+// Give a frame the retained history of the page loaded into it, or an empty history if there is none
+static void restoreLRUKHistory(BM_MGMT_DATA *mgmtData, int frameIndex, PageNumber pageNum)
+{
+    long *history = &mgmtData->frameHistory[frameIndex * mgmtData->lruK];
+    int entry = hashPageNum(mgmtData, pageNum);
+
+    if (mgmtData->historyPages[entry] == pageNum)
+    {
+        memcpy(history, &mgmtData->retainedHistory[entry * mgmtData->lruK], mgmtData->lruK * sizeof(long));
+        mgmtData->historyPages[entry] = NO_PAGE;
+    }
+    else
+    {
+        memset(history, 0, mgmtData->lruK * sizeof(long));
+    }
+}
+
+// Find the unpinned frame of a shard with the largest backward K-distance, i.e. the oldest K-th most recent access.
+// Pages with fewer than K accesses have an infinite distance; ties are broken by the least recent access.
+extern int findLRUKVictim(const BM_MGMT_DATA *mgmtData, const BM_SHARD *shard)
+{
+    int victimIndex = -1;
+    long victimKthAccess = LONG_MAX;
+    long victimLastAccess = LONG_MAX;
+
+    for (int i = shard->firstFrame; i < shard->firstFrame + shard->numFrames; i++)
+    {
+        if (getFixCount(&mgmtData->frames[i]) != 0)
+        {
+            continue;
+        }
+
+        const long *history = &mgmtData->frameHistory[i * mgmtData->lruK];
+        long kthAccess = history[mgmtData->lruK - 1];
+        if (kthAccess < victimKthAccess || (kthAccess == victimKthAccess && history[0] < victimLastAccess))
+        {
+            victimIndex = i;
+            victimKthAccess = kthAccess;
+            victimLastAccess = history[0];
+        }
+    }
+
+    return victimIndex;
+}
+
+// Drop the page held by a frame and return the frame to the free frame stack of its shard
+extern void releaseFrame(BM_MGMT_DATA *mgmtData, BM_SHARD *shard, int frameIndex)
+{
+    removeFromPageTable(mgmtData, frameIndex);
+    __atomic_store_n(&mgmtData->frames[frameIndex].pageNum, NO_PAGE, __ATOMIC_RELEASE);
+    clearFrameDirty(mgmtData, &mgmtData->frames[frameIndex]);
+    mgmtData->freeFrames[shard->firstFrame + shard->numFreeFrames++] = frameIndex;
+}
+
 extern int findLRUVictim(const PAGE_FRAME *frames, int numFrames)
 {
     int victimIndex = -1;                 // Set the victim index to -1 if no victim is found
@@ -72,7 +436,7 @@ extern int findLRUVictim(const PAGE_FRAME *frames, int numFrames)
     for (int i = 0; i < numFrames; i++)
     {
         // If the frame is not pinned, and has the least recent access count, update the victim index
-        if (frames[i].fixCount == 0 && frames[i].recentAccessCount < leastRecentAccessCount)
+        if (getFixCount(&frames[i]) == 0 && frames[i].recentAccessCount < leastRecentAccessCount)
         {
             // Update the least recent access count
             leastRecentAccessCount = frames[i].recentAccessCount;
@@ -83,28 +447,117 @@ extern int findLRUVictim(const PAGE_FRAME *frames, int numFrames)
     return victimIndex;
 }
 
-extern void writePageToFile(BM_BufferPool *const bm, const PAGE_FRAME *frame)
+// Make the write-ahead log durable up to a page LSN before the page is written
+static RC flushLogUpTo(BM_MGMT_DATA *mgmtData, long lsn)
 {
-    SM_FileHandle fileHandle;
+    if (mgmtData->flushLog == NULL || lsn == 0)
+    {
+        return RC_OK;
+    }
+    return mgmtData->flushLog(mgmtData->log, lsn);
+}
 
-    // Open the page file
-    if (openPageFile(bm->pageFile, &fileHandle) != RC_OK)
+// Write the page of a frame back, after the log up to its LSN. The caller only marks the frame clean if this
+// succeeds, a page that could not be written stays dirty in its frame.
+extern RC writePageToFile(BM_BufferPool *const bm, PAGE_FRAME *frame)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    RC rc;
+
+    // The log records of the page's changes go first
+    if ((rc = flushLogUpTo(mgmtData, __atomic_load_n(&frame->pageLSN, __ATOMIC_RELAXED))) != RC_OK)
     {
-        printf("Error opening page file for writing.\n");
-        return;
+        return rc;
     }
 
     // Write the page to the file
-    if (writeBlock(frame->pageNum, &fileHandle, frame->data) != RC_OK)
+    pthread_mutex_lock(&mgmtData->fileLatch);
+    rc = writeBlock(frame->pageNum, &mgmtData->fileHandle, frame->data);
+    pthread_mutex_unlock(&mgmtData->fileLatch);
+    if (rc != RC_OK)
     {
-        printf("Error writing page to file.\n");
+        return rc;
+    }
+    __atomic_store_n(&frame->recLSN, 0, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&mgmtData->numWriteIO, 1, __ATOMIC_RELAXED);
+    return RC_OK;
+}
+
+// Replace the page held by a frame of a shard with a page read from disk, writing the old page back first if dirty
+static RC loadFrame(BM_BufferPool *const bm, BM_SHARD *shard, int frameIndex, const PageNumber pageNum)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    PAGE_FRAME *frame = &mgmtData->frames[frameIndex];
+    RC rc;
+
+    // Write the victim page back to disk if dirty, the pin fails and the victim keeps its page if that fails
+    if (frame->isDirty)
+    {
+        if ((rc = writePageToFile(bm, frame)) != RC_OK)
+        {
+            return rc;
+        }
+        clearFrameDirty(mgmtData, frame);
+    }
+
+    // Read the new page into the frame
+    if ((rc = readPageFromFile(bm, pageNum, frame->data)) != RC_OK)
+    {
+        releaseFrame(mgmtData, shard, frameIndex);
+        return rc;
+    }
+    __atomic_add_fetch(&mgmtData->numReadIO, 1, __ATOMIC_RELAXED);
+
+    assignFrame(mgmtData, frameIndex, pageNum);
+
+    return RC_OK;
+}
+
+// Check if a frame currently holds a page read through a ring
+extern bool ringOwnsFrame(const BM_AccessRing *ring, int frameIndex)
+{
+    for (int i = 0; i < ring->numFrames; i++)
+    {
+        if (ring->frames[i] == frameIndex)
+        {
+            return true;
+        }
     }
+    return false;
+}
+
+// Pin the page in a frame without touching the state of the replacement strategy
+extern RC pinResidentFrame(BM_MGMT_DATA *mgmtData, BM_PageHandle *const page, int frameIndex)
+{
+    fixFrame(&mgmtData->frames[frameIndex]);
+    page->pageNum = mgmtData->frames[frameIndex].pageNum;
+    page->data = mgmtData->frames[frameIndex].data;
+    return RC_OK;
+}
 
-    // Close the page file
-    if (closePageFile(&fileHandle) != RC_OK)
+// Read a page into a given unpinned frame and pin it, bypassing the replacement strategy's victim choice.
+// The frame keeps its old recency, so it stays an early victim for the strategy as well.
+extern RC pinPageIntoFrame(BM_BufferPool *const bm, BM_SHARD *shard, BM_PageHandle *const page, const PageNumber pageNum, int frameIndex)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+
+    if (mgmtData->lruK != 0)
     {
-        printf("Error closing page file after writing.\n");
+        retainLRUKHistory(mgmtData, frameIndex);
     }
+
+    RC rc = loadFrame(bm, shard, frameIndex, pageNum);
+    if (rc != RC_OK)
+    {
+        return rc;
+    }
+
+    if (mgmtData->lruK != 0)
+    {
+        restoreLRUKHistory(mgmtData, frameIndex, pageNum);
+    }
+
+    return pinResidentFrame(mgmtData, page, frameIndex);
 }
 
 extern void updateLRUList(PAGE_FRAME *frames, int numFrames, int accessedFrameIndex)
@@ -124,48 +577,61 @@ extern void updateLRUList(PAGE_FRAME *frames, int numFrames, int accessedFrameIn
     frames[accessedFrameIndex].recentAccessCount = highestAccessCount + 1;
 }
 
-extern int findPage_FIFO(PAGE_FRAME *frames, int numPages, PageNumber pageNum)
+// Next frame of a shard in round robin order
+static int nextShardFrame(const BM_SHARD *shard, int frameIndex)
 {
-    // Find the target page in the buffer pool
-    int frameIndex = -1;
-    // Find the target page in the buffer pool
-    for (int i = 0; i < numPages; i++)
-    {
-        // If the page is found in the buffer pool, update the frame index
-        if (frames[i].pageNum == pageNum || frames[i].pageNum == NO_PAGE)
-        {
-            // Update the frame index
-            frameIndex = i;
-            break;
-        }
-    }
-
-    return frameIndex;
+    return shard->firstFrame + (frameIndex - shard->firstFrame + 1) % shard->numFrames;
 }
 
-extern int findVictimPage_FIFO(BM_MGMT_DATA *const mgmtData, PAGE_FRAME *frames, int numPages)
+extern int findVictimPage_FIFO(BM_SHARD *const shard, PAGE_FRAME *frames)
 {
     // Find the victim page using FIFO strategy
     int frameIndex = NO_PAGE;
     // Find the victim page using FIFO strategy
-    int i = (mgmtData->queueHead + 1) % numPages;
+    int i = nextShardFrame(shard, shard->queueHead);
 
     // Find the first frame with fix count 0 -> Kind of a Round Robin approach
-    while (mgmtData->queueHead != i)
+    while (shard->queueHead != i)
     {
-        if (frames[i].fixCount == 0)
+        if (getFixCount(&frames[i]) == 0)
         {
             frameIndex = i;
             break;
         }
-        i = (i + 1) % numPages;
+        i = nextShardFrame(shard, i);
     }
 
     return frameIndex;
 }
 
+extern int findVictimPage_CLOCK(BM_SHARD *const shard, PAGE_FRAME *frames)
+{
+    // Sweep the clock hand over the frames of the shard, giving referenced frames a second chance.
+    // Two rounds are enough: the first one clears all reference bits of unpinned frames.
+    for (int i = 0; i < 2 * shard->numFrames; i++)
+    {
+        int frameIndex = shard->clockHand;
+        shard->clockHand = nextShardFrame(shard, shard->clockHand);
+
+        if (getFixCount(&frames[frameIndex]) == 0)
+        {
+            // Unreferenced and unpinned frames are replaced
+            if (!frames[frameIndex].referenced)
+            {
+                return frameIndex;
+            }
+            frames[frameIndex].referenced = false;
+        }
+    }
+
+    // All frames are pinned
+    return -1;
+}
+
+// The replacement strategies pin a page with the latch of its shard held, and only use the frames of that shard
+
 // FIFO Replacement Strategy
-extern RC pinPageUsingFIFO(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum)
+extern RC pinPageUsingFIFO(BM_BufferPool *const bm, BM_SHARD *shard, BM_PageHandle *const page, const PageNumber pageNum)
 {
     // Check if buffer pool is not existing
     if (bm == NULL || bm->mgmtData == NULL)
@@ -176,60 +642,48 @@ extern RC pinPageUsingFIFO(BM_BufferPool *const bm, BM_PageHandle *const page, c
     // Get the management data from the buffer pool
     BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
     PAGE_FRAME *frames = mgmtData->frames;
-    int numPages = bm->numPages;
 
-    // Find an available frame using FIFO strategy
-    int frameIndex = findPage_FIFO(frames, numPages, pageNum);
+    // Find the target page in the buffer pool
+    int frameIndex = findLoadedFrame(mgmtData, shard, pageNum);
 
+    // If the page is not in the buffer pool, read it into an empty frame or a victim frame
     if (frameIndex == -1)
     {
-        frameIndex = findVictimPage_FIFO(mgmtData, frames, numPages); // Find a victim page using FIFO strategy
+        frameIndex = takeFreeFrame(mgmtData, shard);
+        if (frameIndex == -1)
+        {
+            frameIndex = findVictimPage_FIFO(shard, frames); // Find a victim page using FIFO strategy
+        }
         if (frameIndex == -1)
         {
-            // printf("Error: No available frame.\n");
-            getFrameContents(bm);
             return RC_NO_AVAILABLE_FRAME;
         }
 
-        // Write the victim page back to disk if dirty
-        if (frames[frameIndex].isDirty)
+        RC rc = loadFrame(bm, shard, frameIndex, pageNum);
+        if (rc != RC_OK)
         {
-            BM_PageHandle pageHandle;
-            pageHandle.pageNum = frames[frameIndex].pageNum;
-            pageHandle.data = frames[frameIndex].data;
-            forcePage(bm, &pageHandle);
+            return rc;
         }
-    }
 
-    // Update read count if the page is not already in the buffer pool
-    if (frames[frameIndex].pageNum != pageNum)
-    {
-        mgmtData->numReadIO++;
+        // The newly loaded page is the last one in the queue
+        shard->queueHead = frameIndex;
     }
 
-    // Update the page handle with the pinned page information
-    mgmtData->queueHead = (frameIndex) % numPages;
-
-    // Get the page from the file
-    frames[frameIndex].data = getPageFromFile(bm, pageNum);
+    // Increment fix count
+    fixFrame(&frames[frameIndex]);
 
     // Update the page handle with the pinned page information
     page->pageNum = pageNum;
     page->data = frames[frameIndex].data;
 
-    // Update the frame with the new page information
-    frames[frameIndex].pageNum = pageNum;
-    frames[frameIndex].isDirty = false;
-    frames[frameIndex].fixCount++;
-
     return RC_OK;
 }
 
 // LRU Replacement Strategy
-extern RC pinPageUsingLRU(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum)
+extern RC pinPageUsingLRU(BM_BufferPool *const bm, BM_SHARD *shard, BM_PageHandle *const page, const PageNumber pageNum)
 {
     // Check if buffer pool is not existing
-    if (bm == NULL)
+    if (bm == NULL || bm->mgmtData == NULL)
     {
         return RC_BUFFER_POOL_NOT_EXISTING;
     }
@@ -239,134 +693,534 @@ extern RC pinPageUsingLRU(BM_BufferPool *const bm, BM_PageHandle *const page, co
     PAGE_FRAME *frames = mgmtData->frames;
 
     // Find the target page in the buffer pool
-    int frameIndex = findPage_LRU(mgmtData->frames, bm->numPages, pageNum);
+    int frameIndex = findLoadedFrame(mgmtData, shard, pageNum);
 
-    // If the page is found in the buffer pool
-    if (frameIndex != -1)
+    // If the page is not in the buffer pool, read it into an empty frame or a victim frame
+    if (frameIndex == -1)
     {
-        // Update page handle with existing page information
-        frames[frameIndex].data = getPageFromFile(bm, pageNum);
+        frameIndex = takeFreeFrame(mgmtData, shard);
+        if (frameIndex == -1)
+        {
+            frameIndex = findLRUVictim(frames + shard->firstFrame, shard->numFrames); // Find a victim frame using the LRU strategy
+            if (frameIndex != -1)
+            {
+                frameIndex += shard->firstFrame;
+            }
+        }
+        if (frameIndex == -1)
+        {
+            return RC_NO_AVAILABLE_FRAME;
+        }
 
-        // Update the page handle with the pinned page information
-        page->pageNum = pageNum;
-        page->data = frames[frameIndex].data;
+        RC rc = loadFrame(bm, shard, frameIndex, pageNum);
+        if (rc != RC_OK)
+        {
+            return rc;
+        }
+    }
 
-        // Update the frame with the new page information
-        frames[frameIndex].pageNum = pageNum;
-        frames[frameIndex].isDirty = false;
-        // Increment fix count
-        frames[frameIndex].fixCount++;
-        // Move the page to the front of the LRU list (update accessCount)
-        updateLRUList(mgmtData->frames, bm->numPages, frameIndex);
+    // Increment fix count
+    fixFrame(&frames[frameIndex]);
+    // Move the page to the front of the LRU list (update accessCount)
+    updateLRUList(frames + shard->firstFrame, shard->numFrames, frameIndex - shard->firstFrame);
 
-        // Increment read count if the page is not already in the buffer pool
-        mgmtData->numReadIO++;
+    // Update the page handle with the pinned page information
+    page->pageNum = pageNum;
+    page->data = frames[frameIndex].data;
 
-        return RC_OK;
+    return RC_OK;
+}
+
+// LRU-K Replacement Strategy
+extern RC pinPageUsingLRU_K(BM_BufferPool *const bm, BM_SHARD *shard, BM_PageHandle *const page, const PageNumber pageNum)
+{
+    // Check if buffer pool is not existing
+    if (bm == NULL || bm->mgmtData == NULL)
+    {
+        return RC_BUFFER_POOL_NOT_EXISTING;
     }
 
-    // If the page is not found in the buffer pool
-    // Find a victim frame using the LRU strategy
-    frameIndex = findLRUVictim(mgmtData->frames, bm->numPages);
+    // Get the management data from the buffer pool
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)(bm->mgmtData);
+    PAGE_FRAME *frames = mgmtData->frames;
+
+    // Find the target page in the buffer pool
+    int frameIndex = findLoadedFrame(mgmtData, shard, pageNum);
 
-    // If a victim frame is found
-    if (frameIndex != -1)
+    // If the page is not in the buffer pool, read it into an empty frame or a victim frame
+    if (frameIndex == -1)
     {
-        // Write back the victim page if dirty
-        if (mgmtData->frames[frameIndex].isDirty)
+        frameIndex = takeFreeFrame(mgmtData, shard);
+        if (frameIndex == -1)
         {
-            // Write the dirty page back to disk
-            writePageToFile(bm, &mgmtData->frames[frameIndex]);
-            mgmtData->numWriteIO++;
+            frameIndex = findLRUKVictim(mgmtData, shard); // Find a victim frame using the LRU-K strategy
+        }
+        if (frameIndex == -1)
+        {
+            return RC_NO_AVAILABLE_FRAME;
         }
 
-        // Update the victim frame with the new page information
-        mgmtData->frames[frameIndex].pageNum = pageNum;
-        mgmtData->frames[frameIndex].isDirty = false;
-        mgmtData->frames[frameIndex].fixCount = 1;
-        mgmtData->frames[frameIndex].data = getPageFromFile(bm, pageNum);
-        // mgmtData->numReadIO++;
-
-        // Update page handle with the new page information
-        page->pageNum = pageNum;
-        page->data = mgmtData->frames[frameIndex].data;
+        // Keep the history of the evicted page, in case it is accessed again soon
+        retainLRUKHistory(mgmtData, frameIndex);
 
-        // Move the page to the front of the LRU list (update accessCount)
-        updateLRUList(mgmtData->frames, bm->numPages, frameIndex);
+        RC rc = loadFrame(bm, shard, frameIndex, pageNum);
+        if (rc != RC_OK)
+        {
+            return rc;
+        }
 
-        return RC_OK;
+        restoreLRUKHistory(mgmtData, frameIndex, pageNum);
     }
 
-    return RC_NO_AVAILABLE_FRAME;
+    // Increment fix count
+    fixFrame(&frames[frameIndex]);
+    // Add this access to the page's history
+    recordLRUKAccess(mgmtData, frameIndex);
+
+    // Update the page handle with the pinned page information
+    page->pageNum = pageNum;
+    page->data = frames[frameIndex].data;
+
+    return RC_OK;
 }
 
-extern RC pinPageUsingLRU_K(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum)
+// CLOCK Replacement Strategy
+extern RC pinPageUsingCLOCK(BM_BufferPool *const bm, BM_SHARD *shard, BM_PageHandle *const page, const PageNumber pageNum)
 {
     // Check if buffer pool is not existing
-    if (bm == NULL)
+    if (bm == NULL || bm->mgmtData == NULL)
     {
         return RC_BUFFER_POOL_NOT_EXISTING;
     }
 
     // Get the management data from the buffer pool
-    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)(bm->mgmtData);
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
     PAGE_FRAME *frames = mgmtData->frames;
 
     // Find the target page in the buffer pool
-    int frameIndex = findPage_LRU(mgmtData->frames, bm->numPages, pageNum);
+    int frameIndex = findLoadedFrame(mgmtData, shard, pageNum);
 
-    // If the page is found in the buffer pool
-    if (frameIndex != -1)
+    // If the page is not in the buffer pool, read it into an empty frame or a victim frame
+    if (frameIndex == -1)
     {
-        // Update page handle with existing page information
-        frames[frameIndex].data = getPageFromFile(bm, pageNum);
+        frameIndex = takeFreeFrame(mgmtData, shard);
+        if (frameIndex == -1)
+        {
+            frameIndex = findVictimPage_CLOCK(shard, frames); // Find a victim frame using the CLOCK strategy
+        }
+        if (frameIndex == -1)
+        {
+            return RC_NO_AVAILABLE_FRAME;
+        }
 
-        // Update the page handle with the pinned page information
-        page->pageNum = pageNum;
-        page->data = frames[frameIndex].data;
+        RC rc = loadFrame(bm, shard, frameIndex, pageNum);
+        if (rc != RC_OK)
+        {
+            return rc;
+        }
+    }
 
-        // Update the frame with the new page information
-        frames[frameIndex].pageNum = pageNum;
-        frames[frameIndex].isDirty = false;
-        // Increment fix count
-        frames[frameIndex].fixCount++;
-        // Move the page to the front of the LRU list (update accessCount)
-        updateLRUList(mgmtData->frames, bm->numPages, frameIndex);
+    // Increment fix count and set the reference bit
+    fixFrame(&frames[frameIndex]);
+    frames[frameIndex].referenced = true;
 
-        mgmtData->numReadIO++;
+    // Update the page handle with the pinned page information
+    page->pageNum = pageNum;
+    page->data = frames[frameIndex].data;
 
-        return RC_OK;
+    return RC_OK;
+}
+
+
+// Background Page Cleaner
+
+// First frame of a shard the replacement strategy looks at for its next victim
+static int nextVictimPosition(BM_BufferPool *const bm, const BM_SHARD *shard)
+{
+    switch (bm->strategy)
+    {
+    case RS_FIFO:
+        return nextShardFrame(shard, shard->queueHead);
+    case RS_CLOCK:
+        return shard->clockHand;
+    default:
+        return shard->firstFrame; // LRU and LRU-K have no position, the cleaner just sweeps the shard
+    }
+}
+
+// Write a batch of frames of a shard back with one batch of transfers. The caller holds the shard latch, which is
+// released during the writes; the cleaner pins the frames and holds their page latches meanwhile, so they keep
+// their pages and writers holding the page latch do not change them. Anyone else pinning a page during the write
+// may change it after it was marked clean, so the page is then marked dirty again, as are pages that failed to write.
+static void writeCleanBatch(BM_BufferPool *const bm, BM_SHARD *shard, SM_IORequest *requests, const int *numPins, int numRequests)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    long lsn = 0;
+
+    pthread_mutex_unlock(&shard->latch);
+
+    // Flush the log once for the whole batch, a page that still cannot be written fails below
+    for (int i = 0; i < numRequests; i++)
+    {
+        long pageLSN = __atomic_load_n(&mgmtData->frames[(requests[i].memPage - mgmtData->frameArena) / PAGE_SIZE].pageLSN, __ATOMIC_RELAXED);
+        lsn = (pageLSN > lsn) ? pageLSN : lsn;
+    }
+    if (flushLogUpTo(mgmtData, lsn) == RC_OK)
+    {
+        transferBlocks(&mgmtData->fileHandle, requests, numRequests);
+    }
+    else
+    {
+        for (int i = 0; i < numRequests; i++)
+        {
+            requests[i].rc = RC_WRITE_FAILED;
+        }
+    }
+    pthread_mutex_lock(&shard->latch);
+
+    for (int i = 0; i < numRequests; i++)
+    {
+        PAGE_FRAME *frame = &mgmtData->frames[(requests[i].memPage - mgmtData->frameArena) / PAGE_SIZE];
+        if (requests[i].rc == RC_OK)
+        {
+            __atomic_store_n(&frame->recLSN, 0, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&mgmtData->numWriteIO, 1, __ATOMIC_RELAXED);
+        }
+        else
+        {
+            printf("Error writing page to file.\n");
+        }
+        pthread_rwlock_unlock(&frame->latch);
+        if (requests[i].rc != RC_OK || frame->numPins != numPins[i])
+        {
+            markFrameDirty(mgmtData, frame);
+        }
+        __atomic_sub_fetch(&frame->fixCount, 1, __ATOMIC_RELEASE);
+    }
+}
+
+// Write a batch of frames back for flushPages. The caller pinned the frames and holds their page latches, so their
+// pages do not change during the write; the latches are released and the frames unpinned afterwards. A writer
+// that changed a page before the latch was taken marks it dirty again after it was marked clean here, at worst.
+static RC writeFlushBatch(BM_BufferPool *const bm, SM_IORequest *requests, int numRequests)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    long lsn = 0;
+    RC rc = RC_OK;
+
+    for (int i = 0; i < numRequests; i++)
+    {
+        long pageLSN = __atomic_load_n(&mgmtData->frames[(requests[i].memPage - mgmtData->frameArena) / PAGE_SIZE].pageLSN, __ATOMIC_RELAXED);
+        lsn = (pageLSN > lsn) ? pageLSN : lsn;
     }
+    if ((rc = flushLogUpTo(mgmtData, lsn)) == RC_OK &&
+        (rc = transferBlocks(&mgmtData->fileHandle, requests, numRequests)) != RC_OK)
+    {
+        printf("Error writing page to file.\n");
+    }
+
+    for (int i = 0; i < numRequests; i++)
+    {
+        PAGE_FRAME *frame = &mgmtData->frames[(requests[i].memPage - mgmtData->frameArena) / PAGE_SIZE];
+        if (rc == RC_OK && (rc = requests[i].rc) == RC_OK)
+        {
+            __atomic_store_n(&frame->recLSN, 0, __ATOMIC_RELAXED);
+            clearFrameDirty(mgmtData, frame);
+            __atomic_add_fetch(&mgmtData->numWriteIO, 1, __ATOMIC_RELAXED);
+        }
+        pthread_rwlock_unlock(&frame->latch);
+        __atomic_sub_fetch(&frame->fixCount, 1, __ATOMIC_RELEASE);
+    }
+    return rc;
+}
 
-    // If the page is not found in the buffer pool
-    // Find a victim frame using the LRU strategy
-    frameIndex = findLRUVictim(mgmtData->frames, bm->numPages);
+// Write dirty unpinned pages back until no more than half the high-water mark of frames is dirty.
+// Every shard is cleaned starting at its next victims, and each pass starts with the next shard.
+// The caller holds the cleaner latch.
+static void cleanPool(BM_BufferPool *const bm)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    int lowWater = __atomic_load_n(&mgmtData->dirtyHighWater, __ATOMIC_RELAXED) / 2;
+    SM_IORequest requests[BM_CLEANER_BATCH];
+    int numPins[BM_CLEANER_BATCH];
 
-    // If a victim frame is found
-    if (frameIndex != -1)
+    for (int s = 0; s < mgmtData->numShards && __atomic_load_n(&mgmtData->numDirtyFrames, __ATOMIC_RELAXED) > lowWater; s++)
     {
-        // Write back the victim page if dirty
-        if (mgmtData->frames[frameIndex].isDirty)
+        BM_SHARD *shard = &mgmtData->shards[(mgmtData->cleanerShard + s) % mgmtData->numShards];
+        int numRequests = 0;
+        pthread_mutex_lock(&shard->latch);
+
+        // Collect the dirty frames in replacement order, writing them back whenever the batch is full.
+        // A page latch held by someone else is not waited for, so the cleaner never waits holding page latches.
+        int frameIndex = nextVictimPosition(bm, shard);
+        for (int i = 0; i < shard->numFrames && __atomic_load_n(&mgmtData->numDirtyFrames, __ATOMIC_RELAXED) > lowWater; i++)
         {
-            writePageToFile(bm, &mgmtData->frames[frameIndex]);
-            mgmtData->numWriteIO++;
+            PAGE_FRAME *frame = &mgmtData->frames[frameIndex];
+            frameIndex = nextShardFrame(shard, frameIndex);
+            if (frame->pageNum == NO_PAGE || !__atomic_load_n(&frame->isDirty, __ATOMIC_ACQUIRE) || getFixCount(frame) != 0 ||
+                pthread_rwlock_tryrdlock(&frame->latch) != 0)
+            {
+                continue;
+            }
+
+            __atomic_add_fetch(&frame->fixCount, 1, __ATOMIC_ACQUIRE);
+            numPins[numRequests] = frame->numPins;
+            clearFrameDirty(mgmtData, frame);
+
+            SM_IORequest *request = &requests[numRequests++];
+            request->pageNum = frame->pageNum;
+            request->memPage = frame->data;
+            request->isWrite = 1;
+            request->callback = NULL;
+            request->context = NULL;
+            if (numRequests == BM_CLEANER_BATCH)
+            {
+                writeCleanBatch(bm, shard, requests, numPins, numRequests);
+                numRequests = 0;
+            }
+        }
+        if (numRequests > 0)
+        {
+            writeCleanBatch(bm, shard, requests, numPins, numRequests);
         }
 
-        // Update the victim frame with the new page information
-        mgmtData->frames[frameIndex].pageNum = pageNum;
-        mgmtData->frames[frameIndex].isDirty = false;
-        mgmtData->frames[frameIndex].fixCount = 1;
-        mgmtData->frames[frameIndex].data = getPageFromFile(bm, pageNum);
+        pthread_mutex_unlock(&shard->latch);
+    }
 
-        // Update page handle with the new page information
-        page->pageNum = pageNum;
-        page->data = mgmtData->frames[frameIndex].data;
+    mgmtData->cleanerShard = (mgmtData->cleanerShard + 1) % mgmtData->numShards;
+}
 
-        // Move the page to the front of the LRU list (update accessCount)
-        updateLRUList(mgmtData->frames, bm->numPages, frameIndex);
+// Main loop of the cleaner thread: clean the pool whenever the high-water mark is exceeded,
+// checking every BM_CLEANER_INTERVAL_MS and whenever markFrameDirty crosses the mark
+static void *pageCleanerMain(void *arg)
+{
+    BM_BufferPool *bm = (BM_BufferPool *)arg;
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
 
-        return RC_OK;
+    pthread_mutex_lock(&mgmtData->cleanerLatch);
+    while (!mgmtData->stopCleaner)
+    {
+        if (__atomic_load_n(&mgmtData->numDirtyFrames, __ATOMIC_RELAXED) > __atomic_load_n(&mgmtData->dirtyHighWater, __ATOMIC_RELAXED))
+        {
+            cleanPool(bm);
+        }
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += BM_CLEANER_INTERVAL_MS * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        pthread_cond_timedwait(&mgmtData->cleanerWakeup, &mgmtData->cleanerLatch, &deadline);
     }
+    pthread_mutex_unlock(&mgmtData->cleanerLatch);
+
+    return NULL;
+}
+
 
-    return RC_NO_AVAILABLE_FRAME;
-}
\ No newline at end of file
+// Read-Ahead
+
+// Give a page about to be read ahead a frame of its shard, as a pin of the page would, and account for the
+// access in the replacement strategy. -1 if all frames of the shard are pinned. The caller holds the shard latch.
+static int reserveFrame(BM_BufferPool *const bm, BM_SHARD *shard, PageNumber pageNum)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    PAGE_FRAME *frames = mgmtData->frames;
+
+    int frameIndex = takeFreeFrame(mgmtData, shard);
+    if (frameIndex == -1)
+    {
+        switch (bm->strategy)
+        {
+        case RS_FIFO:
+            frameIndex = findVictimPage_FIFO(shard, frames);
+            break;
+        case RS_LRU:
+            frameIndex = findLRUVictim(frames + shard->firstFrame, shard->numFrames);
+            frameIndex = (frameIndex != -1) ? frameIndex + shard->firstFrame : -1;
+            break;
+        case RS_CLOCK:
+            frameIndex = findVictimPage_CLOCK(shard, frames);
+            break;
+        case RS_LRU_K:
+            frameIndex = findLRUKVictim(mgmtData, shard);
+            break;
+        default:
+            break;
+        }
+    }
+    if (frameIndex == -1)
+    {
+        return -1;
+    }
+
+    // Write the victim page back to disk if dirty, the page is not read ahead if that fails
+    if (frames[frameIndex].isDirty)
+    {
+        if (writePageToFile(bm, &frames[frameIndex]) != RC_OK)
+        {
+            return -1;
+        }
+        clearFrameDirty(mgmtData, &frames[frameIndex]);
+    }
+
+    if (mgmtData->lruK != 0)
+    {
+        retainLRUKHistory(mgmtData, frameIndex);
+    }
+    assignFrame(mgmtData, frameIndex, pageNum);
+
+    switch (bm->strategy)
+    {
+    case RS_FIFO:
+        shard->queueHead = frameIndex;
+        break;
+    case RS_LRU:
+        updateLRUList(frames + shard->firstFrame, shard->numFrames, frameIndex - shard->firstFrame);
+        break;
+    case RS_CLOCK:
+        frames[frameIndex].referenced = true;
+        break;
+    case RS_LRU_K:
+        restoreLRUKHistory(mgmtData, frameIndex, pageNum);
+        recordLRUKAccess(mgmtData, frameIndex);
+        break;
+    default:
+        break;
+    }
+
+    return frameIndex;
+}
+
+// Finish the read-ahead of a page: let pins of the page proceed, or drop the page if the read failed
+static void finishPrefetch(SM_IORequest *request)
+{
+    BM_BufferPool *bm = (BM_BufferPool *)request->context;
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    int frameIndex = (int)((request->memPage - mgmtData->frameArena) / PAGE_SIZE);
+    PAGE_FRAME *frame = &mgmtData->frames[frameIndex];
+    BM_SHARD *shard = shardOf(mgmtData, request->pageNum);
+
+    pthread_mutex_lock(&shard->latch);
+    frame->ioPending = false;
+    __atomic_sub_fetch(&frame->fixCount, 1, __ATOMIC_RELEASE);
+    if (request->rc == RC_OK)
+    {
+        __atomic_add_fetch(&mgmtData->numReadIO, 1, __ATOMIC_RELAXED);
+    }
+    else
+    {
+        releaseFrame(mgmtData, shard, frameIndex);
+    }
+    pthread_cond_broadcast(&shard->ioDone);
+    pthread_mutex_unlock(&shard->latch);
+}
+
+// Read pages ahead into frames of their shards with one batch of transfers. The shard latches are not held
+// during the reads: the frames are pinned meanwhile and marked as pending, so pins of the pages wait in
+// findLoadedFrame until finishPrefetch is called for their page.
+static void prefetchBatch(BM_BufferPool *const bm, const PageNumber *pages, int numPages)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    SM_IORequest requests[BM_PREFETCH_BATCH];
+    int numRequests = 0;
+
+    // Only pages of the file are read ahead, the file does not grow
+    pthread_mutex_lock(&mgmtData->fileLatch);
+    int fileSize = mgmtData->fileHandle.totalNumPages;
+    pthread_mutex_unlock(&mgmtData->fileLatch);
+
+    for (int i = 0; i < numPages; i++)
+    {
+        PageNumber pageNum = pages[i];
+        if (pageNum >= fileSize)
+        {
+            continue;
+        }
+
+        BM_SHARD *shard = shardOf(mgmtData, pageNum);
+        pthread_mutex_lock(&shard->latch);
+        int frameIndex = (findFrame(mgmtData, pageNum) == -1) ? reserveFrame(bm, shard, pageNum) : -1;
+        if (frameIndex != -1)
+        {
+            PAGE_FRAME *frame = &mgmtData->frames[frameIndex];
+            __atomic_add_fetch(&frame->fixCount, 1, __ATOMIC_ACQUIRE);
+            frame->ioPending = true;
+            frame->prefetched = true;
+
+            SM_IORequest *request = &requests[numRequests++];
+            request->pageNum = pageNum;
+            request->memPage = frame->data;
+            request->isWrite = 0;
+            request->callback = finishPrefetch;
+            request->context = bm;
+        }
+        pthread_mutex_unlock(&shard->latch);
+    }
+
+    if (numRequests > 0)
+    {
+        transferBlocks(&mgmtData->fileHandle, requests, numRequests);
+    }
+}
+
+// Main loop of the read-ahead thread: read the queued pages in order, in batches of up to a quarter
+// of the pool so that the pages in flight do not pin all frames, until the pool shuts down
+static void *prefetcherMain(void *arg)
+{
+    BM_BufferPool *bm = (BM_BufferPool *)arg;
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+    PageNumber pages[BM_PREFETCH_BATCH];
+    int maxBatch = (bm->numPages / 4 < BM_PREFETCH_BATCH) ? bm->numPages / 4 : BM_PREFETCH_BATCH;
+    if (maxBatch < 1)
+    {
+        maxBatch = 1;
+    }
+
+    pthread_mutex_lock(&mgmtData->prefetchLatch);
+    while (!mgmtData->stopPrefetcher)
+    {
+        if (mgmtData->numPrefetchPages == 0)
+        {
+            pthread_cond_wait(&mgmtData->prefetchWakeup, &mgmtData->prefetchLatch);
+            continue;
+        }
+
+        int numPages = 0;
+        while (numPages < maxBatch && mgmtData->numPrefetchPages > 0)
+        {
+            pages[numPages++] = mgmtData->prefetchQueue[mgmtData->prefetchHead];
+            mgmtData->prefetchHead = (mgmtData->prefetchHead + 1) % BM_PREFETCH_QUEUE_SIZE;
+            mgmtData->numPrefetchPages--;
+        }
+
+        pthread_mutex_unlock(&mgmtData->prefetchLatch);
+        prefetchBatch(bm, pages, numPages);
+        pthread_mutex_lock(&mgmtData->prefetchLatch);
+    }
+    pthread_mutex_unlock(&mgmtData->prefetchLatch);
+
+    return NULL;
+}
+
+// Stop the read-ahead thread, dropping the queued pages
+static void stopPrefetcher(BM_BufferPool *const bm)
+{
+    BM_MGMT_DATA *mgmtData = (BM_MGMT_DATA *)bm->mgmtData;
+
+    pthread_mutex_lock(&mgmtData->prefetchLatch);
+    if (!mgmtData->prefetcherRunning)
+    {
+        pthread_mutex_unlock(&mgmtData->prefetchLatch);
+        return;
+    }
+    mgmtData->stopPrefetcher = true;
+    mgmtData->numPrefetchPages = 0;
+    pthread_cond_signal(&mgmtData->prefetchWakeup);
+    pthread_mutex_unlock(&mgmtData->prefetchLatch);
+
+    pthread_join(mgmtData->prefetcher, NULL);
+    pthread_mutex_lock(&mgmtData->prefetchLatch);
+    mgmtData->prefetcherRunning = false;
+    pthread_mutex_unlock(&mgmtData->prefetchLatch);
+}
@@ -19,6 +19,7 @@ typedef int RC;
 #define RC_INVALID_REPLACEMENT_STRATEGY 7
 #define RC_TABLE_NOT_FOUND 8
 #define RC_TABLE_ALREADY_EXISTS 9
+#define RC_TABLE_IN_USE 10
 
 #define RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE 200
 #define RC_RM_EXPR_RESULT_IS_NOT_BOOLEAN 201
@@ -26,12 +27,15 @@ typedef int RC;
 #define RC_RM_NO_MORE_TUPLES 203
 #define RC_RM_NO_PRINT_FOR_DATATYPE 204
 #define RC_RM_UNKOWN_DATATYPE 205
+#define RC_RM_WRITE_CONFLICT 206 // another running transaction changed the tuple
 
 #define RC_IM_KEY_NOT_FOUND 300
 #define RC_IM_KEY_ALREADY_EXISTS 301
 #define RC_IM_N_TO_LAGE 302
 #define RC_IM_NO_MORE_ENTRIES 303
 
+#define RC_LOG_NO_MORE_RECORDS 400
+
 #define RC_ERROR 999
 
 /* holder for error messages */
@@ -1,5 +1,10 @@
 #include <string.h>
 #include <stdlib.h>
+#include <pthread.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define EXPR_X86_KERNELS
+#endif
 
 #include "dberror.h"
 #include "record_mgr.h"
@@ -74,6 +79,7 @@ boolAnd (Value *left, Value *right, Value *result)
 {
 	if (left->dt != DT_BOOL || right->dt != DT_BOOL)
 		THROW(RC_RM_BOOLEAN_EXPR_ARG_IS_NOT_BOOLEAN, "boolean AND requires boolean inputs");
+	result->dt = DT_BOOL;
 	result->v.boolV = (left->v.boolV && right->v.boolV);
 
 	return RC_OK;
@@ -84,6 +90,7 @@ boolOr (Value *left, Value *right, Value *result)
 {
 	if (left->dt != DT_BOOL || right->dt != DT_BOOL)
 		THROW(RC_RM_BOOLEAN_EXPR_ARG_IS_NOT_BOOLEAN, "boolean OR requires boolean inputs");
+	result->dt = DT_BOOL;
 	result->v.boolV = (left->v.boolV || right->v.boolV);
 
 	return RC_OK;
@@ -188,3 +195,467 @@ freeVal (Value *val)
 	free(val);
 }
 
+
+// compiled expressions
+
+// number of instructions an expression compiles to
+static int
+countInstrs (Expr *expr)
+{
+	if (expr->type != EXPR_OP)
+		return 1;
+	if (expr->expr.op->type == OP_BOOL_NOT)
+		return 1 + countInstrs(expr->expr.op->args[0]);
+	return 1 + countInstrs(expr->expr.op->args[0]) + countInstrs(expr->expr.op->args[1]);
+}
+
+// append the instructions of an expression in postfix order and return the type of its result
+static RC
+compileNode (Expr *expr, Schema *schema, ExprProgram *program, DataType *type)
+{
+	ExprInstr *instr;
+	DataType lType, rType;
+	RC rc;
+
+	switch(expr->type)
+	{
+	case EXPR_CONST:
+		instr = &program->instrs[program->numInstrs++];
+		instr->code = EXPR_PUSH_CONST;
+		instr->dt = expr->expr.cons->dt;
+		switch(instr->dt)
+		{
+		case DT_INT:
+			instr->value.v.intV = expr->expr.cons->v.intV;
+			break;
+		case DT_FLOAT:
+			instr->value.v.floatV = expr->expr.cons->v.floatV;
+			break;
+		case DT_BOOL:
+			instr->value.v.boolV = expr->expr.cons->v.boolV;
+			break;
+		case DT_STRING:
+			instr->value.v.stringV = expr->expr.cons->v.stringV;
+			instr->value.length = strlen(expr->expr.cons->v.stringV);
+			break;
+		}
+		*type = instr->dt;
+		return RC_OK;
+	case EXPR_ATTRREF:
+		if (schema == NULL || expr->expr.attrRef < 0 || expr->expr.attrRef >= schema->numAttr)
+			THROW(RC_ERROR, "attribute reference outside of the schema");
+		instr = &program->instrs[program->numInstrs++];
+		instr->code = EXPR_PUSH_ATTR;
+		instr->dt = schema->dataTypes[expr->expr.attrRef];
+		instr->offset = getAttributeOffset(schema, expr->expr.attrRef);
+		instr->value.length = schema->typeLength[expr->expr.attrRef];
+		*type = instr->dt;
+		return RC_OK;
+	case EXPR_OP:
+		break;
+	}
+
+	Operator *op = expr->expr.op;
+	if ((rc = compileNode(op->args[0], schema, program, &lType)) != RC_OK)
+		return rc;
+	if (op->type != OP_BOOL_NOT && (rc = compileNode(op->args[1], schema, program, &rType)) != RC_OK)
+		return rc;
+
+	instr = &program->instrs[program->numInstrs++];
+	instr->dt = lType;
+	switch(op->type)
+	{
+	case OP_COMP_EQUAL:
+	case OP_COMP_SMALLER:
+		if (lType != rType)
+			THROW(RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE, "comparison only supported for values of the same datatype");
+		instr->code = (op->type == OP_COMP_EQUAL) ? EXPR_EQUAL : EXPR_SMALLER;
+		break;
+	case OP_BOOL_NOT:
+		if (lType != DT_BOOL)
+			THROW(RC_RM_BOOLEAN_EXPR_ARG_IS_NOT_BOOLEAN, "boolean NOT requires boolean input");
+		instr->code = EXPR_NOT;
+		break;
+	case OP_BOOL_AND:
+	case OP_BOOL_OR:
+		if (lType != DT_BOOL || rType != DT_BOOL)
+			THROW(RC_RM_BOOLEAN_EXPR_ARG_IS_NOT_BOOLEAN, "boolean AND/OR requires boolean inputs");
+		instr->code = (op->type == OP_BOOL_AND) ? EXPR_AND : EXPR_OR;
+		break;
+	}
+
+	*type = DT_BOOL;
+	return RC_OK;
+}
+
+// recognize programs comparing an INT or FLOAT attribute with a constant
+static void
+compileFilter (ExprProgram *program)
+{
+	ExprInstr *instrs = program->instrs;
+	ExprInstr *attr, *cons;
+	bool attrLeft;
+
+	program->hasFilter = FALSE;
+	if (program->numInstrs != 3 || (instrs[2].code != EXPR_EQUAL && instrs[2].code != EXPR_SMALLER)
+			|| (instrs[2].dt != DT_INT && instrs[2].dt != DT_FLOAT))
+		return;
+
+	attrLeft = (instrs[0].code == EXPR_PUSH_ATTR);
+	attr = attrLeft ? &instrs[0] : &instrs[1];
+	cons = attrLeft ? &instrs[1] : &instrs[0];
+	if (attr->code != EXPR_PUSH_ATTR || cons->code != EXPR_PUSH_CONST)
+		return;
+
+	// const < attr is attr > const
+	if (instrs[2].code == EXPR_EQUAL)
+		program->filter.cmp = EXPR_CMP_EQUAL;
+	else
+		program->filter.cmp = attrLeft ? EXPR_CMP_SMALLER : EXPR_CMP_GREATER;
+	program->filter.dt = attr->dt;
+	program->filter.offset = attr->offset;
+	program->filter.value = cons->value;
+	program->hasFilter = TRUE;
+}
+
+RC
+compileExpr (Expr *expr, Schema *schema, ExprProgram **program)
+{
+	DataType type;
+	RC rc;
+	int numInstrs = countInstrs(expr);
+
+	*program = (ExprProgram *) malloc(sizeof(ExprProgram));
+	(*program)->instrs = (ExprInstr *) calloc(numInstrs, sizeof(ExprInstr));
+	(*program)->numInstrs = 0;
+	(*program)->hasFilter = FALSE;
+	// the stack never holds more values than there are instructions
+	(*program)->stack = (ExprSlot *) malloc(numInstrs * sizeof(ExprSlot));
+
+	rc = compileNode(expr, schema, *program, &type);
+	if (rc == RC_OK && type != DT_BOOL)
+	{
+		RC_message = "condition does not evaluate to a boolean";
+		rc = RC_RM_EXPR_RESULT_IS_NOT_BOOLEAN;
+	}
+
+	if (rc != RC_OK)
+	{
+		freeProgram(*program);
+		*program = NULL;
+		return rc;
+	}
+
+	compileFilter(*program);
+	return RC_OK;
+}
+
+// compare two strings of the given maximum lengths like strcmp
+static int
+compareStrings (const ExprSlot *left, const ExprSlot *right)
+{
+	int lLen = strnlen(left->v.stringV, left->length);
+	int rLen = strnlen(right->v.stringV, right->length);
+	int cmp = memcmp(left->v.stringV, right->v.stringV, (lLen < rLen) ? lLen : rLen);
+
+	return (cmp != 0) ? cmp : lLen - rLen;
+}
+
+bool
+evalProgram (ExprProgram *program, char *data)
+{
+	ExprSlot *top = program->stack - 1;
+	ExprInstr *instr = program->instrs;
+	ExprInstr *end = program->instrs + program->numInstrs;
+
+	for (; instr < end; instr++)
+	{
+		switch(instr->code)
+		{
+		case EXPR_PUSH_ATTR:
+			top++;
+			switch(instr->dt)
+			{
+			case DT_INT:
+				memcpy(&top->v.intV, data + instr->offset, sizeof(int));
+				break;
+			case DT_FLOAT:
+				memcpy(&top->v.floatV, data + instr->offset, sizeof(float));
+				break;
+			case DT_BOOL:
+				memcpy(&top->v.boolV, data + instr->offset, sizeof(bool));
+				break;
+			case DT_STRING:
+				top->v.stringV = data + instr->offset;
+				top->length = instr->value.length;
+				break;
+			}
+			break;
+		case EXPR_PUSH_CONST:
+			*++top = instr->value;
+			break;
+		case EXPR_EQUAL:
+		case EXPR_SMALLER:
+		{
+			ExprSlot *left = top - 1;
+			bool equal = (instr->code == EXPR_EQUAL);
+			switch(instr->dt)
+			{
+			case DT_INT:
+				left->v.boolV = equal ? (left->v.intV == top->v.intV) : (left->v.intV < top->v.intV);
+				break;
+			case DT_FLOAT:
+				left->v.boolV = equal ? (left->v.floatV == top->v.floatV) : (left->v.floatV < top->v.floatV);
+				break;
+			case DT_BOOL:
+				left->v.boolV = equal ? (left->v.boolV == top->v.boolV) : (left->v.boolV < top->v.boolV);
+				break;
+			case DT_STRING:
+			{
+				int cmp = compareStrings(left, top);
+				left->v.boolV = equal ? (cmp == 0) : (cmp < 0);
+			}
+			break;
+			}
+			top--;
+		}
+		break;
+		case EXPR_AND:
+			top[-1].v.boolV = top[-1].v.boolV && top->v.boolV;
+			top--;
+			break;
+		case EXPR_OR:
+			top[-1].v.boolV = top[-1].v.boolV || top->v.boolV;
+			top--;
+			break;
+		case EXPR_NOT:
+			top->v.boolV = !top->v.boolV;
+			break;
+		}
+	}
+
+	return top->v.boolV;
+}
+
+void
+freeProgram (ExprProgram *program)
+{
+	if (program == NULL)
+		return;
+	free(program->instrs);
+	free(program->stack);
+	free(program);
+}
+
+
+// filter kernels; each computes the selection bits of the tuples from..numTuples-1,
+// the vectorized kernels leave the tuples after the last full vector to the scalar ones
+
+typedef int (*FilterKernel) (const char *data, int stride, int from, int numTuples, ExprCmp cmp, ExprSlot value, uint64_t *selection);
+
+#define SET_SELECTED(_selection,_i,_bits)				\
+		((_selection)[(_i) / 64] |= (uint64_t) (_bits) << ((_i) % 64))
+
+static int
+filterIntsScalar (const char *data, int stride, int from, int numTuples, ExprCmp cmp, ExprSlot value, uint64_t *selection)
+{
+	int i, v, c = value.v.intV;
+
+	for (i = from; i < numTuples; i++)
+	{
+		memcpy(&v, data + (size_t) i * stride, sizeof(int));
+		if (cmp == EXPR_CMP_EQUAL ? v == c : (cmp == EXPR_CMP_SMALLER ? v < c : v > c))
+			SET_SELECTED(selection, i, 1);
+	}
+	return numTuples;
+}
+
+static int
+filterFloatsScalar (const char *data, int stride, int from, int numTuples, ExprCmp cmp, ExprSlot value, uint64_t *selection)
+{
+	int i;
+	float v, c = value.v.floatV;
+
+	for (i = from; i < numTuples; i++)
+	{
+		memcpy(&v, data + (size_t) i * stride, sizeof(float));
+		if (cmp == EXPR_CMP_EQUAL ? v == c : (cmp == EXPR_CMP_SMALLER ? v < c : v > c))
+			SET_SELECTED(selection, i, 1);
+	}
+	return numTuples;
+}
+
+#ifdef EXPR_X86_KERNELS
+
+// SSE2 has no gather, the four values of a vector are loaded one by one
+static inline int
+loadInt (const char *data)
+{
+	int v;
+	memcpy(&v, data, sizeof(int));
+	return v;
+}
+
+static inline float
+loadFloat (const char *data)
+{
+	float v;
+	memcpy(&v, data, sizeof(float));
+	return v;
+}
+
+__attribute__((target("sse2"))) static int
+filterIntsSSE2 (const char *data, int stride, int from, int numTuples, ExprCmp cmp, ExprSlot value, uint64_t *selection)
+{
+	__m128i c = _mm_set1_epi32(value.v.intV);
+	int i;
+
+	for (i = from; i + 4 <= numTuples; i += 4)
+	{
+		const char *p = data + (size_t) i * stride;
+		__m128i m, x = _mm_setr_epi32(loadInt(p), loadInt(p + stride), loadInt(p + 2 * stride), loadInt(p + 3 * stride));
+		m = (cmp == EXPR_CMP_EQUAL) ? _mm_cmpeq_epi32(x, c) : ((cmp == EXPR_CMP_SMALLER) ? _mm_cmplt_epi32(x, c) : _mm_cmpgt_epi32(x, c));
+		SET_SELECTED(selection, i, _mm_movemask_ps(_mm_castsi128_ps(m)));
+	}
+	return i;
+}
+
+__attribute__((target("sse2"))) static int
+filterFloatsSSE2 (const char *data, int stride, int from, int numTuples, ExprCmp cmp, ExprSlot value, uint64_t *selection)
+{
+	__m128 c = _mm_set1_ps(value.v.floatV);
+	int i;
+
+	for (i = from; i + 4 <= numTuples; i += 4)
+	{
+		const char *p = data + (size_t) i * stride;
+		__m128 m, x = _mm_setr_ps(loadFloat(p), loadFloat(p + stride), loadFloat(p + 2 * stride), loadFloat(p + 3 * stride));
+		m = (cmp == EXPR_CMP_EQUAL) ? _mm_cmpeq_ps(x, c) : ((cmp == EXPR_CMP_SMALLER) ? _mm_cmplt_ps(x, c) : _mm_cmpgt_ps(x, c));
+		SET_SELECTED(selection, i, _mm_movemask_ps(m));
+	}
+	return i;
+}
+
+// AVX2 gathers the eight values of a vector at byte offsets 0, stride, ..., 7 * stride
+__attribute__((target("avx2"))) static int
+filterIntsAVX2 (const char *data, int stride, int from, int numTuples, ExprCmp cmp, ExprSlot value, uint64_t *selection)
+{
+	__m256i c = _mm256_set1_epi32(value.v.intV);
+	__m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride));
+	int i;
+
+	for (i = from; i + 8 <= numTuples; i += 8)
+	{
+		__m256i m, x = _mm256_i32gather_epi32((const int *) (data + (size_t) i * stride), offsets, 1);
+		if (cmp == EXPR_CMP_EQUAL)
+			m = _mm256_cmpeq_epi32(x, c);
+		else
+			m = (cmp == EXPR_CMP_SMALLER) ? _mm256_cmpgt_epi32(c, x) : _mm256_cmpgt_epi32(x, c);
+		SET_SELECTED(selection, i, _mm256_movemask_ps(_mm256_castsi256_ps(m)));
+	}
+	return i;
+}
+
+__attribute__((target("avx2"))) static int
+filterFloatsAVX2 (const char *data, int stride, int from, int numTuples, ExprCmp cmp, ExprSlot value, uint64_t *selection)
+{
+	__m256 c = _mm256_set1_ps(value.v.floatV);
+	__m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride));
+	int i;
+
+	for (i = from; i + 8 <= numTuples; i += 8)
+	{
+		__m256 m, x = _mm256_i32gather_ps((const float *) (data + (size_t) i * stride), offsets, 1);
+		if (cmp == EXPR_CMP_EQUAL)
+			m = _mm256_cmp_ps(x, c, _CMP_EQ_OQ);
+		else
+			m = (cmp == EXPR_CMP_SMALLER) ? _mm256_cmp_ps(x, c, _CMP_LT_OQ) : _mm256_cmp_ps(x, c, _CMP_GT_OQ);
+		SET_SELECTED(selection, i, _mm256_movemask_ps(m));
+	}
+	return i;
+}
+
+#endif
+
+// The kernels of one instruction set. Scans of several threads filter at once, so both kernels are
+// published together through one pointer, and the kernels used by default are chosen exactly once.
+typedef struct FilterKernels {
+	FilterKernel ints;
+	FilterKernel floats;
+} FilterKernels;
+
+static const FilterKernels scalarKernels = { filterIntsScalar, filterFloatsScalar };
+#ifdef EXPR_X86_KERNELS
+static const FilterKernels sse2Kernels = { filterIntsSSE2, filterFloatsSSE2 };
+static const FilterKernels avx2Kernels = { filterIntsAVX2, filterFloatsAVX2 };
+#endif
+
+static const FilterKernels *filterKernels = NULL;
+static pthread_once_t filterKernelsOnce = PTHREAD_ONCE_INIT;
+
+static void
+selectKernels (ExprKernelISA maximum, ExprKernelISA *isa)
+{
+	const FilterKernels *kernels = &scalarKernels;
+
+	*isa = EXPR_KERNEL_SCALAR;
+#ifdef EXPR_X86_KERNELS
+	__builtin_cpu_init();
+	if (maximum >= EXPR_KERNEL_AVX2 && __builtin_cpu_supports("avx2"))
+	{
+		kernels = &avx2Kernels;
+		*isa = EXPR_KERNEL_AVX2;
+	}
+	else if (maximum >= EXPR_KERNEL_SSE2 && __builtin_cpu_supports("sse2"))
+	{
+		kernels = &sse2Kernels;
+		*isa = EXPR_KERNEL_SSE2;
+	}
+#endif
+	__atomic_store_n(&filterKernels, kernels, __ATOMIC_RELEASE);
+}
+
+static void
+selectDefaultKernels (void)
+{
+	ExprKernelISA isa;
+	selectKernels(EXPR_KERNEL_AVX2, &isa);
+}
+
+ExprKernelISA
+selectFilterKernels (ExprKernelISA maximum)
+{
+	ExprKernelISA isa;
+
+	// the default choice is made first, so it never overrides this one
+	pthread_once(&filterKernelsOnce, selectDefaultKernels);
+	selectKernels(maximum, &isa);
+	return isa;
+}
+
+bool
+filterProgram (ExprProgram *program, char *data, int stride, int numTuples, uint64_t *selection)
+{
+	ExprFilter *filter = &program->filter;
+	const FilterKernels *kernels;
+	FilterKernel kernel;
+	int done;
+
+	if (!program->hasFilter)
+		return FALSE;
+	pthread_once(&filterKernelsOnce, selectDefaultKernels);
+	kernels = __atomic_load_n(&filterKernels, __ATOMIC_ACQUIRE);
+
+	memset(selection, 0, ((numTuples + 63) / 64) * sizeof(uint64_t));
+	if (numTuples <= 0)
+		return TRUE;
+
+	data += filter->offset;
+	kernel = (filter->dt == DT_INT) ? kernels->ints : kernels->floats;
+	done = kernel(data, stride, 0, numTuples, filter->cmp, filter->value, selection);
+	if (filter->dt == DT_INT)
+		filterIntsScalar(data, stride, done, numTuples, filter->cmp, filter->value, selection);
+	else
+		filterFloatsScalar(data, stride, done, numTuples, filter->cmp, filter->value, selection);
+	return TRUE;
+}
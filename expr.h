@@ -1,6 +1,8 @@
 #ifndef EXPR_H
 #define EXPR_H
 
+#include <stdint.h>
+
 #include "dberror.h"
 #include "tables.h"
 
@@ -34,6 +36,65 @@ typedef struct Operator {
   Expr **args;
 } Operator;
 
+// compiled expressions: a flat postfix program bound to a schema, evaluated
+// directly on the record data without allocating memory
+typedef enum ExprOpCode {
+  EXPR_PUSH_ATTR,  // push the attribute at offset (of type dt)
+  EXPR_PUSH_CONST, // push the constant value
+  EXPR_EQUAL,      // pop two values of type dt, push left == right
+  EXPR_SMALLER,    // pop two values of type dt, push left < right
+  EXPR_AND,
+  EXPR_OR,
+  EXPR_NOT
+} ExprOpCode;
+
+typedef struct ExprSlot {
+  union {
+    int intV;
+    float floatV;
+    bool boolV;
+    const char *stringV; // not necessarily terminated, see length
+  } v;
+  int length; // length of stringV
+} ExprSlot;
+
+typedef struct ExprInstr {
+  ExprOpCode code;
+  DataType dt; // type of the pushed value or of the compared operands
+  int offset;  // offset of the attribute in the record data
+  ExprSlot value; // constant, attribute strings use value.length as maximum length
+} ExprInstr;
+
+// a program that is a single comparison of an INT or FLOAT attribute with a
+// constant is also compiled into a filter, evaluated over many tuples at once
+typedef enum ExprCmp {
+  EXPR_CMP_EQUAL,   // attribute == constant
+  EXPR_CMP_SMALLER, // attribute < constant
+  EXPR_CMP_GREATER  // attribute > constant
+} ExprCmp;
+
+typedef struct ExprFilter {
+  ExprCmp cmp;
+  DataType dt;    // DT_INT or DT_FLOAT
+  int offset;     // offset of the attribute in the record data
+  ExprSlot value; // constant
+} ExprFilter;
+
+typedef struct ExprProgram {
+  ExprInstr *instrs;
+  int numInstrs;
+  ExprSlot *stack; // evaluation stack, large enough for the program
+  bool hasFilter;  // the program can be evaluated with filterProgram
+  ExprFilter filter;
+} ExprProgram;
+
+// instruction sets the filter kernels are implemented for
+typedef enum ExprKernelISA {
+  EXPR_KERNEL_SCALAR,
+  EXPR_KERNEL_SSE2,
+  EXPR_KERNEL_AVX2
+} ExprKernelISA;
+
 // expression evaluation methods
 extern RC valueEquals (Value *left, Value *right, Value *result);
 extern RC valueSmaller (Value *left, Value *right, Value *result);
@@ -44,6 +105,18 @@ extern RC evalExpr (Record *record, Schema *schema, Expr *expr, Value **result);
 extern RC freeExpr (Expr *expr);
 extern void freeVal(Value *val);
 
+// compiled expression methods; the program refers to the constant strings of the expression
+extern RC compileExpr (Expr *expr, Schema *schema, ExprProgram **program);
+extern bool evalProgram (ExprProgram *program, char *data);
+extern void freeProgram (ExprProgram *program);
+
+// evaluate a program with a filter on numTuples tuples that are stride bytes apart; bit i of
+// selection (in 64-bit words) is set if tuple i satisfies the program. returns FALSE if the
+// program has no filter. the kernels are chosen on first use, selectFilterKernels picks the
+// best instruction set the CPU supports up to maximum and returns it
+extern bool filterProgram (ExprProgram *program, char *data, int stride, int numTuples, uint64_t *selection);
+extern ExprKernelISA selectFilterKernels (ExprKernelISA maximum);
+
 
 #define CPVAL(_result,_input)						\
   do {									\
@@ -0,0 +1,480 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "dberror.h"
+#include "tables.h"
+#include "record_mgr.h"
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "hash_mgr.h"
+
+#define HASH_MAGIC 0x48617368   // marks the header page of a hash index
+#define MAX_GLOBAL_DEPTH 24     // largest directory: 2^24 buckets
+
+// Header page of an index
+typedef struct HS_Header
+{
+    int magic;
+    int keySize;          // size of a key in bytes
+    int globalDepth;      // the directory has 2^globalDepth entries
+    int numEntries;
+    int numBuckets;
+    PageNumber directory; // first directory page
+} HS_Header;
+
+// The directory is stored in a chain of pages, each holding the next part of it
+typedef struct HS_DirectoryPage
+{
+    PageNumber next;
+    PageNumber buckets[];
+} HS_DirectoryPage;
+
+#define DIRECTORY_PAGE_BUCKETS ((int)((PAGE_SIZE - sizeof(PageNumber)) / sizeof(PageNumber)))
+
+// Layout of a bucket page:
+//   HS_BucketHeader | entries (hash of the key, key, RID) in no particular order
+// All keys of a bucket agree in the lowest localDepth bits of their hash.
+typedef struct HS_BucketHeader
+{
+    int localDepth;
+    int numEntries;
+} HS_BucketHeader;
+
+#define BUCKET_HEADER(data) ((HS_BucketHeader *)(data))
+
+// Bookkeeping of an open index, stored in HashHandle.mgmtData
+typedef struct HS_IndexInfo
+{
+    BM_BufferPool *bm;
+    int *numPages; // number of pages in the page file, new pages are appended
+    Schema *schema;
+    int keySize;
+    int entrySize;      // hash, key, and RID
+    int bucketCapacity; // number of entries fitting on a bucket page
+    int globalDepth;
+    PageNumber *directory; // bucket of each value of the lowest globalDepth bits of a hash
+    PageNumber firstDirectoryPage;
+    int numEntries;
+    int numBuckets;
+} HS_IndexInfo;
+
+static char *entryAt(HS_IndexInfo *info, char *data, int i)
+{
+    return data + sizeof(HS_BucketHeader) + i * info->entrySize;
+}
+
+static uint32_t entryHash(char *entry)
+{
+    uint32_t hash;
+    memcpy(&hash, entry, sizeof(uint32_t));
+    return hash;
+}
+
+// Position of a key in a bucket, -1 if the bucket does not hold it
+static int findInBucket(HS_IndexInfo *info, char *data, uint32_t hash, char *key)
+{
+    for (int i = 0; i < BUCKET_HEADER(data)->numEntries; i++)
+    {
+        char *entry = entryAt(info, data, i);
+
+        // Only compare the keys if the hashes match
+        if (entryHash(entry) == hash && compareKeys(info->schema, key, entry + sizeof(uint32_t)) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Mark a modified page dirty and release it
+static RC releasePage(BM_BufferPool *bm, BM_PageHandle *page)
+{
+    RC rc = markDirty(bm, page);
+    unpinPage(bm, page);
+    return rc;
+}
+
+// Append a new zeroed page to the page file and return it pinned
+static RC appendPage(BM_BufferPool *bm, int *numPages, BM_PageHandle *page)
+{
+    // Take the next page number atomically, other users of the file may append pages concurrently;
+    // pinning a page behind the last page of the file grows the file
+    RC rc = pinPage(bm, page, __atomic_fetch_add(numPages, 1, __ATOMIC_SEQ_CST));
+    if (rc != RC_OK)
+    {
+        return rc;
+    }
+    memset(page->data, 0, PAGE_SIZE);
+    return RC_OK;
+}
+
+// Write the directory to its chain of pages, appending pages to the chain as needed
+static RC writeDirectory(HS_IndexInfo *info)
+{
+    BM_PageHandle page;
+    PageNumber pageNum = info->firstDirectoryPage;
+    int size = 1 << info->globalDepth;
+    RC rc;
+
+    for (int i = 0; i < size; i += DIRECTORY_PAGE_BUCKETS)
+    {
+        if ((rc = pinPage(info->bm, &page, pageNum)) != RC_OK)
+        {
+            return rc;
+        }
+
+        HS_DirectoryPage *dir = (HS_DirectoryPage *)page.data;
+        int n = (size - i < DIRECTORY_PAGE_BUCKETS) ? size - i : DIRECTORY_PAGE_BUCKETS;
+        memcpy(dir->buckets, info->directory + i, n * sizeof(PageNumber));
+
+        // Extend the chain if the rest of the directory does not fit
+        if (i + n < size && dir->next == NO_PAGE)
+        {
+            BM_PageHandle next;
+            if ((rc = appendPage(info->bm, info->numPages, &next)) != RC_OK)
+            {
+                unpinPage(info->bm, &page);
+                return rc;
+            }
+            ((HS_DirectoryPage *)next.data)->next = NO_PAGE;
+            dir->next = next.pageNum;
+            if ((rc = releasePage(info->bm, &next)) != RC_OK)
+            {
+                unpinPage(info->bm, &page);
+                return rc;
+            }
+        }
+        pageNum = dir->next;
+
+        if ((rc = releasePage(info->bm, &page)) != RC_OK)
+        {
+            return rc;
+        }
+    }
+    return RC_OK;
+}
+
+static RC readDirectory(HS_IndexInfo *info)
+{
+    BM_PageHandle page;
+    PageNumber pageNum = info->firstDirectoryPage;
+    int size = 1 << info->globalDepth;
+    RC rc;
+
+    for (int i = 0; i < size; i += DIRECTORY_PAGE_BUCKETS)
+    {
+        if ((rc = pinPage(info->bm, &page, pageNum)) != RC_OK)
+        {
+            return rc;
+        }
+
+        HS_DirectoryPage *dir = (HS_DirectoryPage *)page.data;
+        int n = (size - i < DIRECTORY_PAGE_BUCKETS) ? size - i : DIRECTORY_PAGE_BUCKETS;
+        memcpy(info->directory + i, dir->buckets, n * sizeof(PageNumber));
+        pageNum = dir->next;
+        unpinPage(info->bm, &page);
+    }
+    return RC_OK;
+}
+
+// Split a full bucket on the next bit of the hash, doubling the directory if the bucket already uses all of its bits
+static RC splitBucket(HS_IndexInfo *info, BM_PageHandle *page)
+{
+    HS_BucketHeader *header = BUCKET_HEADER(page->data);
+    int depth = header->localDepth;
+    BM_PageHandle newPage;
+    RC rc;
+
+    if (depth == info->globalDepth)
+    {
+        if (info->globalDepth == MAX_GLOBAL_DEPTH)
+        {
+            unpinPage(info->bm, page);
+            THROW(RC_ERROR, "hash directory cannot grow any further");
+        }
+
+        // Both halves of the doubled directory point to the same buckets
+        int size = 1 << info->globalDepth;
+        info->directory = (PageNumber *)realloc(info->directory, 2 * size * sizeof(PageNumber));
+        memcpy(info->directory + size, info->directory, size * sizeof(PageNumber));
+        info->globalDepth++;
+    }
+
+    if ((rc = appendPage(info->bm, info->numPages, &newPage)) != RC_OK)
+    {
+        unpinPage(info->bm, page);
+        return rc;
+    }
+    info->numBuckets++;
+
+    // Move the entries whose hash has the next bit set to the new bucket
+    HS_BucketHeader *newHeader = BUCKET_HEADER(newPage.data);
+    header->localDepth = depth + 1;
+    newHeader->localDepth = depth + 1;
+    newHeader->numEntries = 0;
+    for (int i = 0; i < header->numEntries;)
+    {
+        char *entry = entryAt(info, page->data, i);
+        if ((entryHash(entry) >> depth) & 1)
+        {
+            memcpy(entryAt(info, newPage.data, newHeader->numEntries++), entry, info->entrySize);
+            memmove(entry, entryAt(info, page->data, header->numEntries - 1), info->entrySize);
+            header->numEntries--;
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    // Point the directory entries of the moved half to the new bucket
+    for (int i = 0; i < (1 << info->globalDepth); i++)
+    {
+        if (info->directory[i] == page->pageNum && ((i >> depth) & 1))
+        {
+            info->directory[i] = newPage.pageNum;
+        }
+    }
+
+    rc = releasePage(info->bm, &newPage);
+    RC rcOld = releasePage(info->bm, page);
+    return (rc != RC_OK) ? rc : rcOld;
+}
+
+static PageNumber bucketOf(HS_IndexInfo *info, uint32_t hash)
+{
+    return info->directory[hash & ((1u << info->globalDepth) - 1)];
+}
+
+// create, open, and close a hash index
+RC createHash(BM_BufferPool *bm, int *numPages, Schema *schema, PageNumber *headerPage)
+{
+    BM_PageHandle page, dirPage, bucket;
+    RC rc;
+
+    if (getKeySize(schema) == 0)
+    {
+        THROW(RC_ERROR, "an index needs a schema with key attributes");
+    }
+
+    // The header page comes first, followed by the directory and a single empty bucket
+    if ((rc = appendPage(bm, numPages, &page)) != RC_OK)
+    {
+        return rc;
+    }
+    if ((rc = appendPage(bm, numPages, &dirPage)) != RC_OK)
+    {
+        unpinPage(bm, &page);
+        return rc;
+    }
+    if ((rc = appendPage(bm, numPages, &bucket)) != RC_OK)
+    {
+        unpinPage(bm, &dirPage);
+        unpinPage(bm, &page);
+        return rc;
+    }
+
+    BUCKET_HEADER(bucket.data)->localDepth = 0;
+    BUCKET_HEADER(bucket.data)->numEntries = 0;
+    ((HS_DirectoryPage *)dirPage.data)->next = NO_PAGE;
+    ((HS_DirectoryPage *)dirPage.data)->buckets[0] = bucket.pageNum;
+
+    HS_Header *header = (HS_Header *)page.data;
+    header->magic = HASH_MAGIC;
+    header->keySize = getKeySize(schema);
+    header->globalDepth = 0;
+    header->numEntries = 0;
+    header->numBuckets = 1;
+    header->directory = dirPage.pageNum;
+    *headerPage = page.pageNum;
+
+    rc = releasePage(bm, &bucket);
+    RC rcDir = releasePage(bm, &dirPage);
+    RC rcHeader = releasePage(bm, &page);
+    return (rc != RC_OK) ? rc : (rcDir != RC_OK) ? rcDir : rcHeader;
+}
+
+RC openHash(HashHandle **hash, BM_BufferPool *bm, int *numPages, Schema *schema, PageNumber headerPage)
+{
+    BM_PageHandle page;
+    RC rc = pinPage(bm, &page, headerPage);
+    if (rc != RC_OK)
+    {
+        return rc;
+    }
+
+    // Check that the page holds an index over keys of this schema
+    HS_Header *header = (HS_Header *)page.data;
+    if (header->magic != HASH_MAGIC || header->keySize != getKeySize(schema))
+    {
+        unpinPage(bm, &page);
+        THROW(RC_ERROR, "page is not the header of a hash index over this schema");
+    }
+
+    HS_IndexInfo *info = (HS_IndexInfo *)malloc(sizeof(HS_IndexInfo));
+    info->bm = bm;
+    info->numPages = numPages;
+    info->schema = schema;
+    info->keySize = header->keySize;
+    info->entrySize = sizeof(uint32_t) + info->keySize + sizeof(RID);
+    info->bucketCapacity = (PAGE_SIZE - sizeof(HS_BucketHeader)) / info->entrySize;
+    info->globalDepth = header->globalDepth;
+    info->firstDirectoryPage = header->directory;
+    info->numEntries = header->numEntries;
+    info->numBuckets = header->numBuckets;
+    info->directory = (PageNumber *)malloc((1 << info->globalDepth) * sizeof(PageNumber));
+    unpinPage(bm, &page);
+
+    if ((rc = readDirectory(info)) != RC_OK)
+    {
+        free(info->directory);
+        free(info);
+        return rc;
+    }
+
+    *hash = (HashHandle *)malloc(sizeof(HashHandle));
+    (*hash)->schema = schema;
+    (*hash)->headerPage = headerPage;
+    (*hash)->mgmtData = info;
+    return RC_OK;
+}
+
+RC closeHash(HashHandle *hash)
+{
+    HS_IndexInfo *info = (HS_IndexInfo *)hash->mgmtData;
+    BM_PageHandle page;
+
+    // Write back the directory and the size of the index
+    RC rc = writeDirectory(info);
+    if (rc == RC_OK && (rc = pinPage(info->bm, &page, hash->headerPage)) == RC_OK)
+    {
+        HS_Header *header = (HS_Header *)page.data;
+        header->globalDepth = info->globalDepth;
+        header->numEntries = info->numEntries;
+        header->numBuckets = info->numBuckets;
+        rc = releasePage(info->bm, &page);
+    }
+
+    free(info->directory);
+    free(info);
+    free(hash);
+    return rc;
+}
+
+RC deleteHash(BM_BufferPool *bm, PageNumber headerPage)
+{
+    BM_PageHandle page;
+
+    // Invalidate the header, the pages of the index are not reused
+    RC rc = pinPage(bm, &page, headerPage);
+    if (rc != RC_OK)
+    {
+        return rc;
+    }
+    if (((HS_Header *)page.data)->magic != HASH_MAGIC)
+    {
+        unpinPage(bm, &page);
+        THROW(RC_ERROR, "page is not the header of a hash index");
+    }
+    ((HS_Header *)page.data)->magic = 0;
+    return releasePage(bm, &page);
+}
+
+// access information about a hash index
+RC getNumHashEntries(HashHandle *hash, int *result)
+{
+    *result = ((HS_IndexInfo *)hash->mgmtData)->numEntries;
+    return RC_OK;
+}
+
+RC getNumBuckets(HashHandle *hash, int *result)
+{
+    *result = ((HS_IndexInfo *)hash->mgmtData)->numBuckets;
+    return RC_OK;
+}
+
+// index access
+RC findHashKey(HashHandle *hash, char *key, RID *result)
+{
+    HS_IndexInfo *info = (HS_IndexInfo *)hash->mgmtData;
+    uint32_t h = hashKey(info->schema, key);
+    BM_PageHandle page;
+
+    RC rc = pinPage(info->bm, &page, bucketOf(info, h));
+    if (rc != RC_OK)
+    {
+        return rc;
+    }
+
+    int i = findInBucket(info, page.data, h, key);
+    if (i != -1)
+    {
+        memcpy(result, entryAt(info, page.data, i) + sizeof(uint32_t) + info->keySize, sizeof(RID));
+    }
+    unpinPage(info->bm, &page);
+    return (i != -1) ? RC_OK : RC_IM_KEY_NOT_FOUND;
+}
+
+RC insertHashKey(HashHandle *hash, char *key, RID rid)
+{
+    HS_IndexInfo *info = (HS_IndexInfo *)hash->mgmtData;
+    uint32_t h = hashKey(info->schema, key);
+    BM_PageHandle page;
+    RC rc;
+
+    // Split the bucket of the key until it has room for the entry
+    for (;;)
+    {
+        if ((rc = pinPage(info->bm, &page, bucketOf(info, h))) != RC_OK)
+        {
+            return rc;
+        }
+        if (findInBucket(info, page.data, h, key) != -1)
+        {
+            unpinPage(info->bm, &page);
+            return RC_IM_KEY_ALREADY_EXISTS;
+        }
+        if (BUCKET_HEADER(page.data)->numEntries < info->bucketCapacity)
+        {
+            break;
+        }
+        if ((rc = splitBucket(info, &page)) != RC_OK)
+        {
+            return rc;
+        }
+    }
+
+    char *entry = entryAt(info, page.data, BUCKET_HEADER(page.data)->numEntries++);
+    memcpy(entry, &h, sizeof(uint32_t));
+    memcpy(entry + sizeof(uint32_t), key, info->keySize);
+    memcpy(entry + sizeof(uint32_t) + info->keySize, &rid, sizeof(RID));
+    info->numEntries++;
+    return releasePage(info->bm, &page);
+}
+
+RC deleteHashKey(HashHandle *hash, char *key)
+{
+    HS_IndexInfo *info = (HS_IndexInfo *)hash->mgmtData;
+    uint32_t h = hashKey(info->schema, key);
+    BM_PageHandle page;
+
+    RC rc = pinPage(info->bm, &page, bucketOf(info, h));
+    if (rc != RC_OK)
+    {
+        return rc;
+    }
+
+    int i = findInBucket(info, page.data, h, key);
+    if (i == -1)
+    {
+        unpinPage(info->bm, &page);
+        return RC_IM_KEY_NOT_FOUND;
+    }
+
+    // Fill the gap with the last entry, buckets are not merged
+    HS_BucketHeader *header = BUCKET_HEADER(page.data);
+    memmove(entryAt(info, page.data, i), entryAt(info, page.data, header->numEntries - 1), info->entrySize);
+    header->numEntries--;
+    info->numEntries--;
+    return releasePage(info->bm, &page);
+}
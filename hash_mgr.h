@@ -0,0 +1,35 @@
+#ifndef HASH_MGR_H
+#define HASH_MGR_H
+
+#include "dberror.h"
+#include "tables.h"
+#include "buffer_mgr.h"
+
+// Extendible hash index mapping unique keys (see getRecordKey) to RIDs. Each bucket is a page
+// of a page file accessed through a buffer pool; full buckets split, doubling the directory
+// when needed, and new buckets are appended to the file at page *numPages. The directory is
+// kept in memory while the index is open and written to pages when it is closed. An index
+// is identified by its header page; its users serialize the calls on one index.
+typedef struct HashHandle
+{
+	Schema *schema;        // schema of the indexed records
+	PageNumber headerPage; // page holding the directory location and the size of the index
+	void *mgmtData;
+} HashHandle;
+
+// create, open, and close a hash index
+extern RC createHash (BM_BufferPool *bm, int *numPages, Schema *schema, PageNumber *headerPage);
+extern RC openHash (HashHandle **hash, BM_BufferPool *bm, int *numPages, Schema *schema, PageNumber headerPage);
+extern RC closeHash (HashHandle *hash);
+extern RC deleteHash (BM_BufferPool *bm, PageNumber headerPage);
+
+// access information about a hash index
+extern RC getNumHashEntries (HashHandle *hash, int *result);
+extern RC getNumBuckets (HashHandle *hash, int *result);
+
+// index access; inserting a key that is already in the index fails with RC_IM_KEY_ALREADY_EXISTS
+extern RC findHashKey (HashHandle *hash, char *key, RID *result);
+extern RC insertHashKey (HashHandle *hash, char *key, RID rid);
+extern RC deleteHashKey (HashHandle *hash, char *key);
+
+#endif // HASH_MGR_H
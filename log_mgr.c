@@ -0,0 +1,587 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include "dberror.h"
+#include "storage_mgr.h"
+#include "log_mgr.h"
+
+#define LOG_MAGIC 0x4c6f6721 // marks the header page of a log
+#define LOG_BUFFER_PAGES 16 // size of the log buffer, the most pages written by one flush
+
+// Header page of a log, page 0 of the file. The log itself starts on page 1:
+// the byte at offset k of page p has the LSN baseLSN + (p - 1) * PAGE_SIZE + k.
+typedef struct LG_Header
+{
+    int magic;
+    LSN baseLSN;
+    LSN startLSN; // first record, on page 1
+    LSN checkpointLSN; // see setLogCheckpoint
+} LG_Header;
+
+// Bookkeeping of an open log, stored in LogHandle.mgmtData
+typedef struct LG_LogInfo
+{
+    SM_FileHandle fileHandle;
+    pthread_mutex_t latch;  // protects the fields below
+    LSN baseLSN;            // changed by truncateLog
+    LSN startLSN;           // changed by truncateLog
+    LSN checkpointLSN;
+    pthread_cond_t flushed; // broadcast whenever a write of the buffer ends
+    char *buffer;           // the log from bufferLSN to endLSN, zeros behind it
+    LSN bufferLSN;          // start of a log page, everything before it is in the file
+    LSN endLSN;             // the next record is appended here
+    LSN flushedLSN;         // the log before this LSN is durable
+    bool flushing;          // a thread is writing the buffer, without holding the latch
+    char *writeBuffer;      // copy of the buffer being written
+    char *readPage;         // last page read from the file by readLogRecord
+    int readPageNum;        // -1 if none
+    int numFlushes;
+} LG_LogInfo;
+
+// Page of the file holding the byte at an LSN
+static int filePage(LG_LogInfo *info, LSN lsn)
+{
+    return (int)(1 + (lsn - info->baseLSN) / PAGE_SIZE);
+}
+
+// Start of the log page holding the byte at an LSN
+static LSN pageStart(LG_LogInfo *info, LSN lsn)
+{
+    return lsn - (lsn - info->baseLSN) % PAGE_SIZE;
+}
+
+// FNV-1a hash of a record, computed with a zero checksum field
+static unsigned int checksumRecord(LogRecord *header, char *body, int bodySize)
+{
+    unsigned int checksum = header->checksum;
+    unsigned int hash = 2166136261u;
+
+    header->checksum = 0;
+    for (int i = 0; i < (int)sizeof(LogRecord); i++)
+    {
+        hash = (hash ^ (unsigned char)((char *)header)[i]) * 16777619u;
+    }
+    for (int i = 0; i < bodySize; i++)
+    {
+        hash = (hash ^ (unsigned char)body[i]) * 16777619u;
+    }
+    header->checksum = checksum;
+    return hash;
+}
+
+// Transfer a single page of the log file
+static RC transferPage(LG_LogInfo *info, int pageNum, char *data, int isWrite)
+{
+    SM_IORequest request = {pageNum, data, isWrite, RC_OK, NULL, NULL};
+    RC rc = transferBlocks(&info->fileHandle, &request, 1);
+    return (rc != RC_OK) ? rc : request.rc;
+}
+
+// Write the header page of a log to a file and sync it
+static RC writeHeader(LG_LogInfo *info, SM_FileHandle *fileHandle)
+{
+    char page[PAGE_SIZE];
+    LG_Header *header = (LG_Header *)page;
+
+    memset(page, 0, PAGE_SIZE);
+    header->magic = LOG_MAGIC;
+    header->baseLSN = info->baseLSN;
+    header->startLSN = info->startLSN;
+    header->checkpointLSN = info->checkpointLSN;
+
+    SM_IORequest request = {0, page, 1, RC_OK, NULL, NULL};
+    RC rc = transferBlocks(fileHandle, &request, 1);
+    if (rc == RC_OK && (rc = request.rc) == RC_OK)
+    {
+        rc = forceBlocks(fileHandle);
+    }
+    return rc;
+}
+
+// Write the buffer up to endLSN to the file and sync it, making every record appended so far durable.
+// The caller holds the latch, which is released during the write; meanwhile other threads append to
+// the buffer and wait for the write to end instead of starting their own.
+static RC writeLogBuffer(LG_LogInfo *info)
+{
+    LSN target = info->endLSN;
+    int firstPage = filePage(info, info->bufferLSN);
+    int numPages = (int)((target - info->bufferLSN + PAGE_SIZE - 1) / PAGE_SIZE);
+    SM_IORequest requests[LOG_BUFFER_PAGES];
+    RC rc;
+
+    memcpy(info->writeBuffer, info->buffer, (size_t)numPages * PAGE_SIZE);
+    info->flushing = true;
+    pthread_mutex_unlock(&info->latch);
+
+    // Only the flushing thread grows and writes the file
+    rc = ensureCapacity(firstPage + numPages, &info->fileHandle);
+    for (int i = 0; i < numPages; i++)
+    {
+        requests[i].pageNum = firstPage + i;
+        requests[i].memPage = info->writeBuffer + (size_t)i * PAGE_SIZE;
+        requests[i].isWrite = 1;
+        requests[i].callback = NULL;
+        requests[i].context = NULL;
+    }
+    if (rc == RC_OK)
+    {
+        rc = transferBlocks(&info->fileHandle, requests, numPages);
+    }
+    for (int i = 0; i < numPages && rc == RC_OK; i++)
+    {
+        rc = requests[i].rc;
+    }
+    if (rc == RC_OK)
+    {
+        rc = forceBlocks(&info->fileHandle);
+    }
+
+    pthread_mutex_lock(&info->latch);
+    info->flushing = false;
+    if (rc == RC_OK)
+    {
+        info->flushedLSN = target;
+        info->numFlushes++;
+
+        // Drop the complete pages from the buffer, the last page is written again with the next records
+        LSN keep = pageStart(info, target);
+        int drop = (int)(keep - info->bufferLSN);
+        int used = (int)(info->endLSN - keep);
+        memmove(info->buffer, info->buffer + drop, used);
+        memset(info->buffer + used, 0, drop);
+        info->bufferLSN = keep;
+    }
+    pthread_cond_broadcast(&info->flushed);
+
+    return rc;
+}
+
+// Copy the log from lsn on; the caller holds the latch
+static RC readLogBytes(LG_LogInfo *info, LSN lsn, char *dest, int size)
+{
+    while (size > 0)
+    {
+        int n;
+        if (lsn >= info->bufferLSN)
+        {
+            n = size;
+            memcpy(dest, info->buffer + (lsn - info->bufferLSN), n);
+        }
+        else
+        {
+            // Pages before the buffer never change again, so the last one read is kept
+            int pageNum = filePage(info, lsn);
+            if (pageNum != info->readPageNum)
+            {
+                info->readPageNum = -1;
+                if (transferPage(info, pageNum, info->readPage, 0) != RC_OK)
+                {
+                    return RC_READ_NON_EXISTING_PAGE;
+                }
+                info->readPageNum = pageNum;
+            }
+            int offset = (int)((lsn - info->baseLSN) % PAGE_SIZE);
+            n = (size < PAGE_SIZE - offset) ? size : PAGE_SIZE - offset;
+            memcpy(dest, info->readPage + offset, n);
+        }
+        lsn += n;
+        dest += n;
+        size -= n;
+    }
+    return RC_OK;
+}
+
+// Read and check the record at lsn, which lies before limit; the caller holds the latch
+static RC readRecordLocked(LG_LogInfo *info, LSN lsn, LSN limit, LogRecord **record)
+{
+    LogRecord header;
+
+    if (lsn < info->startLSN || lsn + (LSN)sizeof(LogRecord) > limit ||
+        readLogBytes(info, lsn, (char *)&header, sizeof(LogRecord)) != RC_OK ||
+        header.size < (int)sizeof(LogRecord) || header.size > (LOG_BUFFER_PAGES - 1) * PAGE_SIZE || lsn + header.size > limit)
+    {
+        return RC_LOG_NO_MORE_RECORDS;
+    }
+
+    LogRecord *result = (LogRecord *)malloc(header.size);
+    if (readLogBytes(info, lsn, (char *)result, header.size) != RC_OK ||
+        checksumRecord(result, LOG_BODY(result), header.size - (int)sizeof(LogRecord)) != result->checksum)
+    {
+        free(result);
+        return RC_LOG_NO_MORE_RECORDS;
+    }
+
+    *record = result;
+    return RC_OK;
+}
+
+// Find the end of the log, behind the last intact record, and clear everything after it in the file,
+// so no stale bytes are mistaken for records once new records are appended there
+static RC findLogEnd(LG_LogInfo *info)
+{
+    LogRecord *record;
+    LSN lsn = info->startLSN;
+    RC rc = RC_OK;
+
+    // Everything is read from the file while the end is unknown
+    info->bufferLSN = LONG_MAX;
+    while (readRecordLocked(info, lsn, LONG_MAX, &record) == RC_OK)
+    {
+        lsn += record->size;
+        free(record);
+    }
+
+    // Load the partial last page into the buffer
+    info->bufferLSN = pageStart(info, lsn);
+    info->endLSN = lsn;
+    info->flushedLSN = lsn;
+    info->readPageNum = -1;
+    if (filePage(info, lsn) < info->fileHandle.totalNumPages)
+    {
+        rc = transferPage(info, filePage(info, lsn), info->buffer, 0);
+        memset(info->buffer + (lsn - info->bufferLSN), 0, PAGE_SIZE - (lsn - info->bufferLSN));
+    }
+
+    // Rewrite the last page and zero the pages behind it
+    for (int p = filePage(info, lsn); rc == RC_OK && p < info->fileHandle.totalNumPages; p++)
+    {
+        rc = transferPage(info, p, (p == filePage(info, lsn)) ? info->buffer : info->writeBuffer, 1);
+    }
+    if (rc == RC_OK)
+    {
+        rc = forceBlocks(&info->fileHandle);
+    }
+    return rc;
+}
+
+// create, open, and close a log
+RC createLog(char *fileName)
+{
+    SM_FileHandle fileHandle;
+    char page[PAGE_SIZE];
+    RC rc;
+
+    if ((rc = createPageFile(fileName)) != RC_OK || (rc = openPageFile(fileName, &fileHandle)) != RC_OK)
+    {
+        return rc;
+    }
+
+    // The first record starts at the LSN of its offset in the file
+    memset(page, 0, PAGE_SIZE);
+    LG_Header *header = (LG_Header *)page;
+    header->magic = LOG_MAGIC;
+    header->baseLSN = PAGE_SIZE;
+    header->startLSN = PAGE_SIZE;
+    header->checkpointLSN = NO_LSN;
+    rc = writeBlock(0, &fileHandle, page);
+    if (rc == RC_OK)
+    {
+        rc = forceBlocks(&fileHandle);
+    }
+
+    RC rcClose = closePageFile(&fileHandle);
+    return (rc != RC_OK) ? rc : rcClose;
+}
+
+RC openLog(LogHandle **log, char *fileName)
+{
+    char page[PAGE_SIZE];
+    RC rc;
+
+    LG_LogInfo *info = (LG_LogInfo *)malloc(sizeof(LG_LogInfo));
+    if ((rc = openPageFile(fileName, &info->fileHandle)) != RC_OK)
+    {
+        free(info);
+        return rc;
+    }
+
+    // Check that the file holds a log
+    if ((rc = readBlock(0, &info->fileHandle, page)) != RC_OK || ((LG_Header *)page)->magic != LOG_MAGIC)
+    {
+        closePageFile(&info->fileHandle);
+        free(info);
+        if (rc != RC_OK)
+        {
+            return rc;
+        }
+        THROW(RC_ERROR, "file is not a log");
+    }
+
+    info->baseLSN = ((LG_Header *)page)->baseLSN;
+    info->startLSN = ((LG_Header *)page)->startLSN;
+    info->checkpointLSN = ((LG_Header *)page)->checkpointLSN;
+    pthread_mutex_init(&info->latch, NULL);
+    pthread_cond_init(&info->flushed, NULL);
+    info->buffer = (char *)calloc(LOG_BUFFER_PAGES, PAGE_SIZE);
+    info->writeBuffer = (char *)calloc(LOG_BUFFER_PAGES, PAGE_SIZE);
+    info->readPage = (char *)malloc(PAGE_SIZE);
+    info->readPageNum = -1;
+    info->flushing = false;
+    info->numFlushes = 0;
+
+    if ((rc = findLogEnd(info)) != RC_OK)
+    {
+        closePageFile(&info->fileHandle);
+        pthread_mutex_destroy(&info->latch);
+        pthread_cond_destroy(&info->flushed);
+        free(info->buffer);
+        free(info->writeBuffer);
+        free(info->readPage);
+        free(info);
+        return rc;
+    }
+
+    *log = (LogHandle *)malloc(sizeof(LogHandle));
+    (*log)->fileName = fileName;
+    (*log)->mgmtData = info;
+    return RC_OK;
+}
+
+RC closeLog(LogHandle *log)
+{
+    LG_LogInfo *info = (LG_LogInfo *)log->mgmtData;
+
+    RC rc = flushLog(log, info->endLSN - 1);
+    RC rcClose = closePageFile(&info->fileHandle);
+
+    pthread_mutex_destroy(&info->latch);
+    pthread_cond_destroy(&info->flushed);
+    free(info->buffer);
+    free(info->writeBuffer);
+    free(info->readPage);
+    free(info);
+    free(log);
+    return (rc != RC_OK) ? rc : rcClose;
+}
+
+// writing the log
+RC appendLogRecord(LogHandle *log, int type, long xid, LSN prevLSN, char *body, int bodySize, LSN *lsn)
+{
+    LG_LogInfo *info = (LG_LogInfo *)log->mgmtData;
+    LogRecord header;
+    RC rc;
+
+    // A record never fills the buffer, which always keeps the partial page of the last flush
+    int size = (int)sizeof(LogRecord) + bodySize;
+    if (size > (LOG_BUFFER_PAGES - 1) * PAGE_SIZE)
+    {
+        THROW(RC_ERROR, "log record is too large");
+    }
+
+    memset(&header, 0, sizeof(LogRecord));
+    header.size = size;
+    header.type = type;
+    header.xid = xid;
+    header.prevLSN = prevLSN;
+    header.checksum = checksumRecord(&header, body, bodySize);
+
+    pthread_mutex_lock(&info->latch);
+
+    // Make room by writing the buffer, or by waiting for the write in progress
+    while (info->endLSN + size - info->bufferLSN > (LSN)LOG_BUFFER_PAGES * PAGE_SIZE)
+    {
+        if (info->flushing)
+        {
+            pthread_cond_wait(&info->flushed, &info->latch);
+        }
+        else if ((rc = writeLogBuffer(info)) != RC_OK)
+        {
+            pthread_mutex_unlock(&info->latch);
+            return rc;
+        }
+    }
+
+    char *dest = info->buffer + (info->endLSN - info->bufferLSN);
+    memcpy(dest, &header, sizeof(LogRecord));
+    if (bodySize > 0)
+    {
+        memcpy(dest + sizeof(LogRecord), body, bodySize);
+    }
+    *lsn = info->endLSN;
+    info->endLSN += size;
+
+    pthread_mutex_unlock(&info->latch);
+    return RC_OK;
+}
+
+RC flushLog(LogHandle *log, LSN lsn)
+{
+    LG_LogInfo *info = (LG_LogInfo *)log->mgmtData;
+    RC rc = RC_OK;
+
+    // The record at lsn is durable once the flushed log reaches past it. A write in progress may
+    // not cover it, so wait for that write and then write everything appended in the meantime.
+    pthread_mutex_lock(&info->latch);
+    while (rc == RC_OK && info->flushedLSN <= lsn && info->flushedLSN < info->endLSN)
+    {
+        if (info->flushing)
+        {
+            pthread_cond_wait(&info->flushed, &info->latch);
+        }
+        else
+        {
+            rc = writeLogBuffer(info);
+        }
+    }
+    pthread_mutex_unlock(&info->latch);
+
+    return rc;
+}
+
+// reading the log
+RC readLogRecord(LogHandle *log, LSN lsn, LogRecord **record)
+{
+    LG_LogInfo *info = (LG_LogInfo *)log->mgmtData;
+
+    pthread_mutex_lock(&info->latch);
+    RC rc = readRecordLocked(info, lsn, info->endLSN, record);
+    pthread_mutex_unlock(&info->latch);
+
+    return rc;
+}
+
+// checkpoints and truncation
+RC setLogCheckpoint(LogHandle *log, LSN lsn)
+{
+    LG_LogInfo *info = (LG_LogInfo *)log->mgmtData;
+
+    pthread_mutex_lock(&info->latch);
+    info->checkpointLSN = lsn;
+    RC rc = writeHeader(info, &info->fileHandle);
+    pthread_mutex_unlock(&info->latch);
+    return rc;
+}
+
+RC getLogCheckpoint(LogHandle *log, LSN *result)
+{
+    LG_LogInfo *info = (LG_LogInfo *)log->mgmtData;
+
+    pthread_mutex_lock(&info->latch);
+    *result = info->checkpointLSN;
+    pthread_mutex_unlock(&info->latch);
+    return RC_OK;
+}
+
+// Copy the pages of the log file from firstPage on behind the header page of another file
+static RC copyLogPages(LG_LogInfo *info, SM_FileHandle *dest, int firstPage)
+{
+    int numPages = info->fileHandle.totalNumPages - firstPage;
+    SM_IORequest requests[LOG_BUFFER_PAGES];
+    RC rc = ensureCapacity(1 + numPages, dest);
+
+    // The write buffer is free while no write of the buffer is in progress
+    for (int done = 0; rc == RC_OK && done < numPages; done += LOG_BUFFER_PAGES)
+    {
+        int n = (numPages - done < LOG_BUFFER_PAGES) ? numPages - done : LOG_BUFFER_PAGES;
+        for (int isWrite = 0; isWrite <= 1 && rc == RC_OK; isWrite++)
+        {
+            for (int i = 0; i < n; i++)
+            {
+                requests[i].pageNum = isWrite ? 1 + done + i : firstPage + done + i;
+                requests[i].memPage = info->writeBuffer + (size_t)i * PAGE_SIZE;
+                requests[i].isWrite = isWrite;
+                requests[i].callback = NULL;
+                requests[i].context = NULL;
+            }
+            rc = transferBlocks(isWrite ? dest : &info->fileHandle, requests, n);
+            for (int i = 0; i < n && rc == RC_OK; i++)
+            {
+                rc = requests[i].rc;
+            }
+        }
+    }
+    return rc;
+}
+
+RC truncateLog(LogHandle *log, LSN lsn)
+{
+    LG_LogInfo *info = (LG_LogInfo *)log->mgmtData;
+    SM_FileHandle newFile;
+    RC rc;
+
+    // Appends wait until the new file is in place, a write of the buffer in progress is waited for
+    pthread_mutex_lock(&info->latch);
+    while (info->flushing)
+    {
+        pthread_cond_wait(&info->flushed, &info->latch);
+    }
+
+    // The log is kept from the page holding lsn up to the end of the file, a record may start in the middle of that page
+    LSN newStart = (lsn < info->flushedLSN) ? lsn : info->flushedLSN;
+    LSN newBase = pageStart(info, newStart);
+    if (newStart <= info->startLSN)
+    {
+        pthread_mutex_unlock(&info->latch);
+        return RC_OK;
+    }
+    int firstPage = filePage(info, newStart);
+
+    // Write the new log next to the old one, renaming it replaces the old log at once
+    char *newName = (char *)malloc(strlen(log->fileName) + 5);
+    sprintf(newName, "%s.tmp", log->fileName);
+    LSN oldBase = info->baseLSN, oldStart = info->startLSN;
+    info->baseLSN = newBase;
+    info->startLSN = newStart;
+    if ((rc = createPageFile(newName)) == RC_OK && (rc = openPageFile(newName, &newFile)) == RC_OK)
+    {
+        if ((rc = writeHeader(info, &newFile)) == RC_OK && (rc = copyLogPages(info, &newFile, firstPage)) == RC_OK)
+        {
+            rc = forceBlocks(&newFile);
+        }
+        RC rcClose = closePageFile(&newFile);
+        rc = (rc != RC_OK) ? rc : rcClose;
+    }
+    if (rc == RC_OK && rename(newName, log->fileName) != 0)
+    {
+        rc = RC_WRITE_FAILED;
+    }
+
+    if (rc == RC_OK)
+    {
+        closePageFile(&info->fileHandle);
+        rc = openPageFile(log->fileName, &info->fileHandle);
+        info->readPageNum = -1;
+    }
+    else
+    {
+        destroyPageFile(newName);
+        info->baseLSN = oldBase;
+        info->startLSN = oldStart;
+    }
+    free(newName);
+    pthread_mutex_unlock(&info->latch);
+    return rc;
+}
+
+// access information about a log
+RC getLogStart(LogHandle *log, LSN *result)
+{
+    LG_LogInfo *info = (LG_LogInfo *)log->mgmtData;
+
+    pthread_mutex_lock(&info->latch);
+    *result = info->startLSN;
+    pthread_mutex_unlock(&info->latch);
+    return RC_OK;
+}
+
+RC getLogEnd(LogHandle *log, LSN *result)
+{
+    LG_LogInfo *info = (LG_LogInfo *)log->mgmtData;
+
+    pthread_mutex_lock(&info->latch);
+    *result = info->endLSN;
+    pthread_mutex_unlock(&info->latch);
+    return RC_OK;
+}
+
+RC getNumLogFlushes(LogHandle *log, int *result)
+{
+    LG_LogInfo *info = (LG_LogInfo *)log->mgmtData;
+
+    pthread_mutex_lock(&info->latch);
+    *result = info->numFlushes;
+    pthread_mutex_unlock(&info->latch);
+    return RC_OK;
+}
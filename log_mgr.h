@@ -0,0 +1,78 @@
+#ifndef LOG_MGR_H
+#define LOG_MGR_H
+
+#include "dberror.h"
+#include "dt.h"
+
+// Write-ahead log: an append-only page file of log records, accessed through the storage manager.
+// A record is identified by its LSN, the position of the record in the log, so LSNs grow with every
+// record; NO_LSN is no record. Records are appended to a buffer in memory and only become durable
+// through flushLog. Threads flushing at the same time share one write and one sync of the log file:
+// while one of them writes the buffer, the others wait, and the next one writes all records appended
+// meanwhile (group commit).
+typedef long LSN;
+#define NO_LSN 0
+
+// Kinds of log records, the record manager defines their bodies
+typedef enum LogRecordType
+{
+	LOG_INSERT = 1,	   // a tuple was inserted into a slot
+	LOG_DELETE = 2,	   // a tuple was deleted from a slot
+	LOG_UPDATE = 3,	   // a tuple was overwritten
+	LOG_PAGE_INIT = 4, // a data page was formatted
+	LOG_PAGE_LINK = 5, // a data page was linked to the next page of its table
+	LOG_COMMIT = 6,	   // a transaction committed
+	LOG_COMPENSATION = 7, // recovery undid a change of a transaction that did not commit
+	LOG_ABORT = 8,	   // recovery rolled back a transaction
+	LOG_CHECKPOINT_BEGIN = 9, // a checkpoint started
+	LOG_CHECKPOINT_END = 10   // a checkpoint wrote its pages and recorded the dirty pages and active transactions
+} LogRecordType;
+
+// Header of a log record, followed by the record's body
+typedef struct LogRecord
+{
+	int size;			   // of header and body in bytes
+	int type;
+	long xid;			   // transaction that wrote the record, 0 for none
+	LSN prevLSN;		   // previous record of the transaction, NO_LSN for its first one
+	unsigned int checksum; // of header and body, a torn record at the end of the log does not match
+} LogRecord;
+
+#define LOG_BODY(record) ((char *)(record) + sizeof(LogRecord))
+
+typedef struct LogHandle
+{
+	char *fileName;
+	void *mgmtData;
+} LogHandle;
+
+// create, open, and close a log; opening finds the end of the log behind its last intact record,
+// closing flushes the log
+extern RC createLog (char *fileName);
+extern RC openLog (LogHandle **log, char *fileName);
+extern RC closeLog (LogHandle *log);
+
+// append a record with the given body and return its LSN; flushLog makes the log durable up to and
+// including the record at lsn
+extern RC appendLogRecord (LogHandle *log, int type, long xid, LSN prevLSN, char *body, int bodySize, LSN *lsn);
+extern RC flushLog (LogHandle *log, LSN lsn);
+
+// read the record at lsn into *record, which the caller frees; reading at the end of the log
+// returns RC_LOG_NO_MORE_RECORDS. The next record follows at lsn + (*record)->size.
+extern RC readLogRecord (LogHandle *log, LSN lsn, LogRecord **record);
+
+// The checkpoint of a log is the LSN of its last complete checkpoint record, NO_LSN if there is none,
+// stored in the header page of the log. setLogCheckpoint makes the new checkpoint durable.
+extern RC setLogCheckpoint (LogHandle *log, LSN lsn);
+extern RC getLogCheckpoint (LogHandle *log, LSN *result);
+
+// Drop the log before the record at lsn, but never the log that is not durable yet. The pages from the one
+// holding lsn on are copied to a new log file, which replaces the old one; the records keep their LSNs.
+extern RC truncateLog (LogHandle *log, LSN lsn);
+
+// access information about a log
+extern RC getLogStart (LogHandle *log, LSN *result);
+extern RC getLogEnd (LogHandle *log, LSN *result);
+extern RC getNumLogFlushes (LogHandle *log, int *result);
+
+#endif // LOG_MGR_H
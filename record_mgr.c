@@ -1,439 +1,3120 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
 #include "dberror.h"
 #include "expr.h"
 #include "tables.h"
 #include "record_mgr.h"
 #include "storage_mgr.h"
 #include "buffer_mgr.h"
+#include "btree_mgr.h"
+#include "hash_mgr.h"
+#include "log_mgr.h"
+
+BM_BufferPool bm;  // buffer pool all table pages are accessed through
+int totalNumPages; // number of pages in the page file, new pages are taken from it atomically
+LogHandle *wal;    // write-ahead log of the changes to data pages
+
+#define CATALOG_PAGE 0      // first data page of the catalog
+#define CATALOG_BUCKETS 64  // initial number of buckets of the table map, doubled as tables are added
+#define BUFFER_POOL_SIZE 16 // number of frames in the record manager's buffer pool
+#define DIRTY_HIGH_WATER (BUFFER_POOL_SIZE / 2) // dirty frames at which the page cleaner starts writing pages back
+#define SCAN_RING_SIZE 4    // number of frames a scan recycles its pages in
+#define SCAN_PREFETCH_PAGES 4 // number of pages a full scan reads ahead of its current page
+#define CHECKPOINT_LOG_BYTES (1 << 20) // log written since the last checkpoint at which the next one is taken
+#define CHECKPOINT_INTERVAL_MS 100     // the checkpointer checks the log this often
+#define VERSION_GC_MIN 1024 // older tuple versions of a table at which changes start collecting garbage
+
+// Layout of a data page:
+//   RM_PageHeader | slot bitmap (one bit per slot, set if used, in 64-bit words) | tuple area (numSlots fixed-size tuples)
+// The pages of a table form a singly linked list starting at firstPage.
+typedef struct RM_PageHeader
+{
+    PageNumber nextPage; // next data page of the same table, NO_PAGE on the last page
+    int numSlots;        // number of slots on this page
+    int numUsed;         // number of occupied slots
+    int tupleOffset;     // offset of the tuple area from the start of the page
+    LSN pageLSN;         // log record of the last change of the page
+} RM_PageHeader;
+
+#define PAGE_HEADER(data) ((RM_PageHeader *)(data))
+#define SLOT_BITMAP(data) ((uint64_t *)((data) + sizeof(RM_PageHeader)))
+#define BITMAP_WORDS(numBits) (((numBits) + 63) / 64)
+#define TUPLE_PTR(data, slot, recordSize) ((data) + PAGE_HEADER(data)->tupleOffset + (slot) * (recordSize))
+
+// Every change of a data page is logged before the page is unlatched, and the page is stamped with the LSN of
+// its record; the buffer pool writes no page before the log is durable up to the page's LSN.
+// Body of LOG_INSERT, LOG_DELETE, and LOG_UPDATE records: the slot, followed by the old tuple (delete, update)
+// and the new tuple (insert, update)
+typedef struct RM_TupleLogBody
+{
+    RID id;
+    int recordSize;
+} RM_TupleLogBody;
+
+// Body of LOG_PAGE_INIT and LOG_PAGE_LINK records. Allocating a page belongs to no transaction.
+typedef struct RM_PageLogBody
+{
+    PageNumber pageNum;
+    PageNumber nextPage; // page linked behind pageNum
+    int numSlots;        // of a formatted page
+} RM_PageLogBody;
+
+// Body of LOG_COMPENSATION records, written when recovery undoes a change: the slot and whether it holds a tuple
+// after the undo, followed by that tuple. Redoing a compensation record repeats the undo, undoNextLSN skips the
+// undone changes if recovery is interrupted and runs again.
+typedef struct RM_CompensationLogBody
+{
+    LSN undoNextLSN; // next record of the transaction to undo, NO_LSN once it is rolled back
+    RID id;
+    int recordSize;
+    bool used;
+} RM_CompensationLogBody;
+
+// Body of LOG_CHECKPOINT_END records, followed by numTransactions RM_CheckpointTransaction and numPages
+// RM_CheckpointPage entries: the active transactions and the dirty pages once the checkpoint wrote the pages
+// that were dirty at its LOG_CHECKPOINT_BEGIN record
+typedef struct RM_CheckpointLogBody
+{
+    LSN beginLSN;
+    long lastXid;
+    int numTransactions;
+    int numPages;
+    bool shutdown; // every page of the buffer pool, the unlogged index pages included, was written before the checkpoint
+} RM_CheckpointLogBody;
+
+typedef struct RM_CheckpointTransaction
+{
+    long xid;
+    LSN firstLSN;
+    LSN lastLSN;
+} RM_CheckpointTransaction;
+
+typedef struct RM_CheckpointPage
+{
+    PageNumber pageNum;
+    LSN recLSN; // oldest change of the page that is not in the page file
+} RM_CheckpointPage;
+
+// A transaction chains its log records through their prevLSN and ends with a LOG_COMMIT record.
+// Running transactions are listed for checkpoints.
+typedef struct RM_Transaction
+{
+    long xid;
+    LSN firstLSN; // first record of the transaction
+    LSN lastLSN;  // last record of the transaction, NO_LSN while it changed nothing
+    struct RM_Transaction *prev;
+    struct RM_Transaction *next;
+} RM_Transaction;
+
+// Multi-version concurrency control: the data pages hold the newest version of every tuple, and the older
+// versions are kept in memory for the snapshots that still see them. Before a transaction changes a slot for
+// the first time, the slot's version is pushed onto the slot's chain, stamped with the transaction as the end
+// of its lifetime; the version after it, up to the next change, begins with that transaction. A reader walks
+// the chain from the newest version back until it reaches a change its snapshot sees. Transactions only end
+// by committing, recovery rolls back the others before any snapshot is taken.
+typedef struct RM_Version
+{
+    long endXid;               // transaction that changed the slot
+    bool used;                 // the slot held a tuple before the change
+    struct RM_Version *older;  // version before this one, NULL if every snapshot sees this one's begin
+    char tuple[];              // the tuple if used
+} RM_Version;
+
+// Older versions of the slots of a data page
+typedef struct RM_PageVersions
+{
+    PageNumber pageNum;
+    int numChains;       // slots with older versions
+    RM_Version **chains; // newest older version of every slot, NULL for none
+    struct RM_PageVersions *nextInBucket;
+} RM_PageVersions;
+
+// A page with a slot freed by a transaction that may still be running
+typedef struct RM_FreedPage
+{
+    long xid;
+    PageNumber pageNum;
+    struct RM_FreedPage *next;
+} RM_FreedPage;
 
-SM_FileHandle fh;                 // file handle
-SM_PageHandle ph;                 // pointer to memory storing the page data
-int totalNumPages;                // start from 1
-int currentPageNum = 0;           // start from 0
-int slots = 99999;                // 100 records per page
-int recordSize = PAGE_SIZE / 100; // 4 bytes for each record
-int numSlotsPerPage;              // 100 slots per page (100 records per page)
+// The transactions a reader sees: those that ended before the snapshot was taken, and the reader's own
+typedef struct RM_Snapshot
+{
+    long xmin;      // transactions before xmin had ended
+    long xmax;      // transactions from xmax on had not begun
+    long *running;  // transactions from xmin to xmax that were running
+    int numRunning;
+    long own;       // transaction of the reader, 0 for none
+    bool registered; // the snapshot keeps the versions it sees from garbage collection
+    struct RM_Snapshot *prev;
+    struct RM_Snapshot *next;
+} RM_Snapshot;
+
+// The catalog is a table of its own whose data pages start at CATALOG_PAGE, with one fixed-size tuple per table.
+// The tuple count and the free space map of a table are not stored: they are rebuilt from its data pages when the
+// table is first opened, so keeping them does not take a catalog change with every insert and delete.
+#define CATALOG_NAME_SIZE 64    // longest table name, with its terminating zero
+#define CATALOG_SCHEMA_SIZE 440 // longest serialized schema, see writeCatalogSchema
+
+typedef struct RM_CatalogEntry
+{
+    char name[CATALOG_NAME_SIZE];
+    PageNumber firstPage; // first data page of the table
+    PageNumber indexPage; // header page of the B+-tree over the key, NO_PAGE if the schema has no key
+    PageNumber hashPage;  // header page of the hash index over the key
+    int schemaSize;
+    char schema[CATALOG_SCHEMA_SIZE];
+} RM_CatalogEntry;
 
 // table and manager
 typedef struct RM_TableInfo
 {
     RM_TableData *rel;
     int numTuples;
-    Record *records;
-    int *slotsBitMap;
-    int numSlotsPerPage;
-    int totalNumPages;
-    int currentPageNum;
+    int recordSize;      // size of one tuple in bytes
+    int numSlotsPerPage; // number of tuples fitting on one data page
+    PageNumber firstPage; // first data page of the table
+    PageNumber lastPage;  // last data page of the table
+    int totalNumPages;   // number of data pages of the table
+
+    // free space map: one bit per page of the file, set if the page belongs to the table and has a free slot
+    uint64_t *freeSpaceMap;
+    int freeSpaceMapWords; // number of words in freeSpaceMap
+    int freeSpaceMapFirst; // lowest word that may have a bit set
+
+    // Indexes over the key attributes, NULL if the schema has no key: a B+-tree for ordered
+    // access and a hash index enforcing unique keys
+    BTreeHandle *index;
+    HashHandle *primaryKey;
+    char *keys; // room for the old and the new key of a record, and a key to compare them with
+    char *logBody; // room for the body of a tuple's log record
+
+    // Serializes the changes to the table and the use of its indexes; readers of the data pages
+    // only latch the pages they read
+    pthread_mutex_t latch;
+    int numHandles; // number of open RM_TableData handles, the table info is their mgmtData
+
+    // Catalog: the tuple of the table, whether the fields rebuilt from the data pages are loaded,
+    // and the next table in the same bucket of the table map
+    RID catalogId;
+    bool loaded;
+    struct RM_TableInfo *nextInBucket;
+
+    // Older tuple versions in a chained hash map by page. A version is pushed and read under the latch of its page
+    // as well, so readers without older versions on their page do not take the version latch for long.
+    pthread_mutex_t versionLatch;
+    RM_PageVersions **versionMap;
+    int versionMapMask;  // number of buckets minus one, the number of buckets is a power of two
+    int numVersionPages;
+    int numVersions;
+    int versionLimit;    // number of versions at which the next change collects garbage
+
+    // Pages with slots freed by deletes, they only enter the free space map once the deleting transaction ended,
+    // so no other transaction takes a slot whose tuple recovery may still restore; see releaseFreedPages
+    struct RM_FreedPage *freedPages;
 } RM_TableInfo;
 
-// handling records in a table
-RM_TableInfo *tables[10];
-int tableIndex = -1;
-int currentActiveTableIndex = -1;
-RM_TableData *currentActiveTable = NULL;
-int TABLE_INFO_PAGE_NUM = 0;
+// Bookkeeping for a running scan, stored in RM_ScanHandle.mgmtData
+typedef struct RM_ScanInfo
+{
+    Expr *cond;            // selection condition, NULL selects every tuple
+    ExprProgram *program;  // the condition compiled against the table's schema
+    RID current;           // next slot to be examined
+    BM_AccessRing *ring;   // frames the scan reads its pages into
+    uint64_t *selection;   // slots of the current page satisfying the condition, if the program has a filter
+    PageNumber readAhead;  // pages before this one were queued for read-ahead
+
+    // Access path: a condition bounding the key drives the scan from the table's B+-tree, the whole
+    // condition is still evaluated on the fetched tuples
+    BT_ScanHandle *indexScan; // NULL for a full table scan
+    char *keys;               // lower bound, upper bound, key of the current entry, and key of its tuple
+    bool hasLower;
+    bool hasUpper;
+    bool indexDone;           // the index scan passed the upper bound or the last entry
+
+    // The scan reads the tuples as of the snapshot taken when it started, older versions are copied to tuple
+    RM_Snapshot *snapshot;
+    char *tuple;
+} RM_ScanInfo;
+
+// handling records in a table: the catalog and its tables by name, in a chained hash map
+RM_TableInfo *catalog;
+RM_TableInfo **tableMap;
+int tableMapMask; // number of buckets minus one, the number of buckets is a power of two
+int numTables;
+pthread_mutex_t catalogLatch = PTHREAD_MUTEX_INITIALIZER; // protects the catalog and the table map
 
 // Define the file name and the no table ref
 char *filename = "database.bin";
-char *NO_TABLE = "Deleted Table";
+char *logFilename = "database.log";
+
+// Transactions: the transaction begun by a thread, NULL if its changes commit one by one
+static __thread RM_Transaction *currentTransaction;
+long lastXid; // advanced atomically
+RM_Transaction *activeTransactions; // list of the running transactions
+pthread_mutex_t transactionLatch = PTHREAD_MUTEX_INITIALIZER; // protects the lists, see commitChanges
+RM_Snapshot *activeSnapshots; // list of the registered snapshots
+
+// Checkpoints: taken one at a time by takeCheckpoint, by a background thread once enough log was written
+pthread_mutex_t checkpointLatch = PTHREAD_MUTEX_INITIALIZER;
+LSN lastCheckpointLSN; // LOG_CHECKPOINT_BEGIN record of the last checkpoint, NO_LSN if none was taken
+pthread_t checkpointer;
+pthread_mutex_t checkpointerLatch = PTHREAD_MUTEX_INITIALIZER; // protects stopCheckpointer
+pthread_cond_t checkpointerWakeup = PTHREAD_COND_INITIALIZER;
+bool stopCheckpointer;
+
+// FNV-1a hash of a table name
+static unsigned int hashTableName(char *name)
+{
+    unsigned int hash = 2166136261u;
+    for (; *name != '\0'; name++)
+    {
+        hash = (hash ^ (unsigned char)*name) * 16777619u;
+    }
+    return hash;
+}
 
-RC initRecordManager(void *mgmtData)
+// Find a table in the table map, NULL if it does not exist
+static RM_TableInfo *findTable(char *name)
 {
-    // Initialize the table index
-    tableIndex = 0;
-    // Initialize the current active table index
-    currentActiveTableIndex = tableIndex;
+    RM_TableInfo *info = tableMap[hashTableName(name) & tableMapMask];
+    while (info != NULL && strcmp(info->rel->name, name) != 0)
+    {
+        info = info->nextInBucket;
+    }
+    return info;
+}
 
-    // Initialize the tables array
-    for (int i = 0; i < 10; i++)
+// Add a table to the table map, doubling the buckets once there are more tables than buckets
+static void addTable(RM_TableInfo *info)
+{
+    if (numTables > tableMapMask)
     {
-        tables[i] = NULL; // Set all the table pointers to NULL initially
+        int numBuckets = 2 * (tableMapMask + 1);
+        RM_TableInfo **buckets = (RM_TableInfo **)calloc(numBuckets, sizeof(RM_TableInfo *));
+        for (int b = 0; b <= tableMapMask; b++)
+        {
+            while (tableMap[b] != NULL)
+            {
+                RM_TableInfo *moved = tableMap[b];
+                tableMap[b] = moved->nextInBucket;
+                int bucket = hashTableName(moved->rel->name) & (numBuckets - 1);
+                moved->nextInBucket = buckets[bucket];
+                buckets[bucket] = moved;
+            }
+        }
+        free(tableMap);
+        tableMap = buckets;
+        tableMapMask = numBuckets - 1;
     }
 
-    // Initialize the storage manager
-    initStorageManager();
-    // Initialize the file handle
-    createPageFile(filename);
-    openPageFile(filename, &fh);
-    // Initialize the page handle
-    ph = (SM_PageHandle)malloc(PAGE_SIZE);
-    // Initialize the total number of pages
-    totalNumPages = fh.totalNumPages;
-    // Initialize the current page number
-    currentPageNum = 0;
-    // Initialize the number of slots per page
-    numSlotsPerPage = PAGE_SIZE / recordSize;
-
-    // Initialize the buffer manager
-    initBufferPool(&fh, filename, 3, RS_FIFO, NULL);
-    // Pin the first page
-    pinPage(&fh, &ph, TABLE_INFO_PAGE_NUM);
-
-    // Return OK status code if initialization is successful
-    return RC_OK;
+    int bucket = hashTableName(info->rel->name) & tableMapMask;
+    info->nextInBucket = tableMap[bucket];
+    tableMap[bucket] = info;
+    numTables++;
 }
 
-RC shutdownRecordManager()
+// Remove a table from the table map
+static void removeTable(RM_TableInfo *info)
+{
+    RM_TableInfo **link = &tableMap[hashTableName(info->rel->name) & tableMapMask];
+    while (*link != info)
+    {
+        link = &(*link)->nextInBucket;
+    }
+    *link = info->nextInBucket;
+    numTables--;
+}
+
+// Number of slots fitting on a data page, counting one bitmap bit and one tuple per slot
+static int slotsPerPage(int recordSize)
+{
+    int numSlots = (int)((PAGE_SIZE - sizeof(RM_PageHeader)) * 8 / (recordSize * 8 + 1));
+
+    // The bitmap is stored in whole words
+    while (sizeof(RM_PageHeader) + BITMAP_WORDS(numSlots) * sizeof(uint64_t) + numSlots * recordSize > PAGE_SIZE)
+    {
+        numSlots--;
+    }
+    return numSlots;
+}
+
+static bool isSlotUsed(char *data, int slot)
+{
+    return (SLOT_BITMAP(data)[slot / 64] >> (slot % 64)) & 1;
+}
+
+static void setSlotUsed(char *data, int slot, bool used)
+{
+    if (used)
+    {
+        SLOT_BITMAP(data)[slot / 64] |= (uint64_t)1 << (slot % 64);
+    }
+    else
+    {
+        SLOT_BITMAP(data)[slot / 64] &= ~((uint64_t)1 << (slot % 64));
+    }
+}
+
+// Find the first set bit of a bitmap of numBits bits at or after a given bit, -1 if there is none
+static int findSetBit(const uint64_t *bitmap, int numBits, int from)
 {
-    int i; // Loop counter
-    // Reset the table info
-    for (i = 0; i < 10; i++)
+    int numWords = BITMAP_WORDS(numBits);
+    int w = from / 64;
+
+    if (from < 0 || w >= numWords)
+    {
+        return -1;
+    }
+
+    // Ignore the bits before `from` in its word
+    uint64_t word = bitmap[w] & (~(uint64_t)0 << (from % 64));
+    while (word == 0)
     {
-        // Free the memory allocated for the table info
-        if (tables[i] != NULL)
+        if (++w == numWords)
         {
-            free(tables[i]->rel);         // Free the memory allocated for the table info
-            free(tables[i]->records);     // Free the memory allocated for the records
-            free(tables[i]->slotsBitMap); // Free the memory allocated for the slots bit map
-            free(tables[i]);              // Free the memory allocated for the table info
+            return -1;
         }
+        word = bitmap[w];
     }
+    return w * 64 + __builtin_ctzll(word);
+}
 
-    shutdownBufferPool(&fh);
+// Find the first used slot of a page at or after a given slot, -1 if there is none
+static int findUsedSlot(char *data, int from)
+{
+    return findSetBit(SLOT_BITMAP(data), PAGE_HEADER(data)->numSlots, from);
+}
 
-    // Return OK status code if shutdown is successful
-    return RC_OK;
+// Record in the table's free space map whether a page has a free slot
+static void setPageFree(RM_TableInfo *info, PageNumber pageNum, bool hasFreeSlot)
+{
+    int w = pageNum / 64;
+
+    // Grow the map to cover the page
+    if (w >= info->freeSpaceMapWords)
+    {
+        int numWords = (2 * info->freeSpaceMapWords > w + 1) ? 2 * info->freeSpaceMapWords : w + 1;
+        info->freeSpaceMap = (uint64_t *)realloc(info->freeSpaceMap, numWords * sizeof(uint64_t));
+        memset(info->freeSpaceMap + info->freeSpaceMapWords, 0, (numWords - info->freeSpaceMapWords) * sizeof(uint64_t));
+        info->freeSpaceMapWords = numWords;
+    }
+
+    if (hasFreeSlot)
+    {
+        info->freeSpaceMap[w] |= (uint64_t)1 << (pageNum % 64);
+        if (w < info->freeSpaceMapFirst)
+        {
+            info->freeSpaceMapFirst = w;
+        }
+    }
+    else
+    {
+        info->freeSpaceMap[w] &= ~((uint64_t)1 << (pageNum % 64));
+    }
 }
 
-RC createTable(char *name, Schema *schema)
+// Find the lowest page of the table with a free slot, NO_PAGE if all pages are full
+static PageNumber findFreePage(RM_TableInfo *info)
+{
+    for (int w = info->freeSpaceMapFirst; w < info->freeSpaceMapWords; w++)
+    {
+        if (info->freeSpaceMap[w] != 0)
+        {
+            info->freeSpaceMapFirst = w;
+            return w * 64 + __builtin_ctzll(info->freeSpaceMap[w]);
+        }
+    }
+
+    info->freeSpaceMapFirst = info->freeSpaceMapWords;
+    return NO_PAGE;
+}
+
+// Free a chain of versions
+static void freeVersions(RM_Version *version)
 {
-    // Pin the first page
-    pinPage(&fh, &ph, TABLE_INFO_PAGE_NUM);
+    while (version != NULL)
+    {
+        RM_Version *older = version->older;
+        free(version);
+        version = older;
+    }
+}
 
-    // Check if the table already exists
-    int i;
-    for (i = 0; i < 10; i++)
+static void freeTableInfo(RM_TableInfo *info)
+{
+    if (info->index != NULL)
+    {
+        closeBtree(info->index);
+    }
+    if (info->primaryKey != NULL)
+    {
+        closeHash(info->primaryKey);
+    }
+    for (int b = 0; b <= info->versionMapMask; b++)
     {
-        if (tables[i] != NULL && strcmp(tables[i]->rel->name, name) == 0)
+        while (info->versionMap[b] != NULL)
         {
-            // If the table already exists, return an error code
-            return RC_TABLE_ALREADY_EXISTS;
+            RM_PageVersions *versions = info->versionMap[b];
+            info->versionMap[b] = versions->nextInBucket;
+            for (int slot = 0; slot < info->numSlotsPerPage; slot++)
+            {
+                freeVersions(versions->chains[slot]);
+            }
+            free(versions->chains);
+            free(versions);
         }
     }
+    free(info->versionMap);
+    while (info->freedPages != NULL)
+    {
+        RM_FreedPage *freed = info->freedPages;
+        info->freedPages = freed->next;
+        free(freed);
+    }
+    pthread_mutex_destroy(&info->versionLatch);
+    pthread_mutex_destroy(&info->latch);
+    free(info->keys);
+    free(info->logBody);
+    free(info->rel->name);
+    freeSchema(info->rel->schema);
+    free(info->rel);
+    free(info->freeSpaceMap);
+    free(info);
+}
 
-    // Create the table
-    RM_TableData *rel = (RM_TableData *)malloc(sizeof(RM_TableData));
-    rel->name = name;
-    rel->schema = schema;
-    rel->mgmtData = NULL;
+// Mark a modified page dirty and release it
+static RC releaseDirtyPage(BM_PageHandle *page)
+{
+    RC rc = markDirty(&bm, page);
+    unpinPage(&bm, page);
+    return rc;
+}
 
-    // Create the table info
-    tables[currentActiveTableIndex] = (RM_TableInfo *)malloc(sizeof(RM_TableInfo));
-    tables[currentActiveTableIndex]->rel = rel;
-    tables[currentActiveTableIndex]->numTuples = 0;
-    tables[currentActiveTableIndex]->records = (Record *)malloc(sizeof(Record) * slots);
-    tables[currentActiveTableIndex]->slotsBitMap = (int *)malloc(sizeof(int) * slots);
-    // Initialize the slots bit map
-    for (int i = 0; i < slots; i++)
+// Log a change of a pinned data page, made under its exclusive latch, and stamp the page with the record's LSN.
+// Changes outside of a transaction (txn NULL) are never undone.
+static RC logPageChange(RM_Transaction *txn, BM_PageHandle *page, int type, char *body, int bodySize)
+{
+    LSN lsn;
+    RC rc = appendLogRecord(wal, type, (txn != NULL) ? txn->xid : 0, (txn != NULL) ? txn->lastLSN : NO_LSN, body, bodySize, &lsn);
+    if (rc != RC_OK)
+    {
+        return rc;
+    }
+    if (txn != NULL)
     {
-        tables[currentActiveTableIndex]->slotsBitMap[i] = 0;
+        // Checkpoints read the LSNs of running transactions
+        if (txn->lastLSN == NO_LSN)
+        {
+            __atomic_store_n(&txn->firstLSN, lsn, __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(&txn->lastLSN, lsn, __ATOMIC_RELAXED);
     }
-    // Initialize the table info
-    tables[currentActiveTableIndex]->numSlotsPerPage = slots;
-    tables[currentActiveTableIndex]->totalNumPages = 1;
-    tables[currentActiveTableIndex]->currentPageNum = 0;
 
-    tableIndex++; // Increment the table index
+    PAGE_HEADER(page->data)->pageLSN = lsn;
+    return setPageLSN(&bm, page, lsn);
+}
+
+// Log a tuple change; before and after point to the tuple before and after the change, NULL if there is none
+static RC logTupleChange(RM_TableInfo *info, RM_Transaction *txn, BM_PageHandle *page, int type, RID id, char *before, char *after)
+{
+    RM_TupleLogBody *body = (RM_TupleLogBody *)info->logBody;
+    char *tuple = info->logBody + sizeof(RM_TupleLogBody);
 
-    // Write the table info to the first page
-    // memcpy(ph, serializeTableInfo(rel), sizeof(RM_TableData));
-    markDirty(&fh, &ph);
-    unpinPage(&fh, &ph);
+    body->id = id;
+    body->recordSize = info->recordSize;
+    if (before != NULL)
+    {
+        memcpy(tuple, before, info->recordSize);
+        tuple += info->recordSize;
+    }
+    if (after != NULL)
+    {
+        memcpy(tuple, after, info->recordSize);
+        tuple += info->recordSize;
+    }
+    return logPageChange(txn, page, type, info->logBody, (int)(tuple - info->logBody));
+}
 
-    // Return OK status code if table creation is successful
-    return RC_OK;
+static RC flushLogBeforePage(void *log, long lsn)
+{
+    return flushLog((LogHandle *)log, lsn);
 }
 
-RC openTable(RM_TableData *rel, char *name)
+// Start a transaction and add it to the running transactions
+static void startTransaction(RM_Transaction *txn)
 {
-    // Pin the first page
-    pinPage(&fh, &ph, TABLE_INFO_PAGE_NUM);
+    txn->firstLSN = NO_LSN;
+    txn->lastLSN = NO_LSN;
+    txn->prev = NULL;
+
+    // A snapshot sees every transaction below its xmax that is not listed as running
+    pthread_mutex_lock(&transactionLatch);
+    txn->xid = __atomic_add_fetch(&lastXid, 1, __ATOMIC_RELAXED);
+    txn->next = activeTransactions;
+    if (activeTransactions != NULL)
+    {
+        activeTransactions->prev = txn;
+    }
+    activeTransactions = txn;
+    pthread_mutex_unlock(&transactionLatch);
+}
 
-    // Check if the table exists
-    int i;
-    for (i = 0; i < 10; i++)
+// Transaction of a change: the thread's transaction, or a new one for just this change
+static RM_Transaction *changeTransaction(RM_Transaction *single)
+{
+    if (currentTransaction != NULL)
     {
-        // If the table exists, set the current active table to the table
-        if (tables[i] != NULL && strcmp(tables[i]->rel->name, name) == 0)
+        return currentTransaction;
+    }
+    startTransaction(single);
+    return single;
+}
+
+// Log the commit of a transaction and wait until it is durable. Committing threads wait for the
+// same log write, so one sync of the log commits many transactions. The commit record is logged
+// and the transaction removed from the running ones at once, so a checkpoint never lists a
+// transaction whose commit record comes before its own.
+static RC commitChanges(RM_Transaction *txn)
+{
+    LSN lsn = NO_LSN;
+    RC rc = RC_OK;
+
+    pthread_mutex_lock(&transactionLatch);
+    if (txn->lastLSN != NO_LSN)
+    {
+        rc = appendLogRecord(wal, LOG_COMMIT, txn->xid, txn->lastLSN, NULL, 0, &lsn);
+    }
+    if (txn->prev != NULL)
+    {
+        txn->prev->next = txn->next;
+    }
+    else
+    {
+        activeTransactions = txn->next;
+    }
+    if (txn->next != NULL)
+    {
+        txn->next->prev = txn->prev;
+    }
+    pthread_mutex_unlock(&transactionLatch);
+
+    if (rc != RC_OK || lsn == NO_LSN)
+    {
+        return rc;
+    }
+    return flushLog(wal, lsn);
+}
+
+// Finish a change made by changeTransaction, committing it unless it belongs to the thread's transaction.
+// The table latch is released by now, so other changes proceed while the commit waits for the log.
+static RC finishChange(RM_Transaction *txn, RC rc)
+{
+    if (txn == currentTransaction)
+    {
+        return rc;
+    }
+
+    // Whatever a failed change logged is committed as well, it is on the page
+    RC rcCommit = commitChanges(txn);
+    return (rc != RC_OK) ? rc : rcCommit;
+}
+
+// snapshots and versions
+
+// Take a snapshot of the ended transactions for the thread
+static RM_Snapshot *takeSnapshot(bool registered)
+{
+    RM_Snapshot *snapshot = (RM_Snapshot *)malloc(sizeof(RM_Snapshot));
+    int maxRunning = 0;
+
+    pthread_mutex_lock(&transactionLatch);
+    for (RM_Transaction *txn = activeTransactions; txn != NULL; txn = txn->next)
+    {
+        maxRunning++;
+    }
+    snapshot->running = (long *)malloc((maxRunning > 0 ? maxRunning : 1) * sizeof(long));
+    snapshot->numRunning = 0;
+    snapshot->xmax = lastXid + 1;
+    snapshot->xmin = snapshot->xmax;
+    for (RM_Transaction *txn = activeTransactions; txn != NULL; txn = txn->next)
+    {
+        snapshot->running[snapshot->numRunning++] = txn->xid;
+        snapshot->xmin = (txn->xid < snapshot->xmin) ? txn->xid : snapshot->xmin;
+    }
+    snapshot->own = (currentTransaction != NULL) ? currentTransaction->xid : 0;
+    snapshot->registered = registered;
+    snapshot->prev = NULL;
+    snapshot->next = NULL;
+    if (registered)
+    {
+        snapshot->next = activeSnapshots;
+        if (activeSnapshots != NULL)
+        {
+            activeSnapshots->prev = snapshot;
+        }
+        activeSnapshots = snapshot;
+    }
+    pthread_mutex_unlock(&transactionLatch);
+
+    return snapshot;
+}
+
+static void releaseSnapshot(RM_Snapshot *snapshot)
+{
+    if (snapshot->registered)
+    {
+        pthread_mutex_lock(&transactionLatch);
+        if (snapshot->prev != NULL)
+        {
+            snapshot->prev->next = snapshot->next;
+        }
+        else
+        {
+            activeSnapshots = snapshot->next;
+        }
+        if (snapshot->next != NULL)
+        {
+            snapshot->next->prev = snapshot->prev;
+        }
+        pthread_mutex_unlock(&transactionLatch);
+    }
+    free(snapshot->running);
+    free(snapshot);
+}
+
+// Whether a snapshot sees the changes of a transaction
+static bool isVisible(RM_Snapshot *snapshot, long xid)
+{
+    if (xid == snapshot->own || xid < snapshot->xmin)
+    {
+        return true;
+    }
+    if (xid >= snapshot->xmax)
+    {
+        return false;
+    }
+    for (int i = 0; i < snapshot->numRunning; i++)
+    {
+        if (snapshot->running[i] == xid)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Older versions of a page, added if there are none and add is set; NULL if there are none.
+// The caller holds the version latch.
+static RM_PageVersions *findPageVersions(RM_TableInfo *info, PageNumber pageNum, bool add)
+{
+    unsigned int hash = (unsigned int)pageNum * 2654435761u;
+    RM_PageVersions *versions = info->versionMap[hash & info->versionMapMask];
+    while (versions != NULL && versions->pageNum != pageNum)
+    {
+        versions = versions->nextInBucket;
+    }
+    if (versions != NULL || !add)
+    {
+        return versions;
+    }
+
+    // Double the buckets once there are more pages than buckets
+    if (info->numVersionPages > info->versionMapMask)
+    {
+        int numBuckets = 2 * (info->versionMapMask + 1);
+        RM_PageVersions **buckets = (RM_PageVersions **)calloc(numBuckets, sizeof(RM_PageVersions *));
+        for (int b = 0; b <= info->versionMapMask; b++)
+        {
+            while (info->versionMap[b] != NULL)
+            {
+                RM_PageVersions *moved = info->versionMap[b];
+                info->versionMap[b] = moved->nextInBucket;
+                int bucket = ((unsigned int)moved->pageNum * 2654435761u) & (numBuckets - 1);
+                moved->nextInBucket = buckets[bucket];
+                buckets[bucket] = moved;
+            }
+        }
+        free(info->versionMap);
+        info->versionMap = buckets;
+        info->versionMapMask = numBuckets - 1;
+    }
+
+    versions = (RM_PageVersions *)malloc(sizeof(RM_PageVersions));
+    versions->pageNum = pageNum;
+    versions->numChains = 0;
+    versions->chains = (RM_Version **)calloc(info->numSlotsPerPage, sizeof(RM_Version *));
+    versions->nextInBucket = info->versionMap[hash & info->versionMapMask];
+    info->versionMap[hash & info->versionMapMask] = versions;
+    info->numVersionPages++;
+    return versions;
+}
+
+// Keep the version of a slot that a transaction is about to change, tuple is NULL for an empty slot. Only the
+// first change of the slot by the transaction pushes a version, the later ones replace the transaction's own.
+// The caller holds the exclusive latch of the page.
+static void pushVersion(RM_TableInfo *info, RM_Transaction *txn, RID id, char *tuple)
+{
+    pthread_mutex_lock(&info->versionLatch);
+    RM_PageVersions *versions = findPageVersions(info, id.page, true);
+    RM_Version *newest = versions->chains[id.slot];
+    if (newest == NULL || newest->endXid != txn->xid)
+    {
+        RM_Version *version = (RM_Version *)malloc(sizeof(RM_Version) + ((tuple != NULL) ? info->recordSize : 0));
+        version->endXid = txn->xid;
+        version->used = (tuple != NULL);
+        version->older = newest;
+        if (tuple != NULL)
+        {
+            memcpy(version->tuple, tuple, info->recordSize);
+        }
+        versions->chains[id.slot] = version;
+        versions->numChains += (newest == NULL) ? 1 : 0;
+        info->numVersions++;
+    }
+    pthread_mutex_unlock(&info->versionLatch);
+}
+
+// Copy the version of a slot that a snapshot sees, starting at the slot of a latched data page and going back
+// through the slot's older versions; false if the snapshot sees no tuple in the slot. The caller holds the
+// version latch.
+static bool readVisibleTuple(RM_TableInfo *info, RM_Snapshot *snapshot, char *data, RM_Version *chain, int slot, char *tuple)
+{
+    bool used = isSlotUsed(data, slot);
+    char *source = TUPLE_PTR(data, slot, info->recordSize);
+
+    for (RM_Version *version = chain; version != NULL && !isVisible(snapshot, version->endXid); version = version->older)
+    {
+        used = version->used;
+        source = version->tuple;
+    }
+    if (used)
+    {
+        memcpy(tuple, source, info->recordSize);
+    }
+    return used;
+}
+
+// Copy the version of a slot of a latched page that a snapshot sees, see readVisibleTuple. Without a snapshot
+// the latest committed version is read, and a snapshot is only taken if the slot has older versions.
+static bool readVersion(RM_TableInfo *info, RM_Snapshot *snapshot, BM_PageHandle *page, int slot, char *tuple)
+{
+    pthread_mutex_lock(&info->versionLatch);
+    RM_PageVersions *versions = findPageVersions(info, page->pageNum, false);
+    RM_Version *chain = (versions != NULL) ? versions->chains[slot] : NULL;
+    RM_Snapshot *latest = (chain != NULL && snapshot == NULL) ? takeSnapshot(false) : NULL;
+    bool used = readVisibleTuple(info, (latest != NULL) ? latest : snapshot, page->data, chain, slot, tuple);
+    pthread_mutex_unlock(&info->versionLatch);
+
+    if (latest != NULL)
+    {
+        releaseSnapshot(latest);
+    }
+    return used;
+}
+
+// Whether a transaction is still running
+static bool isRunning(long xid)
+{
+    bool running = false;
+
+    pthread_mutex_lock(&transactionLatch);
+    for (RM_Transaction *txn = activeTransactions; txn != NULL && !running; txn = txn->next)
+    {
+        running = (txn->xid == xid);
+    }
+    pthread_mutex_unlock(&transactionLatch);
+    return running;
+}
+
+// Whether the tuple in a slot of a latched data page or one of its older versions holds a key. With txn only the
+// versions ended by other running transactions count besides the tuple, recovery would bring those back. The
+// caller holds the table latch and the version latch.
+static bool holdsKey(RM_TableInfo *info, RM_Transaction *txn, char *data, RM_Version *chain, int slot, char *key)
+{
+    Schema *schema = info->rel->schema;
+    char *held = info->keys + 2 * getKeySize(schema);
+
+    if (isSlotUsed(data, slot))
+    {
+        getRecordKey(schema, TUPLE_PTR(data, slot, info->recordSize), held);
+        if (compareKeys(schema, held, key) == 0)
+        {
+            return true;
+        }
+    }
+    for (RM_Version *version = chain; version != NULL; version = version->older)
+    {
+        if (version->used && (txn == NULL || (version->endXid != txn->xid && isRunning(version->endXid))))
+        {
+            getRecordKey(schema, version->tuple, held);
+            if (compareKeys(schema, held, key) == 0)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Drop the index entries of a key for a slot of a latched data page once neither the tuple in the slot nor its
+// older versions hold the key; the entries stay while a snapshot may read such a version or recovery may bring it
+// back. The caller holds the table latch.
+static RC dropUnheldKey(RM_TableInfo *info, BM_PageHandle *page, int slot, char *key)
+{
+    RID id = {page->pageNum, slot};
+    RID holder;
+
+    pthread_mutex_lock(&info->versionLatch);
+    RM_PageVersions *versions = findPageVersions(info, page->pageNum, false);
+    bool held = holdsKey(info, NULL, page->data, (versions != NULL) ? versions->chains[slot] : NULL, slot, key);
+    pthread_mutex_unlock(&info->versionLatch);
+    if (held)
+    {
+        return RC_OK;
+    }
+
+    // The hash index may map the key to the tuple that took it over by now
+    RC rc = deleteKey(info->index, key, id);
+    if (rc == RC_OK && findHashKey(info->primaryKey, key, &holder) == RC_OK && holder.page == id.page && holder.slot == id.slot)
+    {
+        rc = deleteHashKey(info->primaryKey, key);
+    }
+    return rc;
+}
+
+// Drop the index entries of the keys that collected versions held, see dropUnheldKey. Entries that cannot be
+// dropped are harmless, the scans and the key lookups check the key of every tuple they find. The caller holds
+// the table latch.
+static void dropCollectedKeys(RM_TableInfo *info, RID *ids, char *keys, int numKeys)
+{
+    int keySize = getKeySize(info->rel->schema);
+    BM_PageHandle page;
+
+    for (int i = 0; i < numKeys; i++)
+    {
+        if (pinPage(&bm, &page, ids[i].page) == RC_OK)
         {
-            // Set the current active table
-            currentActiveTable = tables[i]->rel;
-            currentActiveTableIndex = i;
+            latchPage(&bm, &page, false);
+            dropUnheldKey(info, &page, ids[i].slot, keys + i * keySize);
+            unlatchPage(&bm, &page);
+            unpinPage(&bm, &page);
         }
     }
+}
+
+// Drop the versions no snapshot reads anymore: a version ended by a transaction that ended before every running
+// transaction and every registered snapshot began is seen by all of them, and so are the versions after it, so
+// it and the versions before it are dropped. The caller does not hold the table latch.
+static void collectVersions(RM_TableInfo *info)
+{
+    pthread_mutex_lock(&transactionLatch);
+    long horizon = lastXid + 1;
+    for (RM_Transaction *txn = activeTransactions; txn != NULL; txn = txn->next)
+    {
+        horizon = (txn->xid < horizon) ? txn->xid : horizon;
+    }
+    for (RM_Snapshot *snapshot = activeSnapshots; snapshot != NULL; snapshot = snapshot->next)
+    {
+        horizon = (snapshot->xmin < horizon) ? snapshot->xmin : horizon;
+    }
+    pthread_mutex_unlock(&transactionLatch);
+
+    // The index entries of the keys of the dropped versions are dropped with them, under the table latch
+    int keySize = (info->index != NULL) ? getKeySize(info->rel->schema) : 0;
+    RID *ids = NULL;
+    char *keys = NULL;
+    int numKeys = 0, maxKeys = 0;
+    if (info->index != NULL)
+    {
+        pthread_mutex_lock(&info->latch);
+    }
+
+    pthread_mutex_lock(&info->versionLatch);
+    for (int b = 0; b <= info->versionMapMask; b++)
+    {
+        RM_PageVersions **link = &info->versionMap[b];
+        while (*link != NULL)
+        {
+            RM_PageVersions *versions = *link;
+            versions->numChains = 0;
+            for (int slot = 0; slot < info->numSlotsPerPage; slot++)
+            {
+                RM_Version **older = &versions->chains[slot];
+                while (*older != NULL && (*older)->endXid >= horizon)
+                {
+                    older = &(*older)->older;
+                }
+                for (RM_Version *version = *older; version != NULL; version = version->older)
+                {
+                    info->numVersions--;
+                    if (info->index != NULL && version->used)
+                    {
+                        if (numKeys == maxKeys)
+                        {
+                            maxKeys = (maxKeys > 0) ? 2 * maxKeys : 64;
+                            ids = (RID *)realloc(ids, maxKeys * sizeof(RID));
+                            keys = (char *)realloc(keys, (size_t)maxKeys * keySize);
+                        }
+                        ids[numKeys].page = versions->pageNum;
+                        ids[numKeys].slot = slot;
+                        getRecordKey(info->rel->schema, version->tuple, keys + numKeys * keySize);
+                        numKeys++;
+                    }
+                }
+                freeVersions(*older);
+                *older = NULL;
+                versions->numChains += (versions->chains[slot] != NULL) ? 1 : 0;
+            }
+
+            // Pages without versions left are dropped
+            if (versions->numChains == 0)
+            {
+                *link = versions->nextInBucket;
+                free(versions->chains);
+                free(versions);
+                info->numVersionPages--;
+            }
+            else
+            {
+                link = &versions->nextInBucket;
+            }
+        }
+    }
+    info->versionLimit = (2 * info->numVersions > VERSION_GC_MIN) ? 2 * info->numVersions : VERSION_GC_MIN;
+    pthread_mutex_unlock(&info->versionLatch);
+
+    if (info->index != NULL)
+    {
+        dropCollectedKeys(info, ids, keys, numKeys);
+        pthread_mutex_unlock(&info->latch);
+    }
+    free(ids);
+    free(keys);
+}
+
+// Collect the garbage of a table once enough versions accumulated since the last time, after a change or a scan
+static void collectVersionsIfNeeded(RM_TableInfo *info)
+{
+    pthread_mutex_lock(&info->versionLatch);
+    bool collect = (info->numVersions >= info->versionLimit);
+    pthread_mutex_unlock(&info->versionLatch);
+    if (collect)
+    {
+        collectVersions(info);
+    }
+}
+
+// Whether another running transaction changed a slot. Its change is the newest version of the slot until it
+// commits, and recovery would undo it onto whatever is in the slot by then, so nobody else may change the slot
+// meanwhile. The caller holds the latch of the slot's page.
+static bool changedByOther(RM_TableInfo *info, RM_Transaction *txn, RID id)
+{
+    pthread_mutex_lock(&info->versionLatch);
+    RM_PageVersions *versions = findPageVersions(info, id.page, false);
+    long writer = (versions != NULL && versions->chains[id.slot] != NULL) ? versions->chains[id.slot]->endXid : 0;
+    pthread_mutex_unlock(&info->versionLatch);
+
+    return writer != 0 && writer != txn->xid && isRunning(writer);
+}
+
+// Take a key for a tuple of a transaction. The hash index keeps a key until the last version holding it is
+// collected, so the key is taken from the tuple it maps to unless that tuple holds it or another running
+// transaction changed the key away, see holdsKey. page is a latched data page of the transaction, or NULL.
+// The caller holds the table latch.
+static RC reserveKey(RM_TableInfo *info, RM_Transaction *txn, BM_PageHandle *page, char *key)
+{
+    BM_PageHandle holderPage;
+    RID holder;
+
+    if (findHashKey(info->primaryKey, key, &holder) != RC_OK)
+    {
+        return RC_OK;
+    }
+
+    // The page of the holder may be the one latched already
+    bool latched = (page != NULL && page->pageNum == holder.page);
+    if (!latched)
+    {
+        RC rc = pinPage(&bm, &holderPage, holder.page);
+        if (rc != RC_OK)
+        {
+            return rc;
+        }
+        latchPage(&bm, &holderPage, false);
+        page = &holderPage;
+    }
+    pthread_mutex_lock(&info->versionLatch);
+    RM_PageVersions *versions = findPageVersions(info, holder.page, false);
+    bool held = holdsKey(info, txn, page->data, (versions != NULL) ? versions->chains[holder.slot] : NULL, holder.slot, key);
+    pthread_mutex_unlock(&info->versionLatch);
+    if (!latched)
+    {
+        unlatchPage(&bm, &holderPage);
+        unpinPage(&bm, &holderPage);
+    }
+
+    return held ? RC_IM_KEY_ALREADY_EXISTS : deleteHashKey(info->primaryKey, key);
+}
+
+// Find the first free slot of a latched page that no other running transaction freed, -1 if there is none
+static int findInsertSlot(RM_TableInfo *info, RM_Transaction *txn, BM_PageHandle *page)
+{
+    uint64_t *bitmap = SLOT_BITMAP(page->data);
+    int numSlots = PAGE_HEADER(page->data)->numSlots;
+    RID id = {page->pageNum, -1};
+
+    for (int w = 0; w < BITMAP_WORDS(numSlots); w++)
+    {
+        // Try the zero bits of the word from the lowest one on
+        for (uint64_t free = ~bitmap[w]; free != 0; free &= free - 1)
+        {
+            id.slot = w * 64 + __builtin_ctzll(free);
+            if (id.slot >= numSlots)
+            {
+                return -1;
+            }
+            if (!changedByOther(info, txn, id))
+            {
+                return id.slot;
+            }
+        }
+    }
+    return -1;
+}
+
+// Remember a page whose slot a transaction freed, for releaseFreedPages. The caller holds the table latch.
+static void addFreedPage(RM_TableInfo *info, RM_Transaction *txn, PageNumber pageNum)
+{
+    RM_FreedPage *freed = (RM_FreedPage *)malloc(sizeof(RM_FreedPage));
+    freed->xid = txn->xid;
+    freed->pageNum = pageNum;
+    freed->next = info->freedPages;
+    info->freedPages = freed;
+}
+
+// Add the pages with slots freed by transactions that ended to the free space map. The caller holds the
+// table latch.
+static void releaseFreedPages(RM_TableInfo *info)
+{
+    RM_FreedPage **link = &info->freedPages;
+    while (*link != NULL)
+    {
+        RM_FreedPage *freed = *link;
+        if (isRunning(freed->xid))
+        {
+            link = &freed->next;
+            continue;
+        }
+        setPageFree(info, freed->pageNum, true);
+        *link = freed->next;
+        free(freed);
+    }
+}
+
+// Initialize the header and an empty slot bitmap of a data page
+static void formatDataPage(char *data, int numSlots)
+{
+    memset(data, 0, PAGE_SIZE);
+    PAGE_HEADER(data)->nextPage = NO_PAGE;
+    PAGE_HEADER(data)->numSlots = numSlots;
+    PAGE_HEADER(data)->numUsed = 0;
+    PAGE_HEADER(data)->tupleOffset = sizeof(RM_PageHeader) + BITMAP_WORDS(numSlots) * sizeof(uint64_t);
+}
+
+// Append a new empty data page to the page file and link it to the end of the table
+static RC allocateDataPage(RM_TableInfo *info, PageNumber *pageNum)
+{
+    BM_PageHandle page;
+    RC rc;
+
+    // Take the next page number atomically, the indexes of other tables append pages concurrently;
+    // pinning a page behind the last page of the file grows the file
+    if ((rc = pinPage(&bm, &page, __atomic_fetch_add(&totalNumPages, 1, __ATOMIC_SEQ_CST))) != RC_OK)
+    {
+        return rc;
+    }
+    *pageNum = page.pageNum;
+
+    // Initialize the page header and an empty slot bitmap
+    formatDataPage(page.data, info->numSlotsPerPage);
+    RM_PageLogBody body = {page.pageNum, NO_PAGE, info->numSlotsPerPage};
+    if ((rc = logPageChange(NULL, &page, LOG_PAGE_INIT, (char *)&body, sizeof(RM_PageLogBody))) != RC_OK)
+    {
+        unpinPage(&bm, &page);
+        return rc;
+    }
+    if ((rc = releaseDirtyPage(&page)) != RC_OK)
+    {
+        return rc;
+    }
+
+    // Link the new page behind the current last page of the table
+    if (info->lastPage != NO_PAGE)
+    {
+        if ((rc = pinPage(&bm, &page, info->lastPage)) != RC_OK)
+        {
+            return rc;
+        }
+        // Scans may be reading the page
+        latchPage(&bm, &page, true);
+        PAGE_HEADER(page.data)->nextPage = *pageNum;
+        body.pageNum = page.pageNum;
+        body.nextPage = *pageNum;
+        rc = logPageChange(NULL, &page, LOG_PAGE_LINK, (char *)&body, sizeof(RM_PageLogBody));
+        unlatchPage(&bm, &page);
+        if (rc != RC_OK)
+        {
+            unpinPage(&bm, &page);
+            return rc;
+        }
+        if ((rc = releaseDirtyPage(&page)) != RC_OK)
+        {
+            return rc;
+        }
+    }
+    else
+    {
+        info->firstPage = *pageNum;
+    }
+
+    info->lastPage = *pageNum;
+    info->totalNumPages++;
+    setPageFree(info, *pageNum, true);
+
+    return RC_OK;
+}
+
+// Pin and latch the page of a RID and check that its slot holds a tuple
+static RC pinRecordPage(RID id, BM_PageHandle *page, bool exclusive)
+{
+    RC rc = pinPage(&bm, page, id.page);
+    if (rc != RC_OK)
+    {
+        return rc;
+    }
+    latchPage(&bm, page, exclusive);
+
+    // Check if the slot is out of range or empty
+    if (id.slot < 0 || id.slot >= PAGE_HEADER(page->data)->numSlots || !isSlotUsed(page->data, id.slot))
+    {
+        unlatchPage(&bm, page);
+        unpinPage(&bm, page);
+        return RC_RM_NO_MORE_TUPLES;
+    }
+
+    return RC_OK;
+}
+
+// Unlatch a page pinned by pinRecordPage and release it, marking it dirty if it was modified
+static RC releaseRecordPage(BM_PageHandle *page, bool dirty)
+{
+    unlatchPage(&bm, page);
+    if (dirty)
+    {
+        return releaseDirtyPage(page);
+    }
+    return unpinPage(&bm, page);
+}
+
+// recovery
+
+// A transaction without a commit record in the log, rolled back by recovery
+typedef struct RM_LoserTransaction
+{
+    RM_Transaction txn;
+    LSN undoNextLSN; // next record of the transaction to undo, NO_LSN once all its changes are undone
+} RM_LoserTransaction;
+
+// Page changed by a log record, NO_PAGE if the record changes no page
+static PageNumber changedPage(LogRecord *record)
+{
+    switch (record->type)
+    {
+    case LOG_INSERT:
+    case LOG_DELETE:
+    case LOG_UPDATE:
+        return ((RM_TupleLogBody *)LOG_BODY(record))->id.page;
+    case LOG_PAGE_INIT:
+    case LOG_PAGE_LINK:
+        return ((RM_PageLogBody *)LOG_BODY(record))->pageNum;
+    case LOG_COMPENSATION:
+        return ((RM_CompensationLogBody *)LOG_BODY(record))->id.page;
+    default:
+        return NO_PAGE;
+    }
+}
+
+// Store a tuple in a slot, or empty the slot if tuple is NULL, and count the used slots of the page
+static void writeSlot(char *data, int slot, char *tuple, int recordSize)
+{
+    if (tuple != NULL)
+    {
+        memcpy(TUPLE_PTR(data, slot, recordSize), tuple, recordSize);
+    }
+    if (isSlotUsed(data, slot) != (tuple != NULL))
+    {
+        setSlotUsed(data, slot, tuple != NULL);
+        PAGE_HEADER(data)->numUsed += (tuple != NULL) ? 1 : -1;
+    }
+}
+
+// Apply a logged change to its page again, unless the page LSN shows that the page already contains it
+static RC redoChange(LogRecord *record, LSN lsn)
+{
+    char *body = LOG_BODY(record);
+    BM_PageHandle page;
+
+    RC rc = pinPage(&bm, &page, changedPage(record));
+    if (rc != RC_OK)
+    {
+        return rc;
+    }
+    latchPage(&bm, &page, true);
+    if (PAGE_HEADER(page.data)->pageLSN >= lsn)
+    {
+        return releaseRecordPage(&page, false);
+    }
+
+    switch (record->type)
+    {
+    case LOG_PAGE_INIT:
+        formatDataPage(page.data, ((RM_PageLogBody *)body)->numSlots);
+        break;
+    case LOG_PAGE_LINK:
+        PAGE_HEADER(page.data)->nextPage = ((RM_PageLogBody *)body)->nextPage;
+        break;
+    case LOG_INSERT:
+    case LOG_UPDATE:
+    {
+        // The new tuple follows the old one of an update
+        RM_TupleLogBody *change = (RM_TupleLogBody *)body;
+        char *after = body + sizeof(RM_TupleLogBody) + ((record->type == LOG_UPDATE) ? change->recordSize : 0);
+        writeSlot(page.data, change->id.slot, after, change->recordSize);
+        break;
+    }
+    case LOG_DELETE:
+        writeSlot(page.data, ((RM_TupleLogBody *)body)->id.slot, NULL, 0);
+        break;
+    case LOG_COMPENSATION:
+    {
+        RM_CompensationLogBody *undo = (RM_CompensationLogBody *)body;
+        writeSlot(page.data, undo->id.slot, undo->used ? body + sizeof(RM_CompensationLogBody) : NULL, undo->recordSize);
+        break;
+    }
+    }
+
+    // The page contains the log up to the record now
+    PAGE_HEADER(page.data)->pageLSN = lsn;
+    setPageLSN(&bm, &page, lsn);
+    return releaseRecordPage(&page, true);
+}
+
+// Undo a tuple change of a loser transaction and log the undo as a compensation record; an insert is
+// undone by emptying its slot, a delete or an update by restoring the old tuple. compensation is room
+// for the body of the compensation record.
+static RC undoChange(RM_LoserTransaction *loser, LogRecord *record, char *compensation)
+{
+    RM_TupleLogBody *change = (RM_TupleLogBody *)LOG_BODY(record);
+    RM_CompensationLogBody *undo = (RM_CompensationLogBody *)compensation;
+    char *before = compensation + sizeof(RM_CompensationLogBody);
+    BM_PageHandle page;
+
+    undo->undoNextLSN = record->prevLSN;
+    undo->id = change->id;
+    undo->recordSize = change->recordSize;
+    undo->used = (record->type != LOG_INSERT);
+    if (undo->used)
+    {
+        memcpy(before, LOG_BODY(record) + sizeof(RM_TupleLogBody), change->recordSize);
+    }
+
+    RC rc = pinPage(&bm, &page, change->id.page);
+    if (rc != RC_OK)
+    {
+        return rc;
+    }
+    latchPage(&bm, &page, true);
+    rc = logPageChange(&loser->txn, &page, LOG_COMPENSATION, compensation,
+                       (int)sizeof(RM_CompensationLogBody) + (undo->used ? change->recordSize : 0));
+    if (rc != RC_OK)
+    {
+        releaseRecordPage(&page, false);
+        return rc;
+    }
+    writeSlot(page.data, change->id.slot, undo->used ? before : NULL, change->recordSize);
+    loser->undoNextLSN = record->prevLSN;
+    return releaseRecordPage(&page, true);
+}
+
+// Tables built by the analysis pass of recovery
+typedef struct RM_RecoveryTables
+{
+    RM_LoserTransaction *losers; // transactions without a commit record
+    int numLosers;
+    int maxLosers;
+    LSN *recLSNs;   // dirty pages: the oldest change of page p that may be missing from the page file, NO_LSN if none
+    int numRecLSNs; // number of pages covered by recLSNs
+} RM_RecoveryTables;
+
+// Find a loser transaction, adding it if it is not there yet and add is set; NULL if it is not found
+static RM_LoserTransaction *findLoser(RM_RecoveryTables *recovery, long xid, bool add)
+{
+    for (int i = 0; i < recovery->numLosers; i++)
+    {
+        if (recovery->losers[i].txn.xid == xid)
+        {
+            return &recovery->losers[i];
+        }
+    }
+    if (!add)
+    {
+        return NULL;
+    }
+
+    if (recovery->numLosers == recovery->maxLosers)
+    {
+        recovery->maxLosers = (recovery->maxLosers > 0) ? 2 * recovery->maxLosers : 8;
+        recovery->losers = (RM_LoserTransaction *)realloc(recovery->losers, recovery->maxLosers * sizeof(RM_LoserTransaction));
+    }
+    RM_LoserTransaction *loser = &recovery->losers[recovery->numLosers++];
+    loser->txn.xid = xid;
+    loser->txn.firstLSN = NO_LSN;
+    loser->txn.lastLSN = NO_LSN;
+    loser->undoNextLSN = NO_LSN;
+    return loser;
+}
+
+// Add a page to the dirty pages of recovery, keeping the oldest change that may be missing from it,
+// and count it among the pages of the file
+static void addDirtyPage(RM_RecoveryTables *recovery, PageNumber pageNum, LSN recLSN)
+{
+    if (pageNum >= recovery->numRecLSNs)
+    {
+        int numRecLSNs = (2 * recovery->numRecLSNs > pageNum + 1) ? 2 * recovery->numRecLSNs : pageNum + 1;
+        recovery->recLSNs = (LSN *)realloc(recovery->recLSNs, numRecLSNs * sizeof(LSN));
+        memset(recovery->recLSNs + recovery->numRecLSNs, 0, (numRecLSNs - recovery->numRecLSNs) * sizeof(LSN));
+        recovery->numRecLSNs = numRecLSNs;
+    }
+    if (recovery->recLSNs[pageNum] == NO_LSN || recLSN < recovery->recLSNs[pageNum])
+    {
+        recovery->recLSNs[pageNum] = recLSN;
+    }
+    if (pageNum >= totalNumPages)
+    {
+        totalNumPages = pageNum + 1;
+    }
+}
+
+// Take the dirty pages and running transactions recorded by a checkpoint into the tables of recovery;
+// the log after the checkpoint's begin record knows better about the transactions it mentions
+static void mergeCheckpoint(RM_RecoveryTables *recovery, LogRecord *record)
+{
+    RM_CheckpointLogBody *checkpoint = (RM_CheckpointLogBody *)LOG_BODY(record);
+    RM_CheckpointTransaction *txns = (RM_CheckpointTransaction *)(LOG_BODY(record) + sizeof(RM_CheckpointLogBody));
+    RM_CheckpointPage *pages = (RM_CheckpointPage *)(txns + checkpoint->numTransactions);
+
+    if (checkpoint->lastXid > lastXid)
+    {
+        lastXid = checkpoint->lastXid;
+    }
+    for (int i = 0; i < checkpoint->numTransactions; i++)
+    {
+        if (findLoser(recovery, txns[i].xid, false) == NULL)
+        {
+            RM_LoserTransaction *loser = findLoser(recovery, txns[i].xid, true);
+            loser->txn.firstLSN = txns[i].firstLSN;
+            loser->txn.lastLSN = txns[i].lastLSN;
+            loser->undoNextLSN = txns[i].lastLSN;
+        }
+    }
+    for (int i = 0; i < checkpoint->numPages; i++)
+    {
+        addDirtyPage(recovery, pages[i].pageNum, pages[i].recLSN);
+    }
+}
+
+// Bring the data pages to the state of the committed transactions after a crash, ARIES style:
+// analysis reads the log from the begin record of the last checkpoint and finds the transactions
+// without a commit record and the pages that may miss changes, redo repeats the logged changes
+// missing from those pages, and undo rolls back the changes of the transactions, the newest one
+// first, logging every undo so that an interrupted recovery never undoes a change twice. clean tells whether
+// the log ends with the checkpoint of a shutdown, so the unlogged index pages are intact as well.
+static RC recoverDatabase(bool *clean)
+{
+    RM_RecoveryTables recovery = {NULL, 0, 0, NULL, 0};
+    LogRecord *record;
+    LSN start, checkpointLSN, redoLSN, lastLSN = NO_LSN, lsn;
+    bool shutdown = false;
+    RC rc = RC_OK;
+
+    // Without a checkpoint every change in the log may be missing from its page
+    getLogStart(wal, &start);
+    getLogCheckpoint(wal, &checkpointLSN);
+    if (checkpointLSN != NO_LSN && readLogRecord(wal, checkpointLSN, &record) == RC_OK)
+    {
+        start = ((RM_CheckpointLogBody *)LOG_BODY(record))->beginLSN;
+        shutdown = ((RM_CheckpointLogBody *)LOG_BODY(record))->shutdown;
+        free(record);
+    }
+
+    // Analysis: collect the transactions that did not end, the highest transaction ID, and the
+    // dirty pages, which may lie behind the end of the page file
+    for (lsn = start; readLogRecord(wal, lsn, &record) == RC_OK; free(record))
+    {
+        PageNumber pageNum = changedPage(record);
+        if (pageNum != NO_PAGE)
+        {
+            addDirtyPage(&recovery, pageNum, lsn);
+        }
+        if (record->xid > lastXid)
+        {
+            lastXid = record->xid;
+        }
+        if (lsn == checkpointLSN)
+        {
+            mergeCheckpoint(&recovery, record);
+        }
+
+        if (record->xid != 0)
+        {
+            RM_LoserTransaction *loser = findLoser(&recovery, record->xid, record->type != LOG_COMMIT && record->type != LOG_ABORT);
+            if (record->type == LOG_COMMIT || record->type == LOG_ABORT)
+            {
+                if (loser != NULL)
+                {
+                    *loser = recovery.losers[--recovery.numLosers];
+                }
+            }
+            else
+            {
+                loser->txn.lastLSN = lsn;
+                loser->undoNextLSN = (record->type == LOG_COMPENSATION) ? ((RM_CompensationLogBody *)LOG_BODY(record))->undoNextLSN : lsn;
+            }
+        }
+        lastLSN = lsn;
+        lsn += record->size;
+    }
+    *clean = shutdown && lastLSN == checkpointLSN;
+
+    // Redo: repeat history from the oldest change that may be missing, the changes of the loser
+    // transactions included; changes of pages that are not dirty at that point are on disk
+    redoLSN = start;
+    for (int p = 0; p < recovery.numRecLSNs; p++)
+    {
+        if (recovery.recLSNs[p] != NO_LSN && recovery.recLSNs[p] < redoLSN)
+        {
+            redoLSN = recovery.recLSNs[p];
+        }
+    }
+    for (lsn = redoLSN; rc == RC_OK && readLogRecord(wal, lsn, &record) == RC_OK; free(record))
+    {
+        PageNumber pageNum = changedPage(record);
+        if (pageNum != NO_PAGE && pageNum < recovery.numRecLSNs && recovery.recLSNs[pageNum] != NO_LSN &&
+            lsn >= recovery.recLSNs[pageNum])
+        {
+            rc = redoChange(record, lsn);
+        }
+        lsn += record->size;
+    }
+
+    // Undo: always the newest change left of any loser transaction
+    RM_LoserTransaction *losers = recovery.losers;
+    char *compensation = (char *)malloc(sizeof(RM_CompensationLogBody) + PAGE_SIZE);
+    while (rc == RC_OK && recovery.numLosers > 0)
+    {
+        int i = 0;
+        for (int j = 1; j < recovery.numLosers; j++)
+        {
+            if (losers[j].undoNextLSN > losers[i].undoNextLSN)
+            {
+                i = j;
+            }
+        }
+
+        if (losers[i].undoNextLSN == NO_LSN)
+        {
+            // Everything is undone, end the transaction
+            rc = appendLogRecord(wal, LOG_ABORT, losers[i].txn.xid, losers[i].txn.lastLSN, NULL, 0, &lsn);
+            losers[i] = losers[--recovery.numLosers];
+        }
+        else if ((rc = readLogRecord(wal, losers[i].undoNextLSN, &record)) == RC_OK)
+        {
+            if (record->type == LOG_COMPENSATION)
+            {
+                losers[i].undoNextLSN = ((RM_CompensationLogBody *)LOG_BODY(record))->undoNextLSN;
+            }
+            else
+            {
+                rc = undoChange(&losers[i], record, compensation);
+            }
+            free(record);
+        }
+    }
+    free(compensation);
+    free(recovery.losers);
+    free(recovery.recLSNs);
+
+    // The rollback is durable before new transactions start
+    getLogEnd(wal, &lsn);
+    return (rc != RC_OK) ? rc : flushLog(wal, lsn - 1);
+}
+
+// checkpoints
+
+static int comparePageNumbers(const void *left, const void *right)
+{
+    PageNumber a = *(const PageNumber *)left, b = *(const PageNumber *)right;
+    return (a > b) - (a < b);
+}
+
+// Log the end record of a checkpoint with the dirty pages and the running transactions, and find the oldest
+// record recovery may need: the begin record, the oldest change missing from a page, or the first record of
+// a running transaction. Transactions without a record yet only write records behind the begin record.
+static RC logCheckpointEnd(LSN beginLSN, bool shutdown, PageNumber *pages, long *recLSNs, int numPages, LSN *endLSN,
+                           LSN *keepLSN)
+{
+    int numTransactions = 0;
+
+    *keepLSN = beginLSN;
+    pthread_mutex_lock(&transactionLatch);
+    for (RM_Transaction *txn = activeTransactions; txn != NULL; txn = txn->next)
+    {
+        numTransactions++;
+    }
+    char *body = (char *)malloc(sizeof(RM_CheckpointLogBody) + numTransactions * sizeof(RM_CheckpointTransaction) +
+                                numPages * sizeof(RM_CheckpointPage));
+    RM_CheckpointLogBody *checkpoint = (RM_CheckpointLogBody *)body;
+    RM_CheckpointTransaction *txns = (RM_CheckpointTransaction *)(body + sizeof(RM_CheckpointLogBody));
+
+    checkpoint->beginLSN = beginLSN;
+    checkpoint->shutdown = shutdown;
+    checkpoint->lastXid = __atomic_load_n(&lastXid, __ATOMIC_RELAXED);
+    checkpoint->numTransactions = 0;
+    for (RM_Transaction *txn = activeTransactions; txn != NULL; txn = txn->next)
+    {
+        RM_CheckpointTransaction *entry = &txns[checkpoint->numTransactions];
+        entry->lastLSN = __atomic_load_n(&txn->lastLSN, __ATOMIC_RELAXED);
+        entry->firstLSN = __atomic_load_n(&txn->firstLSN, __ATOMIC_RELAXED);
+        entry->xid = txn->xid;
+        if (entry->lastLSN != NO_LSN && entry->firstLSN != NO_LSN)
+        {
+            *keepLSN = (entry->firstLSN < *keepLSN) ? entry->firstLSN : *keepLSN;
+            checkpoint->numTransactions++;
+        }
+    }
+
+    RM_CheckpointPage *dirty = (RM_CheckpointPage *)(txns + checkpoint->numTransactions);
+    checkpoint->numPages = numPages;
+    for (int i = 0; i < numPages; i++)
+    {
+        dirty[i].pageNum = pages[i];
+        dirty[i].recLSN = recLSNs[i];
+        *keepLSN = (recLSNs[i] < *keepLSN) ? recLSNs[i] : *keepLSN;
+    }
+
+    // No transaction commits meanwhile, so none the checkpoint lists has a commit record before it
+    RC rc = appendLogRecord(wal, LOG_CHECKPOINT_END, 0, NO_LSN, body, (char *)(dirty + numPages) - body, endLSN);
+    pthread_mutex_unlock(&transactionLatch);
+    free(body);
+    return rc;
+}
+
+// Take a checkpoint; shutdown tells recovery that the buffer pool was flushed before, with nothing running
+static RC checkpoint(bool shutdown)
+{
+    PageNumber *pages = (PageNumber *)malloc(bm.numPages * sizeof(PageNumber));
+    long *recLSNs = (long *)malloc(bm.numPages * sizeof(long));
+    LSN beginLSN, endLSN, keepLSN;
+    int numPages;
+    RC rc;
+
+    pthread_mutex_lock(&checkpointLatch);
+
+    // Write the pages dirty at the begin record back in page-number order, while tables keep changing
+    if ((rc = appendLogRecord(wal, LOG_CHECKPOINT_BEGIN, 0, NO_LSN, NULL, 0, &beginLSN)) == RC_OK &&
+        (rc = getDirtyPageTable(&bm, pages, recLSNs, &numPages)) == RC_OK)
+    {
+        qsort(pages, numPages, sizeof(PageNumber), comparePageNumbers);
+        rc = flushPages(&bm, pages, numPages);
+    }
+
+    // Record the pages dirtied since and the running transactions
+    if (rc == RC_OK && (rc = getDirtyPageTable(&bm, pages, recLSNs, &numPages)) == RC_OK)
+    {
+        rc = logCheckpointEnd(beginLSN, shutdown, pages, recLSNs, numPages, &endLSN, &keepLSN);
+    }
+
+    // The checkpoint counts once its end record is durable and the log header points to it,
+    // then the log recovery does not read anymore is dropped
+    if (rc == RC_OK && (rc = flushLog(wal, endLSN)) == RC_OK && (rc = setLogCheckpoint(wal, endLSN)) == RC_OK)
+    {
+        __atomic_store_n(&lastCheckpointLSN, beginLSN, __ATOMIC_RELAXED);
+        rc = truncateLog(wal, keepLSN);
+    }
+
+    pthread_mutex_unlock(&checkpointLatch);
+    free(pages);
+    free(recLSNs);
+    return rc;
+}
+
+RC takeCheckpoint(void)
+{
+    return checkpoint(false);
+}
+
+// Main loop of the checkpointer thread: take a checkpoint whenever CHECKPOINT_LOG_BYTES of log were
+// written since the last one, checking every CHECKPOINT_INTERVAL_MS
+static void *checkpointerMain(void *arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&checkpointerLatch);
+    while (!stopCheckpointer)
+    {
+        LSN end;
+        getLogEnd(wal, &end);
+        if (end - __atomic_load_n(&lastCheckpointLSN, __ATOMIC_RELAXED) >= CHECKPOINT_LOG_BYTES)
+        {
+            pthread_mutex_unlock(&checkpointerLatch);
+            checkpoint(false);
+            pthread_mutex_lock(&checkpointerLatch);
+        }
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += CHECKPOINT_INTERVAL_MS * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        pthread_cond_timedwait(&checkpointerWakeup, &checkpointerLatch, &deadline);
+    }
+    pthread_mutex_unlock(&checkpointerLatch);
+
+    return NULL;
+}
+
+// catalog
+
+static RC insertRecordLocked(RM_TableInfo *info, Schema *schema, Record *record, RM_Transaction *txn);
+static RC deleteRecordLocked(RM_TableInfo *info, Schema *schema, RID id, RM_Transaction *txn);
+static RC updateRecordLocked(RM_TableInfo *info, Schema *schema, Record *record, RM_Transaction *txn);
+
+// Serialize a schema into a catalog entry: the number of attributes and the key size, the data type and type
+// length of every attribute, and the key attributes, followed by the zero-terminated attribute names
+static RC writeCatalogSchema(RM_CatalogEntry *entry, Schema *schema)
+{
+    int *numbers = (int *)entry->schema;
+    int numNumbers = 2 + 2 * schema->numAttr + schema->keySize;
+    char *names = entry->schema + numNumbers * sizeof(int);
+
+    if (numNumbers * sizeof(int) > CATALOG_SCHEMA_SIZE)
+    {
+        THROW(RC_ERROR, "schema does not fit into the catalog");
+    }
+    numbers[0] = schema->numAttr;
+    numbers[1] = schema->keySize;
+    for (int i = 0; i < schema->numAttr; i++)
+    {
+        numbers[2 + 2 * i] = schema->dataTypes[i];
+        numbers[3 + 2 * i] = schema->typeLength[i];
+    }
+    memcpy(numbers + 2 + 2 * schema->numAttr, schema->keyAttrs, schema->keySize * sizeof(int));
+
+    for (int i = 0; i < schema->numAttr; i++)
+    {
+        int size = strlen(schema->attrNames[i]) + 1;
+        if (names + size > entry->schema + CATALOG_SCHEMA_SIZE)
+        {
+            THROW(RC_ERROR, "schema does not fit into the catalog");
+        }
+        memcpy(names, schema->attrNames[i], size);
+        names += size;
+    }
+    entry->schemaSize = names - entry->schema;
+    return RC_OK;
+}
+
+// Read the schema of a catalog entry into a single allocation, which freeSchema frees as a whole
+static Schema *readCatalogSchema(RM_CatalogEntry *entry)
+{
+    int *numbers = (int *)entry->schema;
+    int numAttr = numbers[0], keySize = numbers[1];
+    int namesOffset = (2 + 2 * numAttr + keySize) * sizeof(int);
+
+    char *block = (char *)malloc(sizeof(Schema) + numAttr * (sizeof(char *) + sizeof(DataType) + sizeof(int)) +
+                                 keySize * sizeof(int) + (entry->schemaSize - namesOffset));
+    Schema *schema = (Schema *)block;
+    schema->numAttr = numAttr;
+    schema->keySize = keySize;
+    schema->attrNames = (char **)(block + sizeof(Schema));
+    schema->dataTypes = (DataType *)(schema->attrNames + numAttr);
+    schema->typeLength = (int *)(schema->dataTypes + numAttr);
+    schema->keyAttrs = schema->typeLength + numAttr;
+    for (int i = 0; i < numAttr; i++)
+    {
+        schema->dataTypes[i] = (DataType)numbers[2 + 2 * i];
+        schema->typeLength[i] = numbers[3 + 2 * i];
+    }
+    memcpy(schema->keyAttrs, numbers + 2 + 2 * numAttr, keySize * sizeof(int));
+
+    char *names = (char *)(schema->keyAttrs + keySize);
+    memcpy(names, entry->schema + namesOffset, entry->schemaSize - namesOffset);
+    for (int i = 0; i < numAttr; i++)
+    {
+        schema->attrNames[i] = names;
+        names += strlen(names) + 1;
+    }
+    return schema;
+}
+
+// New table info owning a copy of the table name and the given schema, without data pages or indexes yet
+static RM_TableInfo *newTableInfo(char *name, Schema *schema, int recordSize)
+{
+    RM_TableData *rel = (RM_TableData *)malloc(sizeof(RM_TableData));
+    rel->name = (char *)malloc(strlen(name) + 1);
+    strcpy(rel->name, name);
+    rel->schema = schema;
+    rel->mgmtData = NULL;
+
+    RM_TableInfo *info = (RM_TableInfo *)malloc(sizeof(RM_TableInfo));
+    info->rel = rel;
+    info->numTuples = 0;
+    info->recordSize = recordSize;
+    info->numSlotsPerPage = slotsPerPage(info->recordSize);
+    info->firstPage = NO_PAGE;
+    info->lastPage = NO_PAGE;
+    info->totalNumPages = 0;
+    info->freeSpaceMap = NULL;
+    info->freeSpaceMapWords = 0;
+    info->freeSpaceMapFirst = 0;
+    info->index = NULL;
+    info->primaryKey = NULL;
+    info->keys = (schema != NULL && schema->keySize > 0) ? (char *)malloc(3 * getKeySize(schema)) : NULL;
+    info->logBody = (char *)malloc(sizeof(RM_TupleLogBody) + 2 * info->recordSize);
+    pthread_mutex_init(&info->latch, NULL);
+    info->numHandles = 0;
+    info->catalogId.page = NO_PAGE;
+    info->catalogId.slot = -1;
+    info->loaded = true;
+    info->nextInBucket = NULL;
+    pthread_mutex_init(&info->versionLatch, NULL);
+    info->versionMapMask = 15;
+    info->versionMap = (RM_PageVersions **)calloc(info->versionMapMask + 1, sizeof(RM_PageVersions *));
+    info->numVersionPages = 0;
+    info->numVersions = 0;
+    info->versionLimit = VERSION_GC_MIN;
+    info->freedPages = NULL;
+    return info;
+}
+
+// Record a table in the catalog: insert its tuple if it has none yet, delete the tuple if remove is set, and
+// update it otherwise. Catalog changes commit on their own, also within a transaction of the thread. The
+// caller holds the catalog latch.
+static RC writeCatalogEntry(RM_TableInfo *info, bool remove)
+{
+    RM_CatalogEntry entry;
+    Record record = {info->catalogId, (char *)&entry};
+    RM_Transaction txn;
+    RC rc;
+
+    memset(&entry, 0, sizeof(RM_CatalogEntry));
+    strcpy(entry.name, info->rel->name);
+    entry.firstPage = info->firstPage;
+    entry.indexPage = (info->index != NULL) ? info->index->headerPage : NO_PAGE;
+    entry.hashPage = (info->primaryKey != NULL) ? info->primaryKey->headerPage : NO_PAGE;
+    if ((rc = writeCatalogSchema(&entry, info->rel->schema)) != RC_OK)
+    {
+        return rc;
+    }
+
+    startTransaction(&txn);
+    if (remove)
+    {
+        rc = deleteRecordLocked(catalog, NULL, info->catalogId, &txn);
+    }
+    else if (info->catalogId.page == NO_PAGE)
+    {
+        rc = insertRecordLocked(catalog, NULL, &record, &txn);
+        info->catalogId = record.id;
+    }
+    else
+    {
+        rc = updateRecordLocked(catalog, NULL, &record, &txn);
+    }
+    RC rcCommit = commitChanges(&txn);
+    return (rc != RC_OK) ? rc : rcCommit;
+}
+
+// Rebuild what the catalog does not store from the data pages of a table: the tuple count, the free space map,
+// and the last page. With rebuildIndexes the indexes are built anew from the tuples and recorded in the catalog,
+// as index pages are not logged and may be torn after a crash; the old index pages are not reused. The caller
+// holds the catalog latch.
+static RC loadTable(RM_TableInfo *info, bool rebuildIndexes)
+{
+    Schema *schema = info->rel->schema;
+    BTreeHandle *index = NULL;
+    HashHandle *primaryKey = NULL;
+    BM_PageHandle page;
+    RC rc = RC_OK;
+
+    if (rebuildIndexes && schema->keySize > 0)
+    {
+        PageNumber headerPage, hashHeaderPage;
+        if ((rc = createBtree(&bm, &totalNumPages, schema, 0, &headerPage)) != RC_OK ||
+            (rc = openBtree(&index, &bm, &totalNumPages, schema, headerPage)) != RC_OK ||
+            (rc = createHash(&bm, &totalNumPages, schema, &hashHeaderPage)) != RC_OK ||
+            (rc = openHash(&primaryKey, &bm, &totalNumPages, schema, hashHeaderPage)) != RC_OK)
+        {
+            if (index != NULL)
+            {
+                closeBtree(index);
+            }
+            return rc;
+        }
+    }
+
+    info->numTuples = 0;
+    info->totalNumPages = 0;
+    info->lastPage = NO_PAGE;
+    for (PageNumber pageNum = info->firstPage; rc == RC_OK && pageNum != NO_PAGE;)
+    {
+        if ((rc = pinPage(&bm, &page, pageNum)) != RC_OK)
+        {
+            break;
+        }
+        latchPage(&bm, &page, false);
+        RM_PageHeader *header = PAGE_HEADER(page.data);
+        for (int slot = findUsedSlot(page.data, 0); index != NULL && rc == RC_OK && slot != -1; slot = findUsedSlot(page.data, slot + 1))
+        {
+            RID id = {pageNum, slot};
+            getRecordKey(schema, TUPLE_PTR(page.data, slot, info->recordSize), info->keys);
+            if ((rc = insertHashKey(primaryKey, info->keys, id)) == RC_OK)
+            {
+                rc = insertKey(index, info->keys, id);
+            }
+        }
+        info->numTuples += header->numUsed;
+        info->totalNumPages++;
+        info->lastPage = pageNum;
+        setPageFree(info, pageNum, header->numUsed < header->numSlots);
+        pageNum = header->nextPage;
+        releaseRecordPage(&page, false);
+    }
+
+    if (index != NULL)
+    {
+        if (rc != RC_OK)
+        {
+            closeBtree(index);
+            closeHash(primaryKey);
+            return rc;
+        }
+        if (info->index != NULL)
+        {
+            closeBtree(info->index);
+            closeHash(info->primaryKey);
+        }
+        info->index = index;
+        info->primaryKey = primaryKey;
+        rc = writeCatalogEntry(info, false);
+    }
+    info->loaded = (rc == RC_OK);
+    return rc;
+}
+
+// Load the tables of the catalog into the table map. A table's data pages are only read once it is opened,
+// unless its indexes must be rebuilt, which are not even opened then. The catalog page of a new page file, or of one that crashed while it
+// was created, is formatted first.
+static RC loadCatalog(bool rebuildIndexes)
+{
+    BM_PageHandle page;
+    RC rc;
+
+    catalog = newTableInfo("catalog", NULL, sizeof(RM_CatalogEntry));
+    catalog->firstPage = CATALOG_PAGE;
+    tableMap = (RM_TableInfo **)calloc(CATALOG_BUCKETS, sizeof(RM_TableInfo *));
+    tableMapMask = CATALOG_BUCKETS - 1;
+    numTables = 0;
+
+    if ((rc = pinPage(&bm, &page, CATALOG_PAGE)) != RC_OK)
+    {
+        return rc;
+    }
+    latchPage(&bm, &page, true);
+    bool formatted = (PAGE_HEADER(page.data)->numSlots > 0);
+    if (!formatted)
+    {
+        formatDataPage(page.data, catalog->numSlotsPerPage);
+        RM_PageLogBody body = {CATALOG_PAGE, NO_PAGE, catalog->numSlotsPerPage};
+        rc = logPageChange(NULL, &page, LOG_PAGE_INIT, (char *)&body, sizeof(RM_PageLogBody));
+    }
+    RC rcRelease = releaseRecordPage(&page, !formatted && rc == RC_OK);
+    if ((rc = (rc != RC_OK) ? rc : rcRelease) != RC_OK || (rc = loadTable(catalog, false)) != RC_OK)
+    {
+        return rc;
+    }
+
+    for (PageNumber pageNum = CATALOG_PAGE; rc == RC_OK && pageNum != NO_PAGE;)
+    {
+        if ((rc = pinPage(&bm, &page, pageNum)) != RC_OK)
+        {
+            break;
+        }
+        latchPage(&bm, &page, false);
+        for (int slot = findUsedSlot(page.data, 0); rc == RC_OK && slot != -1; slot = findUsedSlot(page.data, slot + 1))
+        {
+            RM_CatalogEntry *entry = (RM_CatalogEntry *)TUPLE_PTR(page.data, slot, catalog->recordSize);
+            Schema *schema = readCatalogSchema(entry);
+            RM_TableInfo *info = newTableInfo(entry->name, schema, getRecordSize(schema));
+            info->firstPage = entry->firstPage;
+            info->catalogId.page = pageNum;
+            info->catalogId.slot = slot;
+            info->loaded = false;
+            if (entry->indexPage != NO_PAGE && !rebuildIndexes &&
+                ((rc = openBtree(&info->index, &bm, &totalNumPages, schema, entry->indexPage)) != RC_OK ||
+                 (rc = openHash(&info->primaryKey, &bm, &totalNumPages, schema, entry->hashPage)) != RC_OK))
+            {
+                freeTableInfo(info);
+                break;
+            }
+            addTable(info);
+        }
+        pageNum = PAGE_HEADER(page.data)->nextPage;
+        releaseRecordPage(&page, false);
+    }
+
+    for (int b = 0; rebuildIndexes && rc == RC_OK && b <= tableMapMask; b++)
+    {
+        for (RM_TableInfo *info = tableMap[b]; rc == RC_OK && info != NULL; info = info->nextInBucket)
+        {
+            if (info->rel->schema->keySize > 0)
+            {
+                rc = loadTable(info, true);
+            }
+        }
+    }
+    return rc;
+}
+
+// Free the catalog and the table map
+static void freeCatalog(void)
+{
+    for (int b = 0; b <= tableMapMask; b++)
+    {
+        while (tableMap[b] != NULL)
+        {
+            RM_TableInfo *info = tableMap[b];
+            tableMap[b] = info->nextInBucket;
+
+            // Drop the versions and the index entries of old keys no transaction needs anymore
+            if (info->index != NULL)
+            {
+                collectVersions(info);
+            }
+            freeTableInfo(info);
+        }
+    }
+    free(tableMap);
+    tableMap = NULL;
+    numTables = 0;
+    freeTableInfo(catalog);
+    catalog = NULL;
+}
+
+RC initRecordManager(void *mgmtData)
+{
+    SM_FileHandle fileHandle;
+    bool recover = false, clean = true;
+
+    (void)mgmtData;
+
+    // Initialize the storage manager
+    initStorageManager();
+    lastXid = 0;
+
+    // Open the page file and the log of its changes, which is replayed once the buffer pool is up; a new
+    // page file, with page 0 reserved for the catalog, is only created if there is none
+    RC rc = openPageFile(filename, &fileHandle);
+    if (rc == RC_OK)
+    {
+        totalNumPages = fileHandle.totalNumPages;
+        closePageFile(&fileHandle);
+        recover = (openLog(&wal, logFilename) == RC_OK);
+    }
+    else
+    {
+        rc = createPageFile(filename);
+        totalNumPages = 1;
+    }
+    if (rc != RC_OK || (!recover && ((rc = createLog(logFilename)) != RC_OK || (rc = openLog(&wal, logFilename)) != RC_OK)))
+    {
+        return rc;
+    }
+
+    // Initialize the buffer manager, pages are written after their log records; the page cleaner keeps most victims clean
+    rc = initBufferPool(&bm, filename, BUFFER_POOL_SIZE, RS_FIFO, NULL);
+    if (rc != RC_OK)
+    {
+        closeLog(wal);
+        return rc;
+    }
+    setWriteAheadLog(&bm, flushLogBeforePage, wal);
+    if ((recover && (rc = recoverDatabase(&clean)) != RC_OK) || (rc = loadCatalog(!clean)) != RC_OK)
+    {
+        if (catalog != NULL)
+        {
+            freeCatalog();
+        }
+        shutdownBufferPool(&bm);
+        closeLog(wal);
+        return rc;
+    }
+
+    // The next checkpoint is taken once enough log follows the recovered one
+    getLogEnd(wal, &lastCheckpointLSN);
+    stopCheckpointer = false;
+    if (pthread_create(&checkpointer, NULL, checkpointerMain, NULL) != 0)
+    {
+        freeCatalog();
+        shutdownBufferPool(&bm);
+        closeLog(wal);
+        return RC_ERROR;
+    }
+    return startPageCleaner(&bm, DIRTY_HIGH_WATER);
+}
+
+RC shutdownRecordManager()
+{
+    // Free the catalog and the table infos
+    freeCatalog();
+
+    // Stop the checkpointer, write every page back, and take a last checkpoint, so a restart has nothing to
+    // recover and finds the indexes intact
+    pthread_mutex_lock(&checkpointerLatch);
+    stopCheckpointer = true;
+    pthread_cond_signal(&checkpointerWakeup);
+    pthread_mutex_unlock(&checkpointerLatch);
+    pthread_join(checkpointer, NULL);
+    RC rc = forceFlushPool(&bm);
+    if (rc == RC_OK)
+    {
+        rc = checkpoint(true);
+    }
+
+    // Writing the remaining pages back flushes the log they need
+    shutdownBufferPool(&bm);
+    RC rcClose = closeLog(wal);
+    rc = (rc != RC_OK) ? rc : rcClose;
+
+    // Return OK status code if shutdown is successful
+    return rc;
+}
+
+// Create a table, the caller holds the catalog latch
+static RC createTableLocked(char *name, Schema *schema)
+{
+    RM_CatalogEntry entry;
+    RC rc;
+
+    // Check if the table already exists
+    if (findTable(name) != NULL)
+    {
+        // If the table already exists, return an error code
+        return RC_TABLE_ALREADY_EXISTS;
+    }
+    if (strlen(name) >= CATALOG_NAME_SIZE)
+    {
+        THROW(RC_ERROR, "table name is too long");
+    }
+
+    // The table keeps its own copy of the schema, as it is stored in the catalog
+    if ((rc = writeCatalogSchema(&entry, schema)) != RC_OK)
+    {
+        return rc;
+    }
+    RM_TableInfo *info = newTableInfo(name, readCatalogSchema(&entry), getRecordSize(schema));
+    schema = info->rel->schema;
+
+    // Allocate the first data page of the table
+    PageNumber pageNum;
+    if ((rc = allocateDataPage(info, &pageNum)) != RC_OK)
+    {
+        freeTableInfo(info);
+        return rc;
+    }
+
+    // Index the records of the table by their key
+    if (schema->keySize > 0)
+    {
+        PageNumber headerPage, hashHeaderPage;
+        if ((rc = createBtree(&bm, &totalNumPages, schema, 0, &headerPage)) != RC_OK ||
+            (rc = openBtree(&info->index, &bm, &totalNumPages, schema, headerPage)) != RC_OK ||
+            (rc = createHash(&bm, &totalNumPages, schema, &hashHeaderPage)) != RC_OK ||
+            (rc = openHash(&info->primaryKey, &bm, &totalNumPages, schema, hashHeaderPage)) != RC_OK)
+        {
+            freeTableInfo(info);
+            return rc;
+        }
+    }
+
+    // The table exists once its catalog tuple is committed
+    if ((rc = writeCatalogEntry(info, false)) != RC_OK)
+    {
+        freeTableInfo(info);
+        return rc;
+    }
+    addTable(info);
+
+    // Return OK status code if table creation is successful
+    return RC_OK;
+}
+
+RC createTable(char *name, Schema *schema)
+{
+    pthread_mutex_lock(&catalogLatch);
+    RC rc = createTableLocked(name, schema);
+    pthread_mutex_unlock(&catalogLatch);
+    return rc;
+}
+
+RC openTable(RM_TableData *rel, char *name)
+{
+    // Check if the table exists
+    pthread_mutex_lock(&catalogLatch);
+    RM_TableInfo *info = findTable(name);
+
+    // Return an error code if the table does not exist
+    if (info == NULL)
+    {
+        pthread_mutex_unlock(&catalogLatch);
+        return RC_TABLE_NOT_FOUND;
+    }
+
+    // The first open since the catalog was loaded reads the data pages of the table
+    RC rc = info->loaded ? RC_OK : loadTable(info, false);
+    if (rc != RC_OK)
+    {
+        pthread_mutex_unlock(&catalogLatch);
+        return rc;
+    }
+
+    // Every handle of the table shares its table info
+    info->numHandles++;
+    rel->name = info->rel->name;
+    rel->schema = info->rel->schema;
+    rel->mgmtData = info;
+    pthread_mutex_unlock(&catalogLatch);
+
+    return RC_OK;
+}
+
+RC closeTable(RM_TableData *rel)
+{
+    // Check if the table is open
+    if (rel->mgmtData == NULL)
+    {
+        return RC_TABLE_NOT_FOUND;
+    }
+
+    pthread_mutex_lock(&catalogLatch);
+    ((RM_TableInfo *)rel->mgmtData)->numHandles--;
+    pthread_mutex_unlock(&catalogLatch);
+    rel->mgmtData = NULL;
+
+    return RC_OK;
+}
+
+RC deleteTable(char *name)
+{
+    pthread_mutex_lock(&catalogLatch);
+    RM_TableInfo *info = findTable(name);
+    if (info == NULL)
+    {
+        pthread_mutex_unlock(&catalogLatch);
+        return RC_TABLE_NOT_FOUND;
+    }
+
+    // The table info must outlive the handles of the table
+    if (info->numHandles > 0)
+    {
+        pthread_mutex_unlock(&catalogLatch);
+        THROW(RC_TABLE_IN_USE, "table is still open");
+    }
+
+    // The table is gone once its catalog tuple is deleted
+    RC rc = writeCatalogEntry(info, true);
+    if (rc != RC_OK)
+    {
+        pthread_mutex_unlock(&catalogLatch);
+        return rc;
+    }
+
+    // Reset the table info, the data and index pages of the table are not reused
+    if (info->index != NULL)
+    {
+        PageNumber headerPage = info->index->headerPage;
+        closeBtree(info->index);
+        info->index = NULL;
+        deleteBtree(&bm, headerPage);
+    }
+    if (info->primaryKey != NULL)
+    {
+        PageNumber headerPage = info->primaryKey->headerPage;
+        closeHash(info->primaryKey);
+        info->primaryKey = NULL;
+        deleteHash(&bm, headerPage);
+    }
+    removeTable(info);
+    freeTableInfo(info);
+    pthread_mutex_unlock(&catalogLatch);
+
+    // Return OK status code if table deletion is successful
+    return RC_OK;
+}
+
+int getNumTuples(RM_TableData *rel)
+{
+    RM_TableInfo *info = (RM_TableInfo *)rel->mgmtData;
+
+    // Data fom the first page is already in memory, for faster access
+    pthread_mutex_lock(&info->latch);
+    int numTuples = info->numTuples;
+    pthread_mutex_unlock(&info->latch);
+    return numTuples;
+}
+
+int getNumVersions(RM_TableData *rel)
+{
+    RM_TableInfo *info = (RM_TableInfo *)rel->mgmtData;
+
+    pthread_mutex_lock(&info->versionLatch);
+    int numVersions = info->numVersions;
+    pthread_mutex_unlock(&info->versionLatch);
+    return numVersions;
+}
+
+// transactions
+RC beginTransaction(void)
+{
+    if (currentTransaction != NULL)
+    {
+        THROW(RC_ERROR, "the thread already runs a transaction");
+    }
+
+    RM_Transaction *txn = (RM_Transaction *)malloc(sizeof(RM_Transaction));
+    startTransaction(txn);
+    currentTransaction = txn;
+    return RC_OK;
+}
+
+RC commitTransaction(void)
+{
+    RM_Transaction *txn = currentTransaction;
+    if (txn == NULL)
+    {
+        THROW(RC_ERROR, "the thread runs no transaction");
+    }
+
+    currentTransaction = NULL;
+    RC rc = commitChanges(txn);
+    free(txn);
+    return rc;
+}
+
+// handling records in a table
+
+// Insert a record, the caller holds the table latch
+static RC insertRecordLocked(RM_TableInfo *info, Schema *schema, Record *record, RM_Transaction *txn)
+{
+    BM_PageHandle page;
+    RC rc;
+
+    // Reject a record whose key is already in the table, or may be again after recovery
+    if (info->primaryKey != NULL)
+    {
+        getRecordKey(schema, record->data, info->keys);
+        if ((rc = reserveKey(info, txn, NULL, info->keys)) != RC_OK)
+        {
+            return rc;
+        }
+    }
+
+    // Take the lowest page with a free slot from the free space map, or append a new page if all pages are full.
+    // The free slots of a page may all be reserved by running transactions that freed them, the page then
+    // leaves the map until they end.
+    releaseFreedPages(info);
+    PageNumber pageNum;
+    int slot = -1;
+    while (slot == -1)
+    {
+        pageNum = findFreePage(info);
+        if (pageNum == NO_PAGE && (rc = allocateDataPage(info, &pageNum)) != RC_OK)
+        {
+            return rc;
+        }
+
+        if ((rc = pinPage(&bm, &page, pageNum)) != RC_OK)
+        {
+            return rc;
+        }
+        latchPage(&bm, &page, true);
+
+        // Insert the record into the first free slot of the page that is not reserved
+        if ((slot = findInsertSlot(info, txn, &page)) == -1)
+        {
+            setPageFree(info, pageNum, false);
+            releaseRecordPage(&page, false);
+        }
+    }
+    RM_PageHeader *header = PAGE_HEADER(page.data);
+    record->id.page = pageNum;          // Set the page number
+    record->id.slot = slot;             // Set the slot number
+
+    // Log the insert before the page changes
+    if ((rc = logTupleChange(info, txn, &page, LOG_INSERT, record->id, NULL, record->data)) != RC_OK)
+    {
+        releaseRecordPage(&page, false);
+        return rc;
+    }
+
+    // Keep the empty slot for older snapshots, then copy the tuple into the page
+    pushVersion(info, txn, record->id, NULL);
+    memcpy(TUPLE_PTR(page.data, slot, info->recordSize), record->data, info->recordSize);
+    setSlotUsed(page.data, slot, true); // Set the slot to occupied
+    header->numUsed++;                  // Increment the number of tuples on the page
+    info->numTuples++;                  // Increment the number of tuples in the table
+
+    // Remove full pages from the free space map
+    if (header->numUsed == header->numSlots)
+    {
+        setPageFree(info, pageNum, false);
+    }
+
+    if ((rc = releaseRecordPage(&page, true)) != RC_OK)
+    {
+        return rc;
+    }
+
+    // Add the record to the indexes, the B+-tree may still have the entry of an older tuple of the slot with the key
+    if (info->index != NULL)
+    {
+        if ((rc = insertHashKey(info->primaryKey, info->keys, record->id)) != RC_OK)
+        {
+            return rc;
+        }
+        rc = insertKey(info->index, info->keys, record->id);
+        return (rc == RC_IM_KEY_ALREADY_EXISTS) ? RC_OK : rc;
+    }
+
+    // Return OK status code if insertion is successful
+    return RC_OK;
+}
+
+RC insertRecord(RM_TableData *rel, Record *record)
+{
+    // If the table is not open, return an error code
+    RM_TableInfo *info = (RM_TableInfo *)rel->mgmtData;
+    if (info == NULL)
+    {
+        return RC_TABLE_NOT_FOUND;
+    }
+
+    // Changes to a table are serialized, scans only wait for the page being changed
+    RM_Transaction single;
+    RM_Transaction *txn = changeTransaction(&single);
+    pthread_mutex_lock(&info->latch);
+    RC rc = insertRecordLocked(info, rel->schema, record, txn);
+    pthread_mutex_unlock(&info->latch);
+    rc = finishChange(txn, rc);
+    collectVersionsIfNeeded(info);
+    return rc;
+}
+
+// Delete a record, the caller holds the table latch
+static RC deleteRecordLocked(RM_TableInfo *info, Schema *schema, RID id, RM_Transaction *txn)
+{
+    BM_PageHandle page;
+
+    // Pin the page containing the record, whose last change must have been committed or made by the transaction
+    RC rc = pinRecordPage(id, &page, true);
+    if (rc != RC_OK)
+    {
+        return rc;
+    }
+    if (changedByOther(info, txn, id))
+    {
+        releaseRecordPage(&page, false);
+        return RC_RM_WRITE_CONFLICT;
+    }
+
+    // Log the delete with the old tuple
+    if ((rc = logTupleChange(info, txn, &page, LOG_DELETE, id, TUPLE_PTR(page.data, id.slot, info->recordSize), NULL)) != RC_OK)
+    {
+        releaseRecordPage(&page, false);
+        return rc;
+    }
+
+    // Keep the tuple for older snapshots, then delete the record from the page
+    if (info->index != NULL)
+    {
+        getRecordKey(schema, TUPLE_PTR(page.data, id.slot, info->recordSize), info->keys);
+    }
+    pushVersion(info, txn, id, TUPLE_PTR(page.data, id.slot, info->recordSize));
+    setSlotUsed(page.data, id.slot, false);
+    PAGE_HEADER(page.data)->numUsed--;
+    info->numTuples--;
+
+    // The page has a free slot for the inserts once the transaction ended
+    addFreedPage(info, txn, id.page);
+
+    // The index entries of the record stay until its version is collected, the key stays taken until then. Only
+    // a record the transaction inserted itself leaves no version behind.
+    if (info->index != NULL)
+    {
+        rc = dropUnheldKey(info, &page, id.slot, info->keys);
+    }
+
+    // Return OK status code if deletion is successful
+    RC rcRelease = releaseRecordPage(&page, true);
+    return (rc != RC_OK) ? rc : rcRelease;
+}
+
+RC deleteRecord(RM_TableData *rel, RID id)
+{
+    // Check if the table exists
+    RM_TableInfo *info = (RM_TableInfo *)rel->mgmtData;
+    if (info == NULL)
+    {
+        return RC_TABLE_NOT_FOUND;
+    }
+
+    RM_Transaction single;
+    RM_Transaction *txn = changeTransaction(&single);
+    pthread_mutex_lock(&info->latch);
+    RC rc = deleteRecordLocked(info, rel->schema, id, txn);
+    pthread_mutex_unlock(&info->latch);
+    rc = finishChange(txn, rc);
+    collectVersionsIfNeeded(info);
+    return rc;
+}
+
+// Update a record, the caller holds the table latch
+static RC updateRecordLocked(RM_TableInfo *info, Schema *schema, Record *record, RM_Transaction *txn)
+{
+    BM_PageHandle page;
+
+    // Pin the page containing the record, whose last change must have been committed or made by the transaction
+    RC rc = pinRecordPage(record->id, &page, true);
+    if (rc != RC_OK)
+    {
+        return rc;
+    }
+    if (changedByOther(info, txn, record->id))
+    {
+        releaseRecordPage(&page, false);
+        return RC_RM_WRITE_CONFLICT;
+    }
+
+    // Index the record under its new key if the key changes, the new key must not be taken. The entries of the
+    // old key stay until the old version is collected, the key stays taken until then.
+    char *tuple = TUPLE_PTR(page.data, record->id.slot, info->recordSize);
+    char *oldKey = info->keys;
+    bool moved = false;
+    if (info->index != NULL)
+    {
+        char *newKey = info->keys + getKeySize(schema);
+        getRecordKey(schema, tuple, oldKey);
+        getRecordKey(schema, record->data, newKey);
+        moved = (compareKeys(schema, oldKey, newKey) != 0);
+        if (moved &&
+            ((rc = reserveKey(info, txn, &page, newKey)) != RC_OK ||
+             (rc = insertHashKey(info->primaryKey, newKey, record->id)) != RC_OK ||
+             ((rc = insertKey(info->index, newKey, record->id)) != RC_OK && rc != RC_IM_KEY_ALREADY_EXISTS)))
+        {
+            releaseRecordPage(&page, false);
+            return rc;
+        }
+    }
+
+    // Log the old and the new tuple, keep the old one for older snapshots, then update the record in the page
+    if ((rc = logTupleChange(info, txn, &page, LOG_UPDATE, record->id, tuple, record->data)) != RC_OK)
+    {
+        releaseRecordPage(&page, false);
+        return rc;
+    }
+    pushVersion(info, txn, record->id, tuple);
+    memcpy(tuple, record->data, info->recordSize);
+
+    // Only a key the transaction gave the record itself leaves no version behind
+    if (moved)
+    {
+        rc = dropUnheldKey(info, &page, record->id.slot, oldKey);
+    }
+
+    // Return OK status code if update is successful
+    RC rcRelease = releaseRecordPage(&page, true);
+    return (rc != RC_OK) ? rc : rcRelease;
+}
+
+RC updateRecord(RM_TableData *rel, Record *record)
+{
+    // Check if the table exists
+    RM_TableInfo *info = (RM_TableInfo *)rel->mgmtData;
+    if (info == NULL)
+    {
+        return RC_TABLE_NOT_FOUND;
+    }
+
+    RM_Transaction single;
+    RM_Transaction *txn = changeTransaction(&single);
+    pthread_mutex_lock(&info->latch);
+    RC rc = updateRecordLocked(info, rel->schema, record, txn);
+    pthread_mutex_unlock(&info->latch);
+    rc = finishChange(txn, rc);
+    collectVersionsIfNeeded(info);
+    return rc;
+}
+
+RC getRecord(RM_TableData *rel, RID id, Record *record)
+{
+    // Check if the table exists
+    RM_TableInfo *info = (RM_TableInfo *)rel->mgmtData;
+    if (info == NULL)
+    {
+        return RC_TABLE_NOT_FOUND;
+    }
+
+    BM_PageHandle page;
+
+    // Pin the page containing the record, reading it only needs the page latch
+    RC rc = pinPage(&bm, &page, id.page);
+    if (rc != RC_OK)
+    {
+        return rc;
+    }
+    latchPage(&bm, &page, false);
+
+    // Copy the latest committed version of the record, or the thread's own, out of the page or the older versions
+    bool found = id.slot >= 0 && id.slot < PAGE_HEADER(page.data)->numSlots &&
+                 readVersion(info, NULL, &page, id.slot, record->data);
+    record->id = id;
+
+    releaseRecordPage(&page, false);
+
+    // Return OK status code if retrieval is successful
+    return found ? RC_OK : RC_RM_NO_MORE_TUPLES;
+}
+
+// Read the latest committed version of a tuple, or the thread's own, if it holds a key. The caller holds the
+// table latch.
+static bool readKeyVersion(RM_TableInfo *info, RID id, char *key, Record *record)
+{
+    Schema *schema = info->rel->schema;
+    char *held = info->keys + 2 * getKeySize(schema);
+    BM_PageHandle page;
+
+    if (pinPage(&bm, &page, id.page) != RC_OK)
+    {
+        return false;
+    }
+    latchPage(&bm, &page, false);
+    bool found = id.slot >= 0 && id.slot < PAGE_HEADER(page.data)->numSlots &&
+                 readVersion(info, NULL, &page, id.slot, record->data);
+    releaseRecordPage(&page, false);
+
+    if (found)
+    {
+        getRecordKey(schema, record->data, held);
+        found = (compareKeys(schema, held, key) == 0);
+    }
+    record->id = id;
+    return found;
+}
 
-    // Return an error code if the table does not exist
-    if (currentActiveTable == NULL)
+RC getRecordByKey(RM_TableData *rel, Value **key, Record *record)
+{
+    // Check if the table exists
+    RM_TableInfo *info = (RM_TableInfo *)rel->mgmtData;
+    if (info == NULL)
     {
         return RC_TABLE_NOT_FOUND;
     }
 
-    // Set the table info
-    rel->name = currentActiveTable->name;
-    rel->schema = currentActiveTable->schema;
-    rel->mgmtData = currentActiveTable->mgmtData;
+    BT_ScanHandle *scan;
+    RID id, holder;
+    RC rc;
 
-    return RC_OK;
+    if (info->primaryKey == NULL)
+    {
+        THROW(RC_ERROR, "table has no key");
+    }
+
+    // Look the RID of the key up in the hash index, and read the record before its slot can change. The hash
+    // index maps the key to the tuple that took it last, whose change may not be committed; the B+-tree also
+    // has the entries of the tuples that held the key before, until their versions are collected.
+    pthread_mutex_lock(&info->latch);
+    if ((rc = valuesToKey(rel->schema, key, info->keys)) == RC_OK &&
+        (rc = findHashKey(info->primaryKey, info->keys, &holder)) == RC_OK &&
+        !readKeyVersion(info, holder, info->keys, record) &&
+        (rc = openTreeScanFrom(info->index, info->keys, &scan)) == RC_OK)
+    {
+        char *entryKey = info->keys + getKeySize(rel->schema);
+        bool found = false;
+        while (!found && (rc = nextEntryWithKey(scan, &id, entryKey)) == RC_OK && compareKeys(rel->schema, entryKey, info->keys) == 0)
+        {
+            found = (id.page != holder.page || id.slot != holder.slot) && readKeyVersion(info, id, info->keys, record);
+        }
+        closeTreeScan(scan);
+        rc = found ? RC_OK : (rc == RC_OK || rc == RC_IM_NO_MORE_ENTRIES) ? RC_IM_KEY_NOT_FOUND : rc;
+    }
+    pthread_mutex_unlock(&info->latch);
+    return rc;
 }
 
-RC closeTable(RM_TableData *rel)
+// scans
+
+// Narrow the key range of a scan with a bound from one conjunct of its condition
+static void addKeyBound(RM_ScanInfo *info, Schema *schema, Value *value, bool lower, bool upper)
 {
-    currentActiveTable = NULL;
-    unpinPage(&fh, &ph);
-    return RC_OK;
+    int keySize = getKeySize(schema);
+    char *bound = info->keys + 2 * keySize;
+    Value *values[] = {value};
+
+    if (valuesToKey(schema, values, bound) != RC_OK)
+    {
+        return;
+    }
+    if (lower && (!info->hasLower || compareKeys(schema, bound, info->keys) > 0))
+    {
+        memcpy(info->keys, bound, keySize);
+        info->hasLower = true;
+    }
+    if (upper && (!info->hasUpper || compareKeys(schema, bound, info->keys + keySize) < 0))
+    {
+        memcpy(info->keys + keySize, bound, keySize);
+        info->hasUpper = true;
+    }
 }
 
-RC deleteTable(char *name)
+// Collect the bounds on the key attribute from the conjuncts of a condition: key = c, key < c, c < key, and their negations
+static void collectKeyBounds(RM_ScanInfo *info, Schema *schema, Expr *expr)
 {
-    // Pin the first page
-    pinPage(&fh, &ph, TABLE_INFO_PAGE_NUM);
+    bool negated = false;
 
-    // Reset the table info
-    int i;
-    for (i = 0; i < 10; i++)
+    if (expr->type != EXPR_OP)
+    {
+        return;
+    }
+    if (expr->expr.op->type == OP_BOOL_AND)
     {
-        if (tables[i] != NULL && strcmp(tables[i]->rel->name, name) == 0)
+        collectKeyBounds(info, schema, expr->expr.op->args[0]);
+        collectKeyBounds(info, schema, expr->expr.op->args[1]);
+        return;
+    }
+    if (expr->expr.op->type == OP_BOOL_NOT)
+    {
+        negated = true;
+        expr = expr->expr.op->args[0];
+        if (expr->type != EXPR_OP)
         {
-            tables[i]->rel->name = NO_TABLE;
-            tables[i]->rel->schema = NULL;
-            tables[i]->rel->mgmtData = NULL;
-            tables[i]->numTuples = 0;
-            tables[i]->records = NULL;
-            tables[i]->slotsBitMap = NULL;
-            tables[i]->numSlotsPerPage = 0;
-            tables[i]->totalNumPages = 0;
-            tables[i]->currentPageNum = 0;
-
-            tables[i] = NULL;
+            return;
         }
     }
 
-    // Write the table info to the first page
-    // memcpy(ph, serializeTableInfo(rel), sizeof(RM_TableData));
-    markDirty(&fh, &ph);
-    unpinPage(&fh, &ph);
-
-    // Return OK status code if table deletion is successful
-    return RC_OK;
-}
-
-int getNumTuples(RM_TableData *rel)
-{
-    // Data fom the first page is already in memory, for faster access
-    return tables[currentActiveTableIndex]->numTuples;
-}
+    OpType type = expr->expr.op->type;
+    Expr *left = expr->expr.op->args[0];
+    Expr *right = (type == OP_COMP_EQUAL || type == OP_COMP_SMALLER) ? expr->expr.op->args[1] : NULL;
+    bool keyLeft;
 
-// handling records in a table
-RC insertRecord(RM_TableData *rel, Record *record)
-{
-    // If there is no current active table, return an error code
-    if (currentActiveTable == NULL)
+    if (right == NULL)
     {
-        return RC_TABLE_NOT_FOUND;
+        return;
     }
-
-    // If the current page is full, create a new page
-    if (tables[currentActiveTableIndex]->numTuples == slots)
+    if (left->type == EXPR_ATTRREF && left->expr.attrRef == schema->keyAttrs[0] && right->type == EXPR_CONST)
     {
-        pinPage(&fh, &ph, tables[currentActiveTableIndex]->totalNumPages);
-        tables[currentActiveTableIndex]->totalNumPages++;
-        tables[currentActiveTableIndex]->currentPageNum++;
-        tables[currentActiveTableIndex]->numTuples = 0;
-        unpinPage(&fh, &ph);
-
-        // return RC_RM_NO_MORE_TUPLES;
+        keyLeft = true;
+    }
+    else if (right->type == EXPR_ATTRREF && right->expr.attrRef == schema->keyAttrs[0] && left->type == EXPR_CONST)
+    {
+        keyLeft = false;
     }
+    else
+    {
+        return;
+    }
+    Value *value = keyLeft ? right->expr.cons : left->expr.cons;
 
-    // Insert the record into the table
-    int i;
-    for (i = 0; i < slots; i++)
+    if (type == OP_COMP_EQUAL)
     {
-        // Check if the slot is empty
-        if (tables[currentActiveTableIndex]->slotsBitMap[i] == 0)
+        if (!negated)
         {
-            tables[currentActiveTableIndex]->slotsBitMap[i] = 1;               // Set the slot to occupied
-            record->id.page = tables[currentActiveTableIndex]->currentPageNum; // Set the page number
-            record->id.slot = i;                                               // Set the slot number
-            tables[currentActiveTableIndex]->records[i] = *record;             // Insert the record into the table
-            tables[currentActiveTableIndex]->numTuples++;                      // Increment the number of tuples in the table
-            return RC_OK;                                                      // Return OK status code if insertion is successful
+            addKeyBound(info, schema, value, true, true);
         }
     }
-
-    // Return an error code if there is no empty slot
-    return RC_RM_NO_MORE_TUPLES;
+    else
+    {
+        // key < c and NOT (c < key) bound the key from above, c < key and NOT (key < c) from below
+        bool upper = (keyLeft != negated);
+        addKeyBound(info, schema, value, !upper, upper);
+    }
 }
 
-RC deleteRecord(RM_TableData *rel, RID id)
+// Drive the scan from the table's B+-tree if the condition bounds the key
+static RC planIndexScan(RM_ScanInfo *info, RM_TableInfo *table, Schema *schema, Expr *cond)
 {
-    // Pin the page containing the record
-    pinPage(&fh, &ph, id.page);
-
-    // Check if the table exists
-    if (currentActiveTable == NULL)
+    info->indexScan = NULL;
+    info->keys = NULL;
+    info->hasLower = false;
+    info->hasUpper = false;
+    info->indexDone = false;
+
+    // The B+-tree orders single attribute keys by that attribute
+    if (cond == NULL || table->index == NULL || schema->keySize != 1)
     {
-        unpinPage(&fh, &ph);
-        return RC_TABLE_NOT_FOUND;
+        return RC_OK;
     }
 
-    // Check if the slot is empty
-    if (tables[currentActiveTableIndex]->slotsBitMap[id.slot] == 0)
+    info->keys = (char *)malloc(4 * getKeySize(schema));
+    collectKeyBounds(info, schema, cond);
+    if (!info->hasLower && !info->hasUpper)
     {
-        unpinPage(&fh, &ph);
-        return RC_RM_NO_MORE_TUPLES;
+        return RC_OK;
     }
 
-    // Delete the record from the table
-    tables[currentActiveTableIndex]->slotsBitMap[id.slot] = 0;
-    tables[currentActiveTableIndex]->numTuples--;
-
-    // Write the table info to the first page
-    // memcpy(ph, serializeTableInfo(rel), sizeof(RM_TableData));
-    markDirty(&fh, &ph);
-    unpinPage(&fh, &ph);
-
-    // Return OK status code if deletion is successful
-    return RC_OK;
+    return info->hasLower ? openTreeScanFrom(table->index, info->keys, &info->indexScan)
+                          : openTreeScan(table->index, &info->indexScan);
 }
 
-RC updateRecord(RM_TableData *rel, Record *record)
+RC startScan(RM_TableData *rel, RM_ScanHandle *scan, Expr *cond)
 {
-    // Pin the page containing the record
-    pinPage(&fh, &ph, record->id.page);
-
     // Check if the table exists
-    if (currentActiveTable == NULL)
+    RM_TableInfo *table = (RM_TableInfo *)rel->mgmtData;
+    if (table == NULL)
     {
-        unpinPage(&fh, &ph);
         return RC_TABLE_NOT_FOUND;
     }
 
-    // Check if the slot is empty
-    if (tables[currentActiveTableIndex]->slotsBitMap[record->id.slot] == 0)
+    // Initialize the scan info, starting at the first slot of the table
+    RM_ScanInfo *info = (RM_ScanInfo *)malloc(sizeof(RM_ScanInfo));
+    info->cond = cond; // Store the scan condition for later use
+    info->program = NULL;
+
+    // Compile the condition once, so evaluating it per tuple needs no allocation
+    if (cond != NULL)
     {
-        unpinPage(&fh, &ph);
-        return RC_RM_NO_MORE_TUPLES;
+        RC rc = compileExpr(cond, rel->schema, &info->program);
+        if (rc != RC_OK)
+        {
+            free(info);
+            return rc;
+        }
+    }
+
+    // Simple comparisons are evaluated for a whole page at once into a selection bitmap
+    info->selection = NULL;
+    if (info->program != NULL && info->program->hasFilter)
+    {
+        info->selection = (uint64_t *)malloc(BITMAP_WORDS(table->numSlotsPerPage) * sizeof(uint64_t));
     }
 
-    // Update the record in the table
-    tables[currentActiveTableIndex]->records[record->id.slot] = *record;
+    // Take the snapshot the scan reads, writers go on changing the table meanwhile
+    info->snapshot = takeSnapshot(true);
+    info->tuple = (char *)malloc(table->recordSize);
 
-    // Write the table info to the first page
-    // memcpy(ph, serializeTableInfo(rel), sizeof(RM_TableData));
-    markDirty(&fh, &ph);
-    unpinPage(&fh, &ph);
+    info->current.page = table->firstPage;
+    info->current.slot = 0;
+    info->readAhead = 0;
+    // Read the pages of the scan into a private ring, so the scan does not flush the buffer pool
+    info->ring = createAccessRing(&bm, SCAN_RING_SIZE);
 
-    // Return OK status code if update is successful
+    pthread_mutex_lock(&table->latch);
+    RC rc = planIndexScan(info, table, rel->schema, cond);
+    pthread_mutex_unlock(&table->latch);
+    if (rc != RC_OK)
+    {
+        scan->rel = rel;
+        scan->mgmtData = info;
+        closeScan(scan);
+        return rc;
+    }
+
+    // Initialize the scan handle
+    scan->rel = rel;
+    scan->mgmtData = info;
+    scan->scanCounter = 0; // Reset the number of tuples returned by the scan
+
+    // Return OK status code if scan is successful
     return RC_OK;
 }
 
-RC getRecord(RM_TableData *rel, RID id, Record *record)
+// Queue the pages after the current page of a full scan for read-ahead, half of SCAN_PREFETCH_PAGES at a time.
+// Data pages are appended to a table in ascending order, so its next pages most likely follow the current one;
+// pages of other tables and indexes in between are read ahead as well.
+static void readAhead(RM_ScanInfo *info)
 {
-    // Pin the page containing the record
-    pinPage(&fh, &ph, id.page);
-
-    // Check if the table exists
-    if (currentActiveTable == NULL)
+    PageNumber next = info->current.page + 1;
+    if (info->readAhead >= next + SCAN_PREFETCH_PAGES / 2)
     {
-        unpinPage(&fh, &ph);
-        return RC_TABLE_NOT_FOUND;
+        return;
     }
 
-    // Check if the slot is empty
-    if (tables[currentActiveTableIndex]->slotsBitMap[id.slot] == 0)
+    PageNumber first = (info->readAhead > next) ? info->readAhead : next;
+    prefetchPages(&bm, first, next + SCAN_PREFETCH_PAGES - first);
+    info->readAhead = next + SCAN_PREFETCH_PAGES;
+}
+
+RC next(RM_ScanHandle *scan, Record *record)
+{
+    int numRecords;
+    return nextBatch(scan, record, 1, &numRecords);
+}
+
+// Fill a batch from the entries of an index scan, in key order
+static RC nextBatchFromIndex(RM_ScanHandle *scan, Record *records, int maxRecords, int *numRecords)
+{
+    RM_ScanInfo *info = (RM_ScanInfo *)scan->mgmtData;
+    RM_TableInfo *table = (RM_TableInfo *)scan->rel->mgmtData;
+    Schema *schema = table->rel->schema;
+    int keySize = getKeySize(schema);
+    BM_PageHandle page;
+    RID id;
+    RC rc = RC_OK;
+
+    // The index entries and the tuples they point to do not change while the batch is filled
+    pthread_mutex_lock(&table->latch);
+    while (*numRecords < maxRecords && !info->indexDone)
     {
-        unpinPage(&fh, &ph);
-        return RC_RM_NO_MORE_TUPLES;
-    }
+        char *key = info->keys + 2 * keySize;
+        if ((rc = nextEntryWithKey(info->indexScan, &id, key)) != RC_OK)
+        {
+            if (rc == RC_IM_NO_MORE_ENTRIES)
+            {
+                info->indexDone = true;
+                rc = RC_OK;
+            }
+            break;
+        }
 
-    // Get the record from the table
-    *record = tables[currentActiveTableIndex]->records[id.slot];
+        // The entries are in key order, the scan ends at the first entry above the range
+        if (info->hasUpper && compareKeys(schema, key, info->keys + keySize) > 0)
+        {
+            info->indexDone = true;
+            break;
+        }
+        if ((rc = pinPage(&bm, &page, id.page)) != RC_OK)
+        {
+            break;
+        }
+        latchPage(&bm, &page, false);
 
-    // Write the table info to the first page
-    unpinPage(&fh, &ph);
+        // The index keeps the entries of deleted tuples and of the old keys of tuples until their versions are
+        // collected, so an entry counts only if the version of its tuple in the snapshot has the key of the entry
+        char *tuple = info->tuple;
+        char *tupleKey = info->keys + 3 * keySize;
+        if (!readVersion(table, info->snapshot, &page, id.slot, tuple))
+        {
+            releaseRecordPage(&page, false);
+            continue;
+        }
+        getRecordKey(schema, tuple, tupleKey);
+        if (compareKeys(schema, tupleKey, key) != 0)
+        {
+            releaseRecordPage(&page, false);
+            continue;
+        }
 
-    // Return OK status code if retrieval is successful
-    return RC_OK;
+        // Check the whole condition, the range only covers its key bounds
+        if (info->program == NULL || evalProgram(info->program, tuple))
+        {
+            Record *record = &records[(*numRecords)++];
+            if (record->data != NULL)
+            {
+                memcpy(record->data, tuple, table->recordSize);
+            }
+            record->id = id;
+        }
+        releaseRecordPage(&page, false);
+    }
+    pthread_mutex_unlock(&table->latch);
+
+    scan->scanCounter += *numRecords;
+    if (*numRecords > 0)
+    {
+        return RC_OK;
+    }
+    return info->indexDone ? RC_RM_NO_MORE_TUPLES : rc;
 }
 
-// scans
-RC startScan(RM_TableData *rel, RM_ScanHandle *scan, Expr *cond)
+// Fill a batch from a data page with older versions, reading every slot as of the scan's snapshot, and move the
+// scan past the visited slots. The caller holds the page latch and the version latch.
+static void nextVisibleBatch(RM_ScanInfo *info, RM_TableInfo *table, char *data, RM_PageVersions *versions,
+                             Record *records, int maxRecords, int *numRecords)
 {
-    // Pin the first page
-    pinPage(&fh, &ph, TABLE_INFO_PAGE_NUM);
+    int numSlots = PAGE_HEADER(data)->numSlots;
+    int slot = info->current.slot;
 
-    // Check if the table exists
-    if (currentActiveTable == NULL)
+    for (; slot < numSlots && *numRecords < maxRecords; slot++)
     {
-        return RC_TABLE_NOT_FOUND;
-    }
+        if (!readVisibleTuple(table, info->snapshot, data, versions->chains[slot], slot, info->tuple) ||
+            (info->program != NULL && !evalProgram(info->program, info->tuple)))
+        {
+            continue;
+        }
 
-    // Initialize the scan handle
-    scan->rel = rel;
-    scan->mgmtData = cond; // Store the scan condition for later use
-    scan->scanCounter = 0; // Reset the scan index to start from the beginning of the table
+        Record *record = &records[(*numRecords)++];
+        if (record->data != NULL)
+        {
+            memcpy(record->data, info->tuple, table->recordSize);
+        }
+        record->id.page = info->current.page;
+        record->id.slot = slot;
+    }
 
-    // Return OK status code if scan is successful
-    return RC_OK;
+    // Continue on the next page of the table once this page is done
+    if (slot == numSlots)
+    {
+        info->current.page = PAGE_HEADER(data)->nextPage;
+        info->current.slot = 0;
+    }
+    else
+    {
+        info->current.slot = slot;
+    }
 }
 
-RC next(RM_ScanHandle *scan, Record *record)
+RC nextBatch(RM_ScanHandle *scan, Record *records, int maxRecords, int *numRecords)
 {
+    *numRecords = 0;
+
     // Check if the table exists
-    if (currentActiveTable == NULL || scan->mgmtData == NULL)
+    if (scan->mgmtData == NULL || scan->rel->mgmtData == NULL)
     {
         return RC_TABLE_NOT_FOUND;
     }
 
-    // Get the scan condition
-    Expr *cond = (Expr *)scan->mgmtData;
-    RM_TableData *rel = scan->rel;
-    Schema *schema = rel->schema;
-    Operator *op = NULL;
-    Record *records = tables[currentActiveTableIndex]->records;
+    RM_ScanInfo *info = (RM_ScanInfo *)scan->mgmtData;
+    if (info->indexScan != NULL)
+    {
+        return nextBatchFromIndex(scan, records, maxRecords, numRecords);
+    }
+    RM_TableInfo *table = (RM_TableInfo *)scan->rel->mgmtData;
+    int recordSize = table->recordSize;
+    BM_PageHandle page;
+    RC rc = RC_OK;
 
-    // Scan the table for the next tuple
-    while (scan->scanCounter < slots)
+    // Scan the pages of the table until the batch is full
+    while (info->current.page != NO_PAGE && *numRecords < maxRecords)
     {
-        // Check if there is a condition to evaluate
-        if (cond != NULL && tables[currentActiveTableIndex]->slotsBitMap[scan->scanCounter] == 1)
+        readAhead(info);
+        if ((rc = pinPageWithRing(&bm, info->ring, &page, info->current.page)) != RC_OK)
+        {
+            break;
+        }
+        latchPage(&bm, &page, false);
+
+        // A page without older versions holds the tuples as every snapshot sees them, and no writer adds versions
+        // while the page is latched; the others are read slot by slot as of the scan's snapshot
+        pthread_mutex_lock(&table->versionLatch);
+        RM_PageVersions *versions = findPageVersions(table, info->current.page, false);
+        if (versions != NULL)
         {
-            // Evaluate the expression to determine if the current tuple satisfies the condition
-            Value *result = NULL;
-            // Evaluate the expression to determine if the current tuple satisfies the condition
-            evalExpr(&records[scan->scanCounter], schema, cond, &result);
+            nextVisibleBatch(info, table, page.data, versions, records, maxRecords, numRecords);
+            pthread_mutex_unlock(&table->versionLatch);
+            unlatchPage(&bm, &page);
+            unpinPage(&bm, &page);
+            continue;
+        }
+        pthread_mutex_unlock(&table->versionLatch);
 
-            // Check if the current tuple satisfies the condition
-            if (result->v.boolV == FALSE)
+        // Evaluate the condition on the used slots of the page, copying out only the matching tuples
+        int slot = info->current.slot;
+        int numSlots = PAGE_HEADER(page.data)->numSlots;
+        uint64_t *candidates = SLOT_BITMAP(page.data);
+
+        // With a filter, select the matching slots from the word of the current slot on in one pass
+        if (info->selection != NULL)
+        {
+            int first = (slot / 64) * 64;
+            filterProgram(info->program, TUPLE_PTR(page.data, first, recordSize), recordSize, numSlots - first, info->selection + first / 64);
+            for (int w = first / 64; w < BITMAP_WORDS(numSlots); w++)
             {
-                freeVal(result);     // Free the memory allocated for the result value
-                scan->scanCounter++; // Increment the scan index
-                continue;            // Continue to the next tuple
+                info->selection[w] &= candidates[w];
             }
-            freeVal(result); // Free the memory allocated for the result value
+            candidates = info->selection;
+        }
+
+        while (*numRecords < maxRecords && (slot = findSetBit(candidates, numSlots, slot)) != -1)
+        {
+            char *tuple = TUPLE_PTR(page.data, slot, recordSize);
+            slot++;
 
-            // Retrieve the tuple and set it in the `record` parameter
-            getRecord(rel, (RID){.page = records[scan->scanCounter].id.page, .slot = records[scan->scanCounter].id.slot}, record);
-            // Increment the scan index
-            scan->scanCounter++;
+            if (info->selection == NULL && info->program != NULL && !evalProgram(info->program, tuple))
+            {
+                continue; // Continue to the next tuple
+            }
 
-            // Return OK status code if the tuple satisfies the condition
-            return RC_OK;
+            // Set the tuple in the next record of the batch, records without data only get the RID
+            Record *record = &records[(*numRecords)++];
+            if (record->data != NULL)
+            {
+                memcpy(record->data, tuple, recordSize);
+            }
+            record->id.page = info->current.page;
+            record->id.slot = slot - 1;
         }
 
-        //
-        scan->scanCounter++;
+        // Continue after the last visited slot, or on the next page of the table if this page is done
+        if (slot == -1)
+        {
+            info->current.page = PAGE_HEADER(page.data)->nextPage;
+            info->current.slot = 0;
+        }
+        else
+        {
+            info->current.slot = slot;
+        }
+        unlatchPage(&bm, &page);
+        unpinPage(&bm, &page);
     }
 
-    // No more tuples to return
-    return RC_RM_NO_MORE_TUPLES;
+    scan->scanCounter += *numRecords;
+
+    // Return OK status code if at least one tuple satisfies the condition
+    if (*numRecords > 0)
+    {
+        return RC_OK;
+    }
+    return (info->current.page == NO_PAGE) ? RC_RM_NO_MORE_TUPLES : rc;
 }
 
 RC closeScan(RM_ScanHandle *scan)
 {
     // Clear any resources or cleanup here if needed
+    if (scan->mgmtData != NULL)
+    {
+        freeAccessRing(((RM_ScanInfo *)scan->mgmtData)->ring);
+        freeProgram(((RM_ScanInfo *)scan->mgmtData)->program);
+        free(((RM_ScanInfo *)scan->mgmtData)->selection);
+        if (((RM_ScanInfo *)scan->mgmtData)->indexScan != NULL)
+        {
+            closeTreeScan(((RM_ScanInfo *)scan->mgmtData)->indexScan);
+        }
+        free(((RM_ScanInfo *)scan->mgmtData)->keys);
+        releaseSnapshot(((RM_ScanInfo *)scan->mgmtData)->snapshot);
+        free(((RM_ScanInfo *)scan->mgmtData)->tuple);
+        free(scan->mgmtData);
+
+        // Drop the versions only the snapshot of the scan still needed, once enough of them accumulated
+        if (scan->rel != NULL && scan->rel->mgmtData != NULL)
+        {
+            collectVersionsIfNeeded((RM_TableInfo *)scan->rel->mgmtData);
+        }
+    }
     scan->rel = NULL;
     scan->mgmtData = NULL;
     scan->scanCounter = 0;
@@ -500,8 +3181,9 @@ RC createRecord(Record **record, Schema *schema)
     *record = (Record *)malloc(sizeof(Record));
     // Allocate memory for the record's data field
     (*record)->data = (char *)malloc(getRecordSize(schema));
-    // Set the page number to current page number
-    (*record)->id.page = currentPageNum;
+    // The record is not stored in a table yet
+    (*record)->id.page = NO_PAGE;
+    (*record)->id.slot = -1;
     // Return OK status code if record creation is successful
     return RC_OK;
 }
@@ -620,3 +3302,178 @@ RC setAttr(Record *record, Schema *schema, int attrNum, Value *value)
     // Return OK status code if attribute setting is successful
     return RC_OK;
 }
+
+// dealing with keys: the key of a record is the concatenation of its key attributes (Schema.keyAttrs)
+static int getAttributeSize(Schema *schema, int attrNum)
+{
+    switch (schema->dataTypes[attrNum])
+    {
+    case DT_INT:
+        return sizeof(int);
+    case DT_STRING:
+        return schema->typeLength[attrNum];
+    case DT_FLOAT:
+        return sizeof(float);
+    case DT_BOOL:
+        return sizeof(bool);
+    }
+    return 0;
+}
+
+int getKeySize(Schema *schema)
+{
+    int size = 0;
+    for (int i = 0; i < schema->keySize; i++)
+    {
+        size += getAttributeSize(schema, schema->keyAttrs[i]);
+    }
+    return size;
+}
+
+void getRecordKey(Schema *schema, char *data, char *key)
+{
+    // Copy the key attributes one after the other
+    for (int i = 0; i < schema->keySize; i++)
+    {
+        int attrNum = schema->keyAttrs[i];
+        int size = getAttributeSize(schema, attrNum);
+        memcpy(key, data + getAttributeOffset(schema, attrNum), size);
+        key += size;
+    }
+}
+
+RC valuesToKey(Schema *schema, Value **values, char *key)
+{
+    for (int i = 0; i < schema->keySize; i++)
+    {
+        int attrNum = schema->keyAttrs[i];
+        int size = getAttributeSize(schema, attrNum);
+
+        // Check if the value's data type matches the key attribute's data type
+        if (values[i]->dt != schema->dataTypes[attrNum])
+        {
+            return RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE;
+        }
+
+        switch (values[i]->dt)
+        {
+        case DT_INT:
+            memcpy(key, &values[i]->v.intV, size);
+            break;
+        case DT_STRING:
+            // Pad short strings with zeros like the stored attribute
+            memset(key, 0, size);
+            memcpy(key, values[i]->v.stringV, strnlen(values[i]->v.stringV, size));
+            break;
+        case DT_FLOAT:
+            memcpy(key, &values[i]->v.floatV, size);
+            break;
+        case DT_BOOL:
+            memcpy(key, &values[i]->v.boolV, size);
+            break;
+        }
+        key += size;
+    }
+    return RC_OK;
+}
+
+int compareKeys(Schema *schema, char *left, char *right)
+{
+    // Compare the key attributes in order, the first that differs decides
+    for (int i = 0; i < schema->keySize; i++)
+    {
+        int attrNum = schema->keyAttrs[i];
+        int size = getAttributeSize(schema, attrNum);
+        int cmp = 0;
+
+        switch (schema->dataTypes[attrNum])
+        {
+        case DT_INT:
+        {
+            int l, r;
+            memcpy(&l, left, sizeof(int));
+            memcpy(&r, right, sizeof(int));
+            cmp = (l > r) - (l < r);
+            break;
+        }
+        case DT_FLOAT:
+        {
+            float l, r;
+            memcpy(&l, left, sizeof(float));
+            memcpy(&r, right, sizeof(float));
+            cmp = (l > r) - (l < r);
+            break;
+        }
+        case DT_BOOL:
+        {
+            bool l, r;
+            memcpy(&l, left, sizeof(bool));
+            memcpy(&r, right, sizeof(bool));
+            cmp = (l > r) - (l < r);
+            break;
+        }
+        case DT_STRING:
+        {
+            // Strings are not necessarily terminated, compare them like strncmp
+            int lLen = strnlen(left, size);
+            int rLen = strnlen(right, size);
+            cmp = memcmp(left, right, (lLen < rLen) ? lLen : rLen);
+            if (cmp == 0)
+            {
+                cmp = lLen - rLen;
+            }
+            break;
+        }
+        }
+
+        if (cmp != 0)
+        {
+            return cmp;
+        }
+        left += size;
+        right += size;
+    }
+    return 0;
+}
+
+unsigned int hashKey(Schema *schema, char *key)
+{
+    // FNV-1a over the key attributes; keys that compare equal hash alike, so strings are hashed
+    // up to their terminator and both zeros of a float are hashed as one
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < schema->keySize; i++)
+    {
+        int attrNum = schema->keyAttrs[i];
+        int size = getAttributeSize(schema, attrNum);
+        int length = size;
+        char *bytes = key;
+        float f;
+
+        if (schema->dataTypes[attrNum] == DT_STRING)
+        {
+            length = strnlen(key, size);
+        }
+        else if (schema->dataTypes[attrNum] == DT_FLOAT)
+        {
+            memcpy(&f, key, sizeof(float));
+            if (f == 0)
+            {
+                f = 0;
+            }
+            bytes = (char *)&f;
+        }
+
+        for (int b = 0; b < length; b++)
+        {
+            hash = (hash ^ (unsigned char)bytes[b]) * 16777619u;
+        }
+        hash = (hash ^ 0xff) * 16777619u; // separates the attributes
+        key += size;
+    }
+
+    // Mix the high bits into the low bits, hash tables use the low bits
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    return hash;
+}
@@ -21,16 +21,34 @@ extern RC openTable (RM_TableData *rel, char *name);
 extern RC closeTable (RM_TableData *rel);
 extern RC deleteTable (char *name);
 extern int getNumTuples (RM_TableData *rel);
+// older versions of the tuples the table keeps for the snapshots of running scans, see startScan
+extern int getNumVersions (RM_TableData *rel);
+
+// transactions: the changes a thread makes between beginTransaction and commitTransaction are logged as
+// one transaction, which commitTransaction makes durable; every other change commits on its own
+extern RC beginTransaction (void);
+extern RC commitTransaction (void);
+
+// checkpoints: write the pages dirty when the checkpoint begins back in page-number order while the tables keep
+// changing, log the dirty pages and running transactions, and drop the log recovery no longer reads. A background
+// thread takes a checkpoint whenever enough log was written, and shutdownRecordManager takes a last one.
+extern RC takeCheckpoint (void);
 
 // handling records in a table
 extern RC insertRecord (RM_TableData *rel, Record *record);
 extern RC deleteRecord (RM_TableData *rel, RID id);
 extern RC updateRecord (RM_TableData *rel, Record *record);
 extern RC getRecord (RM_TableData *rel, RID id, Record *record);
+// key holds one value per key attribute; fails with RC_IM_KEY_NOT_FOUND if no record has the key
+extern RC getRecordByKey (RM_TableData *rel, Value **key, Record *record);
 
-// scans
+// scans: a scan reads the table as of a snapshot taken by startScan, the changes of transactions that had committed
+// by then and the thread's own; changes made meanwhile neither block the scan nor are seen by it.
+// getRecord reads the latest committed version of a record, or the thread's own.
 extern RC startScan (RM_TableData *rel, RM_ScanHandle *scan, Expr *cond);
 extern RC next (RM_ScanHandle *scan, Record *record);
+// fill up to maxRecords records per call; records with NULL data only get their RID
+extern RC nextBatch (RM_ScanHandle *scan, Record *records, int maxRecords, int *numRecords);
 extern RC closeScan (RM_ScanHandle *scan);
 
 // dealing with schemas
@@ -43,5 +61,13 @@ extern RC createRecord (Record **record, Schema *schema);
 extern RC freeRecord (Record *record);
 extern RC getAttr (Record *record, Schema *schema, int attrNum, Value **value);
 extern RC setAttr (Record *record, Schema *schema, int attrNum, Value *value);
+extern int getAttributeOffset (Schema *schema, int attrNum);
+
+// dealing with keys; a key is the concatenation of the key attributes of a record
+extern int getKeySize (Schema *schema);
+extern void getRecordKey (Schema *schema, char *data, char *key);
+extern RC valuesToKey (Schema *schema, Value **values, char *key);
+extern int compareKeys (Schema *schema, char *left, char *right);
+extern unsigned int hashKey (Schema *schema, char *key);
 
 #endif // RECORD_MGR_H
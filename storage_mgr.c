@@ -1,11 +1,135 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
 #include "storage_mgr.h"
 // #include "helper.c"
 
+// Use io_uring for batched transfers where the kernel headers provide it
+#if !defined(SM_NO_IO_URING) && defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define SM_IO_URING
+#endif
+#endif
+
+#define SM_RING_ENTRIES 64 // size of the submission queue of a file's io_uring, the most transfers in flight
+#define SM_IO_PENDING -1   // rc of a request that has not completed yet
+
 SM_FileHandle *fileHandle;
 
+#ifdef SM_IO_URING
+// io_uring of a page file, set up with raw system calls
+typedef struct SM_Ring
+{
+    int fd;
+    unsigned numEntries;
+    unsigned *sqTail;
+    unsigned *sqMask;
+    unsigned *sqArray;
+    struct io_uring_sqe *sqes;
+    unsigned *cqHead;
+    unsigned *cqTail;
+    unsigned *cqMask;
+    struct io_uring_cqe *cqes;
+    void *sqMap; // mappings of the submission queue, the completion queue, and the submission entries
+    void *cqMap;
+    size_t sqMapSize;
+    size_t cqMapSize;
+    size_t sqesSize;
+} SM_Ring;
+#endif
+
+// Open file state kept in SM_FileHandle.mgmtInfo for the lifetime of the handle
+typedef struct SM_FileInfo
+{
+    int fd;                  // descriptor used for all positional reads and writes
+    pthread_mutex_t ioLatch; // serializes transferBlocks and registerBlockBuffers
+    int ringState;           // 0 until the first batched transfer, then 1 with an io_uring, -1 without
+    char *buffers;           // memory registered as fixed buffers, NULL if none
+    size_t buffersSize;
+#ifdef SM_IO_URING
+    SM_Ring ring;
+#endif
+} SM_FileInfo;
+
+#define FILE_DESCRIPTOR(fHandle) (((SM_FileInfo *)(fHandle)->mgmtInfo)->fd)
+
+// Write one zero filled page at the given page number
+static RC writeEmptyPage(int fd, int pageNum)
+{
+    static const char emptyPage[PAGE_SIZE];
+
+    if (pwrite(fd, emptyPage, PAGE_SIZE, (off_t)pageNum * PAGE_SIZE) != PAGE_SIZE)
+    {
+        return RC_WRITE_FAILED;
+    }
+    return RC_OK;
+}
+
+#ifdef SM_IO_URING
+static void teardownRing(SM_Ring *ring)
+{
+    if (ring->sqes != MAP_FAILED)
+    {
+        munmap(ring->sqes, ring->sqesSize);
+    }
+    if (ring->cqMap != MAP_FAILED)
+    {
+        munmap(ring->cqMap, ring->cqMapSize);
+    }
+    if (ring->sqMap != MAP_FAILED)
+    {
+        munmap(ring->sqMap, ring->sqMapSize);
+    }
+    close(ring->fd);
+}
+
+// Create an io_uring and map its queues, RC_ERROR if the kernel does not offer io_uring
+static RC setupRing(SM_Ring *ring)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    ring->fd = (int)syscall(__NR_io_uring_setup, SM_RING_ENTRIES, &params);
+    if (ring->fd < 0)
+    {
+        return RC_ERROR;
+    }
+
+    ring->sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqMap = mmap(NULL, ring->sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    ring->cqMap = mmap(NULL, ring->cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    ring->sqes = (struct io_uring_sqe *)mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqMap == MAP_FAILED || ring->cqMap == MAP_FAILED || ring->sqes == MAP_FAILED)
+    {
+        teardownRing(ring);
+        return RC_ERROR;
+    }
+
+    ring->numEntries = params.sq_entries;
+    ring->sqTail = (unsigned *)((char *)ring->sqMap + params.sq_off.tail);
+    ring->sqMask = (unsigned *)((char *)ring->sqMap + params.sq_off.ring_mask);
+    ring->sqArray = (unsigned *)((char *)ring->sqMap + params.sq_off.array);
+    ring->cqHead = (unsigned *)((char *)ring->cqMap + params.cq_off.head);
+    ring->cqTail = (unsigned *)((char *)ring->cqMap + params.cq_off.tail);
+    ring->cqMask = (unsigned *)((char *)ring->cqMap + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)((char *)ring->cqMap + params.cq_off.cqes);
+
+    return RC_OK;
+}
+#endif
+
 /* manipulating page files */
 void initStorageManager(void)
 {
@@ -15,42 +139,22 @@ void initStorageManager(void)
 
 RC createPageFile(char *fileName)
 {
-    // Create a file pointer and open the file in write in binary mode
-    FILE *file = fopen(fileName, "wb");
-    // If the file is non existent, return RC_FILE_NOT_FOUND
-    if (file == NULL)
+    // Create the file, or truncate it if it already exists
+    int fd = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    // If the file cannot be created, return RC_FILE_NOT_FOUND
+    if (fd < 0)
     {
         return RC_FILE_NOT_FOUND;
     }
 
-    // Create a new page of size PAGE_SIZE
-    char *emptyPage = malloc(PAGE_SIZE * sizeof(char));
-    // If the page is not created, return RC_WRITE_FAILED
-    if (emptyPage == NULL)
-    {
-        // Defensive Check: Close the file to avoid memory leaks
-        fclose(file);
-        return RC_WRITE_FAILED;
-    }
-    // Fill the page with 0's as it is a new page
-    memset(emptyPage, 0, PAGE_SIZE);
-    // Write the page to the file
-    size_t writeSize = fwrite(emptyPage, sizeof(char), PAGE_SIZE, file);
-    // If the write is not successful, return RC_WRITE_FAILED
-    if (writeSize < PAGE_SIZE)
-    {
-        // Defensive Check: Close the file and free the page to avoid memory leaks
-        fclose(file);
-        free(emptyPage);
-        return RC_WRITE_FAILED;
-    }
+    // Write a single page filled with 0's as it is a new file
+    RC rc = writeEmptyPage(fd, 0);
 
-    // Close the file and free the page to avoid memory leaks
-    fclose(file);
-    free(emptyPage);
+    // Close the file
+    close(fd);
 
     // Return RC_OK if the file is created successfully
-    return RC_OK;
+    return rc;
 }
 
 RC openPageFile(char *fileName, SM_FileHandle *fHandle)
@@ -60,22 +164,35 @@ RC openPageFile(char *fileName, SM_FileHandle *fHandle)
     {
         return RC_FILE_HANDLE_NOT_INIT;
     }
-    //  Open the file in read and write(+) in binary mode
-    fHandle->mgmtInfo = fopen(fileName, "rb+"); // Storing File pointer in mgmtInfo
+    // Open the file for reading and writing, the descriptor stays open until closePageFile
+    int fd = open(fileName, O_RDWR);
     // If the file is non existent, return RC_FILE_NOT_FOUND
-    if (fHandle->mgmtInfo == NULL)
+    if (fd < 0)
     {
         return RC_FILE_NOT_FOUND;
     }
 
-    // Assign the fileHandle attributes to the values of the file
-    fHandle->fileName = fileName;
+    // The total number of pages is the size of the file divided by the page size
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0)
+    {
+        close(fd);
+        return RC_FILE_NOT_FOUND;
+    }
 
-    fseek(fHandle->mgmtInfo, 0, SEEK_END); // Move the file pointer to the end of the file
-    long fileSize = ftell(fHandle->mgmtInfo);
+    // Store the descriptor in mgmtInfo
+    SM_FileInfo *fileInfo = (SM_FileInfo *)malloc(sizeof(SM_FileInfo));
+    fileInfo->fd = fd;
+    pthread_mutex_init(&fileInfo->ioLatch, NULL);
+    fileInfo->ringState = 0; // the io_uring is only set up by the first batched transfer
+    fileInfo->buffers = NULL;
+    fileInfo->buffersSize = 0;
 
-    fHandle->totalNumPages = fileSize / PAGE_SIZE; // The total number of pages is the size of the file divided by the page size
-    fHandle->curPagePos = 0;                       // The current page position is set to the beginning of the file
+    // Assign the fileHandle attributes to the values of the file
+    fHandle->fileName = fileName;
+    fHandle->totalNumPages = fileStat.st_size / PAGE_SIZE;
+    fHandle->curPagePos = 0; // The current page position is set to the beginning of the file
+    fHandle->mgmtInfo = fileInfo;
 
     // Return RC_OK if the file is opened successfully
     return RC_OK;
@@ -83,13 +200,24 @@ RC openPageFile(char *fileName, SM_FileHandle *fHandle)
 
 RC closePageFile(SM_FileHandle *fHandle)
 {
-    // If the fileHandle or its fileName is not initialized, return RC_FILE_HANDLE_NOT_INIT
-    if (fHandle == NULL || fHandle->fileName == NULL)
+    // If the fileHandle or its file is not initialized, return RC_FILE_HANDLE_NOT_INIT
+    if (fHandle == NULL || fHandle->fileName == NULL || fHandle->mgmtInfo == NULL)
     {
         return RC_FILE_HANDLE_NOT_INIT;
     }
 
-    fclose(fHandle->mgmtInfo); // Close the fileHandle
+    // Close the descriptor and release the file info
+    SM_FileInfo *fileInfo = (SM_FileInfo *)fHandle->mgmtInfo;
+#ifdef SM_IO_URING
+    if (fileInfo->ringState == 1)
+    {
+        teardownRing(&fileInfo->ring);
+    }
+#endif
+    pthread_mutex_destroy(&fileInfo->ioLatch);
+    close(FILE_DESCRIPTOR(fHandle));
+    free(fHandle->mgmtInfo);
+    fHandle->mgmtInfo = NULL;
 
     // Return RC_OK if the file is closed successfully
     return RC_OK;
@@ -112,16 +240,22 @@ RC destroyPageFile(char *fileName)
 /* reading blocks from disc */
 RC readBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
 {
-    FILE *fp = fopen(fHandle->fileName, "r+");
-    size_t status = fseek(fp, pageNum * PAGE_SIZE, SEEK_SET);
-    if (status != 0)
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
+    {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    // Only pages inside the file can be read
+    if (pageNum < 0 || pageNum >= fHandle->totalNumPages)
+    {
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+
+    // Read the page at its absolute position
+    if (pread(FILE_DESCRIPTOR(fHandle), memPage, PAGE_SIZE, (off_t)pageNum * PAGE_SIZE) != PAGE_SIZE)
     {
-        // return read error
         return RC_READ_NON_EXISTING_PAGE;
     }
-    fread(memPage, sizeof(char), PAGE_SIZE, fp);
-    fHandle->curPagePos = ftell(fp);
-    fclose(fp);
+    fHandle->curPagePos = pageNum;
     return RC_OK;
 }
 
@@ -158,79 +292,273 @@ RC readLastBlock(SM_FileHandle *fHandle, SM_PageHandle memPage)
 // Write page to a disk using absolute position
 RC writeBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
 {
-    FILE *file = fopen(fHandle->fileName, "r+");
-    RC rc;
-    if (file == NULL)
-        rc = RC_FILE_NOT_FOUND;
-    if (fHandle == NULL)
-        rc = RC_FILE_HANDLE_NOT_INIT;
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
+    {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    // A page can be overwritten or appended directly behind the last page
     if (pageNum > fHandle->totalNumPages || pageNum < 0)
-        rc = RC_WRITE_FAILED;
-    if (fseek(file, (pageNum)*PAGE_SIZE, SEEK_SET) == 0)
     {
-        fwrite(memPage, 1, PAGE_SIZE, file);
-        fHandle->curPagePos = pageNum;
-        rc = RC_OK;
+        return RC_WRITE_FAILED;
     }
-    else if (fseek(file, (pageNum)*PAGE_SIZE, SEEK_SET) != 0)
-        rc = RC_WRITE_FAILED;
 
-    fclose(file);
-    return rc;
+    // Write the page at its absolute position
+    if (pwrite(FILE_DESCRIPTOR(fHandle), memPage, PAGE_SIZE, (off_t)pageNum * PAGE_SIZE) != PAGE_SIZE)
+    {
+        return RC_WRITE_FAILED;
+    }
+    if (pageNum == fHandle->totalNumPages)
+    {
+        fHandle->totalNumPages++;
+    }
+    fHandle->curPagePos = pageNum;
+    return RC_OK;
 }
 
 // Write page to a disk using current position
 RC writeCurrentBlock(SM_FileHandle *fHandle, SM_PageHandle memPage)
 {
-    RC rc, cp;
     if (fHandle == NULL)
-        rc = RC_FILE_HANDLE_NOT_INIT;
-
-    else
-        cp = getBlockPos(fHandle);
-    rc = writeBlock(cp, fHandle, memPage);
+    {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
 
-    return rc;
+    return writeBlock(getBlockPos(fHandle), fHandle, memPage);
 }
 
 // Increase number of pages in file by one
 RC appendEmptyBlock(SM_FileHandle *fHandle)
 {
-    if (fHandle == NULL)
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
     {
         return RC_FILE_HANDLE_NOT_INIT;
     }
 
-    else
+    // Write an empty page behind the last page
+    RC rc = writeEmptyPage(FILE_DESCRIPTOR(fHandle), fHandle->totalNumPages);
+    if (rc == RC_OK)
     {
-        FILE *file = fopen(fHandle->fileName, "r+");
-        fseek(file, 0, SEEK_END);
         fHandle->totalNumPages = fHandle->totalNumPages + 1;
-        char *c = (char *)calloc(PAGE_SIZE, sizeof(char));
-        fwrite(c, sizeof(char), PAGE_SIZE, file);
-        fclose(file);
-        return RC_OK;
     }
+    return rc;
 }
 
 // Ensuring file has appropriate number of pages
 RC ensureCapacity(int numberOfPages, SM_FileHandle *fHandle)
 {
-    RC retcod; // CREATES RETCOD OF TYPE RETURN CODE(RC)
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
+    {
+        return RC_FILE_HANDLE_NOT_INIT; // RC_FILE_HANDLE_NOT_INIT IF THE RETURN CODE IF FILE HANDLE IS NOT INITIALIZED
+    }
 
-    if (fHandle != NULL) // CHECKS IF FILEHANDLE IS INITITALIZED OR NOT
+    if (numberOfPages > fHandle->totalNumPages) // CHECKS IF NUMBER OF PAGES IS GREATER THAN FILE'S PAGES
     {
-        if (numberOfPages > fHandle->totalNumPages) // CHECKS IF NUMBER OF PAGES IS GREATER THAN FILE'S PAGES
+        // GROW THE FILE IN ONE STEP, THE NEW PAGES READ AS ZEROS
+        if (ftruncate(FILE_DESCRIPTOR(fHandle), (off_t)numberOfPages * PAGE_SIZE) != 0)
         {
-            while ((numberOfPages - (fHandle->totalNumPages)) > 0) // USES WHILE LOOP TO APPEND CORRECT NUMBER OF TIMES
-                appendEmptyBlock(fHandle);                         // APPEND EMPTY BLOCKS/NEW PAGES UNTIL THE DIFFERENCE IS NULLIFIED
+            return RC_WRITE_FAILED;
         }
-        retcod = RC_OK; // RC_OK IS THE RETURN CODE FOR SUCCESSFUL METHOD CALL
+        fHandle->totalNumPages = numberOfPages;
+    }
+
+    return RC_OK; // RC_OK IS THE RETURN CODE FOR SUCCESSFUL METHOD CALL
+}
+
+// Flush the written pages, and the size of a grown file, to the disk
+RC forceBlocks(SM_FileHandle *fHandle)
+{
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
+    {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    if (fdatasync(FILE_DESCRIPTOR(fHandle)) != 0)
+    {
+        return RC_WRITE_FAILED;
+    }
+    return RC_OK;
+}
+
+/* batched block I/O */
+
+// Complete a request with the number of bytes its transfer moved, or a negative error
+static void completeRequest(SM_IORequest *request, long transferred)
+{
+    if (transferred == PAGE_SIZE)
+    {
+        request->rc = RC_OK;
     }
     else
     {
-        retcod = RC_FILE_HANDLE_NOT_INIT; // RC_FILE_HANDLE_NOT_INIT IF THE RETURN CODE IF FILE HANDLE IS NOT INITIALIZED
+        request->rc = request->isWrite ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
     }
+    if (request->callback != NULL)
+    {
+        request->callback(request);
+    }
+}
+
+// Do the pending transfers one after the other
+static RC transferBlocksSync(SM_FileInfo *fileInfo, SM_IORequest *requests, int numRequests)
+{
+    for (int i = 0; i < numRequests; i++)
+    {
+        SM_IORequest *request = &requests[i];
+        if (request->rc != SM_IO_PENDING)
+        {
+            continue;
+        }
+
+        off_t offset = (off_t)request->pageNum * PAGE_SIZE;
+        long transferred = request->isWrite ? pwrite(fileInfo->fd, request->memPage, PAGE_SIZE, offset)
+                                            : pread(fileInfo->fd, request->memPage, PAGE_SIZE, offset);
+        completeRequest(request, transferred);
+    }
+    return RC_OK;
+}
+
+#ifdef SM_IO_URING
+// Keep up to a ring's worth of transfers in flight, submitting new ones as earlier ones complete.
+// RC_ERROR if the ring fails, the transfers that did not complete are then still pending.
+static RC transferBlocksRing(SM_FileInfo *fileInfo, SM_IORequest *requests, int numRequests)
+{
+    SM_Ring *ring = &fileInfo->ring;
+    int numQueued = 0, numCompleted = 0;
+    unsigned numUnsubmitted = 0, numInFlight = 0;
+
+    while (numCompleted < numRequests)
+    {
+        // Fill the submission queue
+        unsigned tail = *ring->sqTail;
+        while (numQueued < numRequests && numInFlight < ring->numEntries)
+        {
+            SM_IORequest *request = &requests[numQueued++];
+            struct io_uring_sqe *sqe = &ring->sqes[tail & *ring->sqMask];
+            int fixed = fileInfo->buffers != NULL && request->memPage >= fileInfo->buffers &&
+                         request->memPage + PAGE_SIZE <= fileInfo->buffers + fileInfo->buffersSize;
+
+            memset(sqe, 0, sizeof(*sqe));
+            if (request->isWrite)
+            {
+                sqe->opcode = fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+            }
+            else
+            {
+                sqe->opcode = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+            }
+            sqe->fd = fileInfo->fd;
+            sqe->off = (uint64_t)request->pageNum * PAGE_SIZE;
+            sqe->addr = (uint64_t)(uintptr_t)request->memPage;
+            sqe->len = PAGE_SIZE;
+            sqe->buf_index = 0; // the registered area is the only fixed buffer
+            sqe->user_data = (uint64_t)(uintptr_t)request;
+            ring->sqArray[tail & *ring->sqMask] = tail & *ring->sqMask;
+            tail++;
+            numUnsubmitted++;
+            numInFlight++;
+        }
+        __atomic_store_n(ring->sqTail, tail, __ATOMIC_RELEASE);
+
+        // Submit the new transfers and wait for at least one completion
+        int submitted = (int)syscall(__NR_io_uring_enter, ring->fd, numUnsubmitted, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (submitted < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        {
+            return RC_ERROR;
+        }
+        if (submitted > 0)
+        {
+            numUnsubmitted -= submitted;
+        }
 
-    return retcod; // RETURNS RETURN CODE
+        // Complete the finished transfers
+        unsigned head = *ring->cqHead;
+        while (head != __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE))
+        {
+            struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cqMask];
+            SM_IORequest *request = (SM_IORequest *)(uintptr_t)cqe->user_data;
+            long transferred = cqe->res;
+            head++;
+            __atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+
+            completeRequest(request, transferred);
+            numCompleted++;
+            numInFlight--;
+        }
+    }
+
+    return RC_OK;
+}
+#endif
+
+RC transferBlocks(SM_FileHandle *fHandle, SM_IORequest *requests, int numRequests)
+{
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
+    {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    SM_FileInfo *fileInfo = (SM_FileInfo *)fHandle->mgmtInfo;
+    for (int i = 0; i < numRequests; i++)
+    {
+        requests[i].rc = SM_IO_PENDING;
+    }
+
+    pthread_mutex_lock(&fileInfo->ioLatch);
+#ifdef SM_IO_URING
+    if (fileInfo->ringState == 0)
+    {
+        fileInfo->ringState = (setupRing(&fileInfo->ring) == RC_OK) ? 1 : -1;
+    }
+    // A failing ring is given up, closing it cancels or finishes its transfers; the pending ones are redone
+    if (fileInfo->ringState == 1 && transferBlocksRing(fileInfo, requests, numRequests) != RC_OK)
+    {
+        teardownRing(&fileInfo->ring);
+        fileInfo->ringState = -1;
+        fileInfo->buffers = NULL;
+    }
+#endif
+    RC rc = transferBlocksSync(fileInfo, requests, numRequests);
+    pthread_mutex_unlock(&fileInfo->ioLatch);
+
+    return rc;
+}
+
+RC registerBlockBuffers(SM_FileHandle *fHandle, char *memory, size_t size)
+{
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
+    {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    SM_FileInfo *fileInfo = (SM_FileInfo *)fHandle->mgmtInfo;
+    RC rc = RC_ERROR;
+
+    pthread_mutex_lock(&fileInfo->ioLatch);
+#ifdef SM_IO_URING
+    if (fileInfo->ringState == 0)
+    {
+        fileInfo->ringState = (setupRing(&fileInfo->ring) == RC_OK) ? 1 : -1;
+    }
+    if (fileInfo->ringState == 1)
+    {
+        // Replace an area registered before
+        if (fileInfo->buffers != NULL)
+        {
+            syscall(__NR_io_uring_register, fileInfo->ring.fd, IORING_UNREGISTER_BUFFERS, NULL, 0);
+            fileInfo->buffers = NULL;
+        }
+
+        struct iovec area = {memory, size};
+        if (syscall(__NR_io_uring_register, fileInfo->ring.fd, IORING_REGISTER_BUFFERS, &area, 1) == 0)
+        {
+            fileInfo->buffers = memory;
+            fileInfo->buffersSize = size;
+            rc = RC_OK;
+        }
+    }
+#endif
+    pthread_mutex_unlock(&fileInfo->ioLatch);
+
+    // Without fixed buffers the transfers still work, using the memory directly
+    return rc;
 }
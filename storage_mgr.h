@@ -1,6 +1,7 @@
 #ifndef STORAGE_MGR_H
 #define STORAGE_MGR_H
 
+#include <stddef.h>
 #include "dberror.h"
 
 /************************************************************
@@ -16,6 +17,18 @@ typedef struct SM_FileHandle
 
 typedef char *SM_PageHandle;
 
+// A read or write of one page by transferBlocks. When the transfer completes, rc is set and
+// callback, if not NULL, is called with the request.
+typedef struct SM_IORequest
+{
+	int pageNum;
+	SM_PageHandle memPage;
+	int isWrite;
+	RC rc;
+	void (*callback) (struct SM_IORequest *request);
+	void *context;
+} SM_IORequest;
+
 /************************************************************
  *                    interface                             *
  ************************************************************/
@@ -40,5 +53,16 @@ extern RC writeBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
 extern RC writeCurrentBlock(SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC appendEmptyBlock(SM_FileHandle *fHandle);
 extern RC ensureCapacity(int numberOfPages, SM_FileHandle *fHandle);
+// Make the blocks written so far durable
+extern RC forceBlocks(SM_FileHandle *fHandle);
+
+/* batched block I/O */
+// Transfers are submitted to an io_uring of the file, many at once, and complete in any order;
+// without io_uring (or compiled with -DSM_NO_IO_URING) they are done one after the other.
+// The pages must lie inside the file, transfers do not grow it. transferBlocks returns once
+// all requests completed, callbacks run in the calling thread as the transfers complete.
+extern RC transferBlocks(SM_FileHandle *fHandle, SM_IORequest *requests, int numRequests);
+// Transfers from and to pages inside a registered memory area use the area as fixed buffers
+extern RC registerBlockBuffers(SM_FileHandle *fHandle, char *memory, size_t size);
 
 #endif
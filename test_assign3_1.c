@@ -1,8 +1,13 @@
 #include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/wait.h>
 #include "dberror.h"
 #include "expr.h"
 #include "record_mgr.h"
 #include "tables.h"
+#include "storage_mgr.h"
+#include "log_mgr.h"
 #include "test_helper.h"
 
 extern void printRecordContent(Record *record, Schema *schema)
@@ -73,6 +78,23 @@ static void testScans (void);
 static void testScansTwo (void);
 static void testInsertManyRecords(void);
 static void testMultipleScans(void);
+static void testBatchScans(void);
+static void testPrimaryKey(void);
+static void testIndexScans(void);
+static int scanKeys(RM_TableData *table, Expr *sel, bool *ordered);
+static void testConcurrentAccess(void);
+static void testWriteAheadLog(void);
+static void testCrashRecovery(void);
+static void testCatalog(void);
+static void testSnapshotScans(void);
+static LSN countLogRecords(int *counts);
+static void recoverAndCrash(void);
+static void *loserWorker(void *arg);
+static void *insertWorker(void *arg);
+static void *scanWorker(void *arg);
+static void *generationWorker(void *arg);
+static void *snapshotWorker(void *arg);
+static void *openTransactionWorker(void *arg);
 
 // struct for test records
 typedef struct TestRecord {
@@ -102,6 +124,14 @@ main (void)
 	testScans();
 	testScansTwo();
 	testMultipleScans();
+	testBatchScans();
+	testPrimaryKey();
+	testIndexScans();
+	testConcurrentAccess();
+	testWriteAheadLog();
+	testCrashRecovery();
+	testCatalog();
+	testSnapshotScans();
 
 	return 0;
 }
@@ -277,6 +307,105 @@ testMultipleScans(void)
 	TEST_DONE();
 }
 
+void
+testBatchScans(void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	TestRecord inserts[] = {
+			{1, "aaaa", 3},
+			{2, "bbbb", 2},
+			{3, "cccc", 1},
+			{4, "dddd", 3},
+			{5, "eeee", 5},
+			{6, "ffff", 1},
+			{7, "gggg", 3},
+			{8, "hhhh", 3},
+			{9, "iiii", 2},
+			{10, "jjjj", 5},
+	};
+	int numInserts = 10000, batchSize = 64, i, n, numBatched = 0, numSingle = 0;
+	Record *r;
+	Record batch[64];
+	RID lastRid = { -1, -1 };
+	bool ordered = TRUE;
+	Schema *schema;
+	RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+	Expr *sel, *left, *right;
+	Value *c;
+	int rc;
+
+	testName = "test batch scans over 10000 records";
+	schema = testSchema();
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_b",schema));
+	TEST_CHECK(openTable(table, "test_table_b"));
+
+	// keys are unique, the other attributes repeat every ten records
+	for(i = 0; i < numInserts; i++)
+	{
+		TestRecord t = inserts[i % 10];
+		t.a = i;
+		r = fromTestRecord(schema, t);
+		TEST_CHECK(insertRecord(table,r));
+		freeRecord(r);
+	}
+	for(i = 0; i < batchSize; i++)
+	{
+		createRecord(&r, schema);
+		batch[i] = *r;
+		free(r);
+	}
+	createRecord(&r, schema);
+
+	// c = 3 holds for four out of ten records
+	MAKE_CONS(left, stringToValue("i3"));
+	MAKE_ATTRREF(right, 2);
+	MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+
+	TEST_CHECK(startScan(table, sc, sel));
+	while((rc = nextBatch(sc, batch, batchSize, &n)) == RC_OK)
+	{
+		ASSERT_TRUE(n > 0 && n <= batchSize, "batch is not empty and fits");
+		for(i = 0; i < n; i++)
+		{
+			if (batch[i].id.page < lastRid.page || (batch[i].id.page == lastRid.page && batch[i].id.slot <= lastRid.slot))
+				ordered = FALSE;
+			lastRid = batch[i].id;
+			TEST_CHECK(getRecord(table, batch[i].id, r));
+			ASSERT_TRUE(memcmp(r->data, batch[i].data, getRecordSize(schema)) == 0, "batch record is the stored record");
+			getAttr(&batch[i], schema, 2, &c);
+			ASSERT_EQUALS_INT(3, c->v.intV, "batch record satisfies c = 3");
+			freeVal(c);
+		}
+		numBatched += n;
+	}
+	if (rc != RC_RM_NO_MORE_TUPLES)
+		TEST_CHECK(rc);
+	TEST_CHECK(closeScan(sc));
+	ASSERT_TRUE(ordered, "batches return records in RID order");
+
+	TEST_CHECK(startScan(table, sc, sel));
+	while((rc = next(sc, r)) == RC_OK)
+		numSingle++;
+	TEST_CHECK(closeScan(sc));
+
+	ASSERT_EQUALS_INT(4000, numBatched, "batch scan returns all matching records");
+	ASSERT_EQUALS_INT(numSingle, numBatched, "batch scan and single record scan agree");
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_b"));
+	TEST_CHECK(shutdownRecordManager());
+
+	for(i = 0; i < batchSize; i++)
+		free(batch[i].data);
+	freeRecord(r);
+	freeExpr(sel);
+	free(table);
+	free(sc);
+	TEST_DONE();
+}
+
 void 
 testUpdateTable (void)
 {
@@ -634,6 +763,1146 @@ void testScansTwo (void)
 }
 
 
+// ************************************************************ 
+void
+testPrimaryKey(void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	TestRecord inserts[] = {
+			{1, "aaaa", 3},
+			{2, "bbbb", 2},
+			{3, "cccc", 1},
+	};
+	int numInserts = 1000, i;
+	Record *r;
+	RID *rids;
+	Schema *schema;
+	Value *key[1];
+	testName = "test primary key uniqueness and lookups by key";
+	schema = testSchema();
+	rids = (RID *) malloc(sizeof(RID) * numInserts);
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_k",schema));
+	TEST_CHECK(openTable(table, "test_table_k"));
+
+	for(i = 0; i < numInserts; i++)
+	{
+		TestRecord t = inserts[i % 3];
+		t.a = i * 7;
+		r = fromTestRecord(schema, t);
+		TEST_CHECK(insertRecord(table,r));
+		rids[i] = r->id;
+		freeRecord(r);
+	}
+
+	// a second record with a taken key is rejected
+	r = fromTestRecord(schema, inserts[1]);
+	setAttr(r, schema, 0, stringToValue("i14"));
+	ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, insertRecord(table, r), "duplicate key is rejected");
+	ASSERT_EQUALS_INT(numInserts, getNumTuples(table), "rejected record is not stored");
+
+	// every record is found by its key
+	for(i = 0; i < numInserts; i++)
+	{
+		MAKE_VALUE(key[0], DT_INT, i * 7);
+		TEST_CHECK(getRecordByKey(table, key, r));
+		freeVal(key[0]);
+		if (r->id.page != rids[i].page || r->id.slot != rids[i].slot)
+			break;
+	}
+	ASSERT_EQUALS_INT(numInserts, i, "records are found by key");
+	MAKE_VALUE(key[0], DT_INT, 1);
+	ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, getRecordByKey(table, key, r), "missing key is not found");
+	freeVal(key[0]);
+
+	// updates may not take a key, but may move a record to a free one
+	MAKE_VALUE(key[0], DT_INT, 14);
+	TEST_CHECK(getRecordByKey(table, key, r));
+	freeVal(key[0]);
+	setAttr(r, schema, 0, stringToValue("i21"));
+	ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, updateRecord(table, r), "update to a taken key is rejected");
+	setAttr(r, schema, 0, stringToValue("i15"));
+	TEST_CHECK(updateRecord(table, r));
+	MAKE_VALUE(key[0], DT_INT, 15);
+	TEST_CHECK(getRecordByKey(table, key, r));
+	ASSERT_EQUALS_INT(rids[2].slot, r->id.slot, "record is found by its new key");
+	freeVal(key[0]);
+	MAKE_VALUE(key[0], DT_INT, 14);
+	ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, getRecordByKey(table, key, r), "old key is gone");
+
+	// a deleted key can be inserted again
+	MAKE_VALUE(key[0], DT_INT, 21);
+	TEST_CHECK(getRecordByKey(table, key, r));
+	freeVal(key[0]);
+	TEST_CHECK(deleteRecord(table, r->id));
+	TEST_CHECK(insertRecord(table, r));
+	ASSERT_EQUALS_INT(numInserts, getNumTuples(table), "deleted key is inserted again");
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_k"));
+	TEST_CHECK(shutdownRecordManager());
+
+	freeRecord(r);
+	free(rids);
+	free(table);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testIndexScans(void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	int numInserts = 3000, i, n, expected;
+	Record *r;
+	Schema *schema;
+	Expr *sel, *left, *right, *first, *second, *range;
+	bool ordered;
+	testName = "test scans driven by the key index";
+	schema = testSchema();
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_i",schema));
+	TEST_CHECK(openTable(table, "test_table_i"));
+
+	// insert the keys in descending order, so only the index returns them in ascending order
+	for(i = numInserts - 1; i >= 0; i--)
+	{
+		r = testRecord(schema, i, "aaaa", i % 5);
+		TEST_CHECK(insertRecord(table,r));
+		freeRecord(r);
+	}
+
+	// a = 1234
+	MAKE_CONS(left, stringToValue("i1234"));
+	MAKE_ATTRREF(right, 0);
+	MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+	n = scanKeys(table, sel, &ordered);
+	ASSERT_EQUALS_INT(1, n, "equality on the key");
+	freeExpr(sel);
+
+	// a < 100
+	MAKE_ATTRREF(left, 0);
+	MAKE_CONS(right, stringToValue("i100"));
+	MAKE_BINOP_EXPR(sel, left, right, OP_COMP_SMALLER);
+	n = scanKeys(table, sel, &ordered);
+	ASSERT_EQUALS_INT(100, n, "upper bound on the key");
+	ASSERT_TRUE(ordered, "range is scanned in key order");
+	freeExpr(sel);
+
+	// 500 < a AND a < 600 AND c = 3, the comparison on c is checked on the fetched tuples
+	MAKE_CONS(left, stringToValue("i500"));
+	MAKE_ATTRREF(right, 0);
+	MAKE_BINOP_EXPR(first, left, right, OP_COMP_SMALLER);
+	MAKE_ATTRREF(left, 0);
+	MAKE_CONS(right, stringToValue("i600"));
+	MAKE_BINOP_EXPR(second, left, right, OP_COMP_SMALLER);
+	MAKE_BINOP_EXPR(range, first, second, OP_BOOL_AND);
+	MAKE_ATTRREF(left, 2);
+	MAKE_CONS(right, stringToValue("i3"));
+	MAKE_BINOP_EXPR(second, left, right, OP_COMP_EQUAL);
+	MAKE_BINOP_EXPR(sel, range, second, OP_BOOL_AND);
+	for(i = 501, expected = 0; i < 600; i++)
+		expected += (i % 5 == 3);
+	n = scanKeys(table, sel, &ordered);
+	ASSERT_EQUALS_INT(expected, n, "range on the key with a residual condition");
+	ASSERT_TRUE(ordered, "range with residual is scanned in key order");
+	freeExpr(sel);
+
+	// NOT (a < 2990)
+	MAKE_ATTRREF(left, 0);
+	MAKE_CONS(right, stringToValue("i2990"));
+	MAKE_BINOP_EXPR(first, left, right, OP_COMP_SMALLER);
+	MAKE_UNOP_EXPR(sel, first, OP_BOOL_NOT);
+	n = scanKeys(table, sel, &ordered);
+	ASSERT_EQUALS_INT(10, n, "negated bound on the key");
+	ASSERT_TRUE(ordered, "negated bound is scanned in key order");
+	freeExpr(sel);
+
+	// a = 1234 AND a < 10 has no matches
+	MAKE_CONS(left, stringToValue("i1234"));
+	MAKE_ATTRREF(right, 0);
+	MAKE_BINOP_EXPR(first, left, right, OP_COMP_EQUAL);
+	MAKE_ATTRREF(left, 0);
+	MAKE_CONS(right, stringToValue("i10"));
+	MAKE_BINOP_EXPR(second, left, right, OP_COMP_SMALLER);
+	MAKE_BINOP_EXPR(sel, first, second, OP_BOOL_AND);
+	n = scanKeys(table, sel, &ordered);
+	ASSERT_EQUALS_INT(0, n, "empty key range");
+	freeExpr(sel);
+
+	// c = 3 does not bound the key and scans the table in storage order
+	MAKE_ATTRREF(left, 2);
+	MAKE_CONS(right, stringToValue("i3"));
+	MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+	n = scanKeys(table, sel, &ordered);
+	ASSERT_EQUALS_INT(numInserts / 5, n, "condition without key bounds");
+	ASSERT_TRUE(!ordered, "table scan is in storage order");
+	freeExpr(sel);
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_i"));
+	TEST_CHECK(shutdownRecordManager());
+
+	free(table);
+	TEST_DONE();
+}
+
+// Count the tuples of a scan, and check whether their keys are ascending
+int
+scanKeys(RM_TableData *table, Expr *sel, bool *ordered)
+{
+	RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+	Record *r;
+	Value *v;
+	int n = 0, last = -1, rc;
+
+	*ordered = TRUE;
+	createRecord(&r, table->schema);
+	TEST_CHECK(startScan(table, sc, sel));
+	while((rc = next(sc, r)) == RC_OK)
+	{
+		getAttr(r, table->schema, 0, &v);
+		*ordered = *ordered && v->v.intV > last;
+		last = v->v.intV;
+		freeVal(v);
+		n++;
+	}
+	if (rc != RC_RM_NO_MORE_TUPLES)
+		TEST_CHECK(rc);
+	TEST_CHECK(closeScan(sc));
+
+	freeRecord(r);
+	free(sc);
+	return n;
+}
+
+// ************************************************************
+// arguments and results of the worker threads of testConcurrentAccess
+typedef struct Worker {
+	char *tableName;
+	Schema *schema;
+	int first;          // inserters: first key to insert
+	int num;            // inserters: number of keys to insert
+	int *done;          // scanners: set once all inserters finished
+	int errors;         // failed calls and inconsistent tuples seen
+	int numScans;
+} Worker;
+
+void
+testConcurrentAccess(void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	char *names[] = { "test_table_c0", "test_table_c1" };
+	int numInserters = 4, numScanners = 2, numPerInserter = 2000, i, t, errors = 0;
+	pthread_t threads[6];
+	Worker workers[6];
+	int done = 0;
+	Schema *schema;
+	Record *r;
+	Value *key[1];
+	testName = "test concurrent inserts and scans on two tables";
+	schema = testSchema();
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable(names[0],schema));
+	TEST_CHECK(createTable(names[1],schema));
+
+	// two inserters per table with disjoint keys, and one scanner per table checking every tuple it reads
+	for(t = 0; t < numInserters + numScanners; t++)
+	{
+		workers[t].tableName = names[t % 2];
+		workers[t].schema = schema;
+		workers[t].first = t * numPerInserter;
+		workers[t].num = numPerInserter;
+		workers[t].done = &done;
+		workers[t].errors = 0;
+		workers[t].numScans = 0;
+	}
+	for(t = 0; t < numInserters; t++)
+		pthread_create(&threads[t], NULL, insertWorker, &workers[t]);
+	for(t = numInserters; t < numInserters + numScanners; t++)
+		pthread_create(&threads[t], NULL, scanWorker, &workers[t]);
+	for(t = 0; t < numInserters; t++)
+		pthread_join(threads[t], NULL);
+	__atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+	for(t = numInserters; t < numInserters + numScanners; t++)
+		pthread_join(threads[t], NULL);
+
+	for(t = 0; t < numInserters + numScanners; t++)
+		errors += workers[t].errors;
+	ASSERT_EQUALS_INT(0, errors, "no failed calls or torn tuples in the threads");
+
+	// every inserted record is in its table and found by its key
+	for(i = 0; i < 2; i++)
+	{
+		TEST_CHECK(openTable(table, names[i]));
+		ASSERT_EQUALS_INT(numInserters / 2 * numPerInserter, getNumTuples(table), "all records of a table are inserted");
+		createRecord(&r, schema);
+		for(t = i; t < numInserters; t += 2)
+		{
+			int k;
+			for(k = workers[t].first; k < workers[t].first + numPerInserter; k++)
+			{
+				MAKE_VALUE(key[0], DT_INT, k);
+				if (getRecordByKey(table, key, r) != RC_OK)
+					errors++;
+				freeVal(key[0]);
+			}
+		}
+		ASSERT_EQUALS_INT(0, errors, "every record is found by its key");
+		freeRecord(r);
+		ASSERT_EQUALS_INT(RC_TABLE_IN_USE, deleteTable(names[i]), "open table cannot be deleted");
+		TEST_CHECK(closeTable(table));
+		TEST_CHECK(deleteTable(names[i]));
+	}
+	TEST_CHECK(shutdownRecordManager());
+
+	free(table);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testWriteAheadLog(void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	int numInserts = 50, numSingle = 10, i, status, counts[LOG_CHECKPOINT_END + 1] = { 0 }, chain = 0;
+	long txnXid = -1;
+	pid_t pid;
+	LSN lsn, commitLSN = NO_LSN;
+	LogHandle *log;
+	LogRecord *record;
+	RID *rids;
+	Record *r;
+	Schema *schema;
+	testName = "test logging changes in transactions and on their own";
+	schema = testSchema();
+	rids = (RID *) malloc(sizeof(RID) * numInserts);
+
+	// start from a new database and log; the changes are made in a child process that ends without
+	// shutting down, as the checkpoint of a shutdown drops the log
+	TEST_CHECK(destroyPageFile("database.bin"));
+	fflush(stdout);
+	pid = fork();
+	if (pid == 0)
+	{
+		TEST_CHECK(initRecordManager(NULL));
+		TEST_CHECK(createTable("test_table_w",schema));
+		TEST_CHECK(openTable(table, "test_table_w"));
+
+		// inserts, an update, and a delete in one transaction
+		ASSERT_EQUALS_INT(RC_ERROR, commitTransaction(), "no transaction to commit");
+		TEST_CHECK(beginTransaction());
+		ASSERT_EQUALS_INT(RC_ERROR, beginTransaction(), "transactions do not nest");
+		for(i = 0; i < numInserts; i++)
+		{
+			r = testRecord(schema, i, "aaaa", i % 5);
+			TEST_CHECK(insertRecord(table,r));
+			rids[i] = r->id;
+			freeRecord(r);
+		}
+		r = testRecord(schema, 0, "bbbb", 1);
+		r->id = rids[0];
+		TEST_CHECK(updateRecord(table,r));
+		freeRecord(r);
+		TEST_CHECK(deleteRecord(table,rids[1]));
+		TEST_CHECK(commitTransaction());
+
+		// changes outside a transaction commit one by one
+		for(i = numInserts; i < numInserts + numSingle; i++)
+		{
+			r = testRecord(schema, i, "cccc", i % 5);
+			TEST_CHECK(insertRecord(table,r));
+			freeRecord(r);
+		}
+		TEST_CHECK(closeTable(table));
+		fflush(stdout);
+		_exit(0);
+	}
+	waitpid(pid, &status, 0);
+	ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0, "the child process made its changes");
+
+	// count the records of the log and follow the chain of the transaction back from its commit
+	TEST_CHECK(openLog(&log, "database.log"));
+	getLogStart(log, &lsn);
+	while (readLogRecord(log, lsn, &record) == RC_OK)
+	{
+		counts[record->type]++;
+		if (record->type == LOG_UPDATE)
+			txnXid = record->xid;
+		if (record->type == LOG_COMMIT && record->xid == txnXid)
+			commitLSN = lsn;
+		lsn += record->size;
+		free(record);
+	}
+	for (lsn = commitLSN; lsn != NO_LSN && readLogRecord(log, lsn, &record) == RC_OK; chain++)
+	{
+		lsn = record->prevLSN;
+		free(record);
+	}
+	TEST_CHECK(closeLog(log));
+
+	// creating the table inserts its catalog tuple, which commits on its own
+	ASSERT_EQUALS_INT(numInserts + numSingle + 1, counts[LOG_INSERT], "every insert is logged");
+	ASSERT_EQUALS_INT(1, counts[LOG_UPDATE], "the update is logged");
+	ASSERT_EQUALS_INT(1, counts[LOG_DELETE], "the delete is logged");
+	ASSERT_EQUALS_INT(1 + numSingle + 1, counts[LOG_COMMIT], "one commit per transaction");
+	ASSERT_TRUE(counts[LOG_PAGE_INIT] >= 1, "new data pages are logged");
+	ASSERT_EQUALS_INT(numInserts + 3, chain, "records of the transaction are chained");
+
+	// a restart finds nothing to undo, and its shutdown drops the log behind a checkpoint
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(shutdownRecordManager());
+	countLogRecords(counts);
+	ASSERT_EQUALS_INT(0, counts[LOG_COMPENSATION], "no change is undone");
+	ASSERT_EQUALS_INT(0, counts[LOG_INSERT], "the log before the last checkpoint is dropped");
+	ASSERT_EQUALS_INT(1, counts[LOG_CHECKPOINT_END], "the log starts with the last checkpoint");
+
+	free(rids);
+	free(table);
+	TEST_DONE();
+}
+
+// ************************************************************
+// arguments of the thread of testCrashRecovery whose transaction never commits
+typedef struct Loser {
+	RM_TableData *table;
+	Schema *schema;
+	RID *rids;          // committed records, the first ten are updated and the next ten deleted
+	int first;          // first key to insert
+	int num;            // number of keys to insert
+	int ready;          // set once all changes are made
+} Loser;
+
+void
+testCrashRecovery(void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	int numCommitted = 100, numLoser = 1500, i, status, counts[LOG_CHECKPOINT_END + 1], again[LOG_CHECKPOINT_END + 1];
+	LSN start;
+	pthread_t thread;
+	Loser loser;
+	RID *rids;
+	Record *r;
+	Schema *schema;
+	pid_t pid;
+	testName = "test recovery after a crash";
+	schema = testSchema();
+	rids = (RID *) malloc(sizeof(RID) * numCommitted);
+
+	// the child commits a transaction, leaves a second one open in another thread, and crashes; a
+	// checkpoint is taken while the second transaction runs
+	TEST_CHECK(destroyPageFile("database.bin"));
+	fflush(stdout);
+	pid = fork();
+	if (pid == 0)
+	{
+		TEST_CHECK(initRecordManager(NULL));
+		TEST_CHECK(createTable("test_table_x",schema));
+		TEST_CHECK(openTable(table, "test_table_x"));
+		TEST_CHECK(beginTransaction());
+		for(i = 0; i < numCommitted; i++)
+		{
+			r = testRecord(schema, i, "aaaa", i % 5);
+			TEST_CHECK(insertRecord(table,r));
+			rids[i] = r->id;
+			freeRecord(r);
+		}
+		TEST_CHECK(commitTransaction());
+
+		// enough uncommitted inserts that the buffer pool writes some of them to the page file
+		loser.table = table;
+		loser.schema = schema;
+		loser.rids = rids;
+		loser.first = numCommitted;
+		loser.num = numLoser;
+		loser.ready = 0;
+		pthread_create(&thread, NULL, loserWorker, &loser);
+		while (!__atomic_load_n(&loser.ready, __ATOMIC_ACQUIRE))
+			usleep(1000);
+
+		// committing this insert makes the log records of the open transaction durable as well
+		r = testRecord(schema, numCommitted + numLoser, "cccc", 0);
+		TEST_CHECK(insertRecord(table,r));
+		freeRecord(r);
+		_exit(0);
+	}
+	waitpid(pid, &status, 0);
+	ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0, "the crashed process made its changes");
+
+	// recovery rolls back the open transaction, once; the checkpoint dropped the log before it
+	recoverAndCrash();
+	start = countLogRecords(counts);
+	ASSERT_TRUE(start > PAGE_SIZE, "the checkpoint truncates the log");
+	ASSERT_EQUALS_INT(1, counts[LOG_CHECKPOINT_END], "the checkpoint is logged");
+	ASSERT_EQUALS_INT(numLoser + 20, counts[LOG_COMPENSATION], "every change of the open transaction is undone");
+	ASSERT_EQUALS_INT(1, counts[LOG_ABORT], "the open transaction is rolled back");
+
+	recoverAndCrash();
+	countLogRecords(again);
+	ASSERT_EQUALS_INT(counts[LOG_COMPENSATION], again[LOG_COMPENSATION], "a second recovery undoes nothing");
+	ASSERT_EQUALS_INT(1, again[LOG_ABORT], "a second recovery rolls back nothing");
+
+	// the checkpoint of a clean shutdown leaves nothing to recover
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(shutdownRecordManager());
+	countLogRecords(again);
+	ASSERT_EQUALS_INT(0, again[LOG_COMPENSATION] + again[LOG_ABORT], "the log before the last checkpoint is dropped");
+
+	// the table holds the committed records, found through its rebuilt indexes
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(openTable(table, "test_table_x"));
+	ASSERT_EQUALS_INT(numCommitted + 1, getNumTuples(table), "the committed records are in the table");
+	TEST_CHECK(createRecord(&r, schema));
+	for(i = 0, status = 0; i < numCommitted + numLoser + 1; i++)
+	{
+		Value *key[1];
+		MAKE_VALUE(key[0], DT_INT, i);
+		if ((getRecordByKey(table, key, r) == RC_OK) != (i < numCommitted || i == numCommitted + numLoser) ||
+				(i < numCommitted && strncmp(r->data + sizeof(int), "aaaa", 4) != 0))
+			status++;
+		freeVal(key[0]);
+	}
+	ASSERT_EQUALS_INT(0, status, "exactly the committed records are found by their key, unchanged");
+	freeRecord(r);
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_x"));
+	TEST_CHECK(shutdownRecordManager());
+
+	free(rids);
+	free(table);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testCatalog(void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	int numTables = 1000, i, j, errors;
+	char name[32];
+	Value *key[1];
+	Record *r;
+	Schema *schema, *keyless;
+	testName = "test the catalog keeps thousands of tables across restarts";
+	schema = testSchema();
+	keyless = testSchema();
+	keyless->keySize = 0;
+
+	// the tables keep copies of the names and schemas they are created with
+	TEST_CHECK(destroyPageFile("database.bin"));
+	TEST_CHECK(initRecordManager(NULL));
+	for(i = 0; i < numTables; i++)
+	{
+		sprintf(name, "catalog_%d", i);
+		TEST_CHECK(createTable(name, keyless));
+	}
+	ASSERT_EQUALS_INT(RC_TABLE_ALREADY_EXISTS, createTable("catalog_7", keyless), "table names are unique");
+	TEST_CHECK(createTable("catalog_keyed", schema));
+	TEST_CHECK(openTable(table, "catalog_keyed"));
+	for(i = 0; i < 100; i++)
+	{
+		r = testRecord(schema, i, "aaaa", i % 5);
+		TEST_CHECK(insertRecord(table,r));
+		freeRecord(r);
+	}
+	TEST_CHECK(closeTable(table));
+	for(i = 0; i < numTables; i += 100)
+	{
+		sprintf(name, "catalog_%d", i);
+		TEST_CHECK(openTable(table, name));
+		for(j = 0; j < i / 100; j++)
+		{
+			r = testRecord(keyless, j, "bbbb", i);
+			TEST_CHECK(insertRecord(table,r));
+			freeRecord(r);
+		}
+		TEST_CHECK(closeTable(table));
+	}
+	TEST_CHECK(shutdownRecordManager());
+
+	// a restart finds every table with its schema and records
+	TEST_CHECK(initRecordManager(NULL));
+	for(i = 0, errors = 0; i < numTables; i++)
+	{
+		sprintf(name, "catalog_%d", i);
+		if (openTable(table, name) != RC_OK)
+		{
+			errors++;
+			continue;
+		}
+		if (strcmp(table->name, name) != 0 || table->schema == keyless || table->schema->numAttr != 3 ||
+				table->schema->keySize != 0 || table->schema->dataTypes[1] != DT_STRING ||
+				table->schema->typeLength[1] != 4 || strcmp(table->schema->attrNames[2], "c") != 0 ||
+				getNumTuples(table) != ((i % 100 == 0) ? i / 100 : 0))
+			errors++;
+		closeTable(table);
+	}
+	ASSERT_EQUALS_INT(0, errors, "every table is found with its schema and tuple count");
+	TEST_CHECK(openTable(table, "catalog_keyed"));
+	ASSERT_EQUALS_INT(100, getNumTuples(table), "tuples are counted from the data pages");
+	TEST_CHECK(createRecord(&r, schema));
+	MAKE_VALUE(key[0], DT_INT, 42);
+	TEST_CHECK(getRecordByKey(table, key, r));
+	freeVal(key[0]);
+	setAttr(r, schema, 0, stringToValue("i1000"));
+	TEST_CHECK(insertRecord(table, r));
+	ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, insertRecord(table, r), "the reopened index rejects taken keys");
+	freeRecord(r);
+	TEST_CHECK(closeTable(table));
+
+	// deleted tables stay deleted
+	for(i = 0; i < numTables; i += 2)
+	{
+		sprintf(name, "catalog_%d", i);
+		TEST_CHECK(deleteTable(name));
+	}
+	TEST_CHECK(shutdownRecordManager());
+	TEST_CHECK(initRecordManager(NULL));
+	for(i = 0, errors = 0; i < numTables; i++)
+	{
+		sprintf(name, "catalog_%d", i);
+		if ((i % 2 == 0) != (openTable(table, name) == RC_TABLE_NOT_FOUND))
+			errors++;
+		else if (i % 2 == 1)
+			closeTable(table);
+	}
+	ASSERT_EQUALS_INT(0, errors, "exactly the deleted tables are gone");
+	for(i = 1; i < numTables; i += 2)
+	{
+		sprintf(name, "catalog_%d", i);
+		TEST_CHECK(deleteTable(name));
+	}
+	TEST_CHECK(deleteTable("catalog_keyed"));
+	TEST_CHECK(shutdownRecordManager());
+
+	free(table);
+	TEST_DONE();
+}
+
+// Count the records of database.log by type and return the start of the log
+LSN
+countLogRecords(int *counts)
+{
+	LogHandle *log;
+	LogRecord *record;
+	LSN start, lsn;
+
+	memset(counts, 0, sizeof(int) * (LOG_CHECKPOINT_END + 1));
+	TEST_CHECK(openLog(&log, "database.log"));
+	getLogStart(log, &start);
+	lsn = start;
+	while (readLogRecord(log, lsn, &record) == RC_OK)
+	{
+		counts[record->type]++;
+		lsn += record->size;
+		free(record);
+	}
+	TEST_CHECK(closeLog(log));
+	return start;
+}
+
+// ************************************************************
+// arguments and results of the worker threads of testSnapshotScans
+typedef struct Generations {
+	char *tableName;
+	Schema *schema;
+	RID *rids;
+	int num;            // number of records
+	int numGenerations; // writer: transactions setting c of every record to their generation
+	int *done;          // readers: set once the writer finished
+	int errors;         // failed calls and scans that saw more than one generation
+	int numScans;
+} Generations;
+
+// Scans read the table as of the snapshot taken when they started, and the writers never wait for them
+void
+testSnapshotScans(void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+	RM_ScanHandle *sc2 = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+	int numRecords = 100, n, i, rc, stale, torn, inserted, t;
+	RID rids[100];
+	pthread_t threads[3];
+	Generations gens[3];
+	int done = 0;
+	Schema *schema;
+	Record *r;
+	Value *a, *c;
+	Expr *sel, *left, *right;
+	testName = "test scans read a snapshot while the table changes";
+	schema = testSchema();
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_v",schema));
+	TEST_CHECK(openTable(table, "test_table_v"));
+	for(i = 0; i < numRecords; i++)
+	{
+		r = testRecord(schema, i, "aaaa", i % 5);
+		TEST_CHECK(insertRecord(table,r));
+		rids[i] = r->id;
+		freeRecord(r);
+	}
+
+	// a full scan and an index scan over a < 50 start before a transaction updates every record, deletes records,
+	// moves one out of the range of the index scan, and inserts new ones; the full scan has read part of the table
+	// by then
+	createRecord(&r, schema);
+	TEST_CHECK(startScan(table, sc, NULL));
+	MAKE_ATTRREF(left, 0);
+	MAKE_CONS(right, stringToValue("i50"));
+	MAKE_BINOP_EXPR(sel, left, right, OP_COMP_SMALLER);
+	TEST_CHECK(startScan(table, sc2, sel));
+	for(n = 0; n < 10; n++)
+		TEST_CHECK(next(sc, r));
+
+	TEST_CHECK(beginTransaction());
+	for(i = 0; i < numRecords; i++)
+	{
+		Record *u = testRecord(schema, i, "bbbb", 7);
+		u->id = rids[i];
+		TEST_CHECK(updateRecord(table,u));
+		freeRecord(u);
+	}
+	for(i = 0; i < 20; i++)
+	{
+		Record *u = testRecord(schema, 1000 + i, "cccc", 7);
+		TEST_CHECK(insertRecord(table,u));
+		freeRecord(u);
+	}
+	for(i = 0; i < 5; i++)
+	{
+		TEST_CHECK(deleteRecord(table,rids[20 + i]));
+		TEST_CHECK(deleteRecord(table,rids[60 + i]));
+	}
+	r->id = rids[30];
+	setAttr(r, schema, 0, stringToValue("i500"));
+	setAttr(r, schema, 1, stringToValue("bbbb"));
+	setAttr(r, schema, 2, stringToValue("i7"));
+	TEST_CHECK(updateRecord(table,r));
+	TEST_CHECK(commitTransaction());
+	ASSERT_TRUE(getNumVersions(table) > 0, "the scans keep the replaced versions");
+
+	// the scans see none of the committed changes
+	stale = 0;
+	while((rc = next(sc, r)) == RC_OK)
+	{
+		getAttr(r, schema, 0, &a);
+		getAttr(r, schema, 2, &c);
+		stale += (a->v.intV < numRecords && c->v.intV == a->v.intV % 5) ? 1 : 0;
+		freeVal(a);
+		freeVal(c);
+		n++;
+	}
+	ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc, "full scan ends");
+	ASSERT_EQUALS_INT(numRecords, n, "full scan sees the deleted records but not the inserted ones");
+	ASSERT_EQUALS_INT(numRecords - 10, stale, "full scan sees the records before the update");
+	n = 0;
+	stale = 0;
+	while((rc = next(sc2, r)) == RC_OK)
+	{
+		getAttr(r, schema, 0, &a);
+		getAttr(r, schema, 2, &c);
+		stale += (c->v.intV == a->v.intV % 5) ? 1 : 0;
+		freeVal(a);
+		freeVal(c);
+		n++;
+	}
+	TEST_CHECK(closeScan(sc2));
+	freeExpr(sel);
+	ASSERT_EQUALS_INT(50, n, "index scan sees the records in its range, deleted and moved ones included");
+	ASSERT_EQUALS_INT(50, stale, "index scan sees the records before the update");
+
+	// a new scan and getRecord see the committed changes while the old scans are still open
+	TEST_CHECK(getRecord(table, rids[0], r));
+	getAttr(r, schema, 2, &c);
+	ASSERT_EQUALS_INT(7, c->v.intV, "getRecord reads the committed update");
+	freeVal(c);
+	ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, getRecord(table, rids[60], r), "getRecord does not read a deleted record");
+	TEST_CHECK(startScan(table, sc2, NULL));
+	n = 0;
+	inserted = 0;
+	while((rc = next(sc2, r)) == RC_OK)
+	{
+		getAttr(r, schema, 0, &a);
+		inserted += (a->v.intV >= 1000) ? 1 : 0;
+		freeVal(a);
+		n++;
+	}
+	TEST_CHECK(closeScan(sc2));
+	ASSERT_EQUALS_INT(numRecords + 10, n, "a new scan sees the committed deletes and inserts");
+	ASSERT_EQUALS_INT(20, inserted, "a new scan sees the committed inserts");
+
+	// once the old scans are closed, no snapshot reads the replaced versions anymore; they are collected once more
+	// than the threshold of 1024 accumulated, not by every closing scan
+	TEST_CHECK(closeScan(sc));
+	ASSERT_TRUE(getNumVersions(table) > 0, "closing a scan leaves a few versions for later");
+	TEST_CHECK(getRecord(table, rids[0], r));
+	for(i = 0; i < 1100; i++)
+		TEST_CHECK(updateRecord(table,r));
+	ASSERT_TRUE(getNumVersions(table) < 1024, "the changes collect the versions no snapshot reads");
+
+	// a record moved into the range of an open index scan sorts before the records in the range, the scan skips
+	// it by the key of its version in the snapshot and goes on with the others
+	MAKE_ATTRREF(left, 0);
+	MAKE_CONS(right, stringToValue("i50"));
+	MAKE_BINOP_EXPR(sel, left, right, OP_COMP_SMALLER);
+	TEST_CHECK(startScan(table, sc2, sel));
+	r->id = rids[80];
+	setAttr(r, schema, 0, stringToValue("i-1"));
+	setAttr(r, schema, 1, stringToValue("rrrr"));
+	setAttr(r, schema, 2, stringToValue("i4"));
+	TEST_CHECK(updateRecord(table,r));
+	n = 0;
+	stale = 0;
+	while((rc = next(sc2, r)) == RC_OK)
+	{
+		getAttr(r, schema, 0, &a);
+		stale += (a->v.intV >= 0 && a->v.intV < 50) ? 1 : 0;
+		freeVal(a);
+		n++;
+	}
+	TEST_CHECK(closeScan(sc2));
+	ASSERT_EQUALS_INT(44, n, "index scan sees the records in its range despite the moved record");
+	ASSERT_EQUALS_INT(44, stale, "index scan does not see the moved record");
+	TEST_CHECK(startScan(table, sc2, sel));
+	for(n = 0; next(sc2, r) == RC_OK; n++)
+		;
+	TEST_CHECK(closeScan(sc2));
+	freeExpr(sel);
+	ASSERT_EQUALS_INT(45, n, "a new index scan sees the moved record");
+
+	// the changes of an open transaction are only seen by the thread itself, and other threads can neither change
+	// the records it changed nor take the slots or the keys it freed
+	TEST_CHECK(beginTransaction());
+	r->id = rids[1];
+	setAttr(r, schema, 0, stringToValue("i1"));
+	setAttr(r, schema, 1, stringToValue("sddd"));
+	setAttr(r, schema, 2, stringToValue("i9"));
+	TEST_CHECK(updateRecord(table,r));
+	TEST_CHECK(deleteRecord(table,rids[3]));
+	gens[0].tableName = "test_table_v";
+	gens[0].schema = schema;
+	gens[0].rids = rids;
+	gens[0].errors = 0;
+	pthread_create(&threads[0], NULL, openTransactionWorker, &gens[0]);
+	pthread_join(threads[0], NULL);
+	ASSERT_EQUALS_INT(0, gens[0].errors, "other threads read the committed version and cannot change the records");
+	TEST_CHECK(getRecord(table, rids[1], r));
+	getAttr(r, schema, 2, &c);
+	ASSERT_EQUALS_INT(9, c->v.intV, "the thread reads its own update");
+	freeVal(c);
+	TEST_CHECK(commitTransaction());
+
+	// once the transaction committed, its records can be changed and the slots and keys it freed taken
+	TEST_CHECK(updateRecord(table,r));
+	freeRecord(r);
+	r = testRecord(schema, 3001, "ffff", 1);
+	TEST_CHECK(insertRecord(table,r));
+	ASSERT_TRUE(r->id.page == rids[3].page && r->id.slot == rids[3].slot, "the freed slot is taken after the commit");
+	MAKE_VALUE(a, DT_INT, 3);
+	ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, getRecordByKey(table, &a, r), "the deleted key is gone after the commit");
+	freeVal(a);
+	freeRecord(r);
+	r = testRecord(schema, 3, "ffff", 1);
+	TEST_CHECK(insertRecord(table,r));
+
+	TEST_CHECK(closeTable(table));
+
+	// readers scanning while a writer commits generation after generation each see one generation in whole
+	TEST_CHECK(createTable("test_table_g",schema));
+	TEST_CHECK(openTable(table, "test_table_g"));
+	for(i = 0; i < numRecords; i++)
+	{
+		Record *u = testRecord(schema, 2000 + i, "gggg", 0);
+		TEST_CHECK(insertRecord(table,u));
+		rids[i] = u->id;
+		freeRecord(u);
+	}
+	for(t = 0; t < 3; t++)
+	{
+		gens[t].tableName = "test_table_g";
+		gens[t].schema = schema;
+		gens[t].rids = rids;
+		gens[t].num = numRecords;
+		gens[t].numGenerations = 50;
+		gens[t].done = &done;
+		gens[t].errors = 0;
+		gens[t].numScans = 0;
+	}
+	pthread_create(&threads[0], NULL, generationWorker, &gens[0]);
+	for(t = 1; t < 3; t++)
+		pthread_create(&threads[t], NULL, snapshotWorker, &gens[t]);
+	pthread_join(threads[0], NULL);
+	__atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+	torn = 0;
+	for(t = 1; t < 3; t++)
+	{
+		pthread_join(threads[t], NULL);
+		torn += gens[t].errors;
+	}
+	ASSERT_EQUALS_INT(0, gens[0].errors, "the writer commits every generation");
+	ASSERT_EQUALS_INT(0, torn, "every scan sees exactly one generation");
+	ASSERT_TRUE(gens[1].numScans > 0 && gens[2].numScans > 0, "the readers scanned meanwhile");
+	ASSERT_TRUE(getNumVersions(table) < gens[0].numGenerations * numRecords, "the versions are collected meanwhile");
+
+	freeRecord(r);
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_v"));
+	TEST_CHECK(deleteTable("test_table_g"));
+	TEST_CHECK(shutdownRecordManager());
+
+	free(sc);
+	free(sc2);
+	free(table);
+	TEST_DONE();
+}
+
+// Recover the database in a child process that crashes right after, so the log is left as recovery wrote it
+void
+recoverAndCrash(void)
+{
+	int status;
+	pid_t pid;
+
+	fflush(stdout);
+	pid = fork();
+	if (pid == 0)
+	{
+		TEST_CHECK(initRecordManager(NULL));
+		fflush(stdout);
+		_exit(0);
+	}
+	waitpid(pid, &status, 0);
+	ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0, "the database is recovered");
+}
+
+// Update, delete, and insert records in a transaction that never commits
+void *
+loserWorker(void *arg)
+{
+	Loser *l = (Loser *) arg;
+	Record *r;
+	int i;
+
+	TEST_CHECK(beginTransaction());
+	for(i = 0; i < 10; i++)
+	{
+		r = testRecord(l->schema, i, "bbbb", i % 5);
+		r->id = l->rids[i];
+		TEST_CHECK(updateRecord(l->table,r));
+		freeRecord(r);
+		TEST_CHECK(deleteRecord(l->table,l->rids[10 + i]));
+	}
+	TEST_CHECK(takeCheckpoint());
+	for(i = l->first; i < l->first + l->num; i++)
+	{
+		r = testRecord(l->schema, i, "dddd", i % 5);
+		TEST_CHECK(insertRecord(l->table,r));
+		freeRecord(r);
+	}
+	__atomic_store_n(&l->ready, 1, __ATOMIC_RELEASE);
+
+	// the process crashes while the transaction is open
+	for (;;)
+		pause();
+	return NULL;
+}
+
+// Insert a range of keys through a private handle of the table
+void *
+insertWorker(void *arg)
+{
+	Worker *w = (Worker *) arg;
+	RM_TableData table;
+	int k;
+
+	if (openTable(&table, w->tableName) != RC_OK)
+	{
+		w->errors++;
+		return NULL;
+	}
+	for(k = w->first; k < w->first + w->num; k++)
+	{
+		Record *r = testRecord(w->schema, k, "cccc", k % 5);
+		if (insertRecord(&table, r) != RC_OK)
+			w->errors++;
+		freeRecord(r);
+	}
+	closeTable(&table);
+	return NULL;
+}
+
+// Scan a table until the inserters are done, every tuple read must be one that was inserted whole
+void *
+scanWorker(void *arg)
+{
+	Worker *w = (Worker *) arg;
+	RM_TableData table;
+	RM_ScanHandle sc;
+	Record *r;
+	Value *a, *c;
+	int rc;
+
+	if (openTable(&table, w->tableName) != RC_OK)
+	{
+		w->errors++;
+		return NULL;
+	}
+	createRecord(&r, w->schema);
+	do
+	{
+		if (startScan(&table, &sc, NULL) != RC_OK)
+		{
+			w->errors++;
+			break;
+		}
+		while((rc = next(&sc, r)) == RC_OK)
+		{
+			getAttr(r, w->schema, 0, &a);
+			getAttr(r, w->schema, 2, &c);
+			if (c->v.intV != a->v.intV % 5)
+				w->errors++;
+			freeVal(a);
+			freeVal(c);
+		}
+		if (rc != RC_RM_NO_MORE_TUPLES)
+			w->errors++;
+		closeScan(&sc);
+		w->numScans++;
+	} while (!__atomic_load_n(w->done, __ATOMIC_ACQUIRE));
+	freeRecord(r);
+	closeTable(&table);
+	return NULL;
+}
+
+// Set c of all records to the generation, one transaction per generation
+void *
+generationWorker(void *arg)
+{
+	Generations *g = (Generations *) arg;
+	RM_TableData table;
+	int gen, i;
+
+	if (openTable(&table, g->tableName) != RC_OK)
+	{
+		g->errors++;
+		return NULL;
+	}
+	for(gen = 1; gen <= g->numGenerations; gen++)
+	{
+		if (beginTransaction() != RC_OK)
+			g->errors++;
+		for(i = 0; i < g->num; i++)
+		{
+			Record *r = testRecord(g->schema, 2000 + i, "gggg", gen);
+			r->id = g->rids[i];
+			if (updateRecord(&table, r) != RC_OK)
+				g->errors++;
+			freeRecord(r);
+		}
+		if (commitTransaction() != RC_OK)
+			g->errors++;
+	}
+	closeTable(&table);
+	return NULL;
+}
+
+// Scan until the writer is done, every scan must see the same c in all num records
+void *
+snapshotWorker(void *arg)
+{
+	Generations *g = (Generations *) arg;
+	RM_TableData table;
+	RM_ScanHandle sc;
+	Record *r;
+	Value *c;
+	int rc, n, gen;
+
+	if (openTable(&table, g->tableName) != RC_OK)
+	{
+		g->errors++;
+		return NULL;
+	}
+	createRecord(&r, g->schema);
+	do
+	{
+		if (startScan(&table, &sc, NULL) != RC_OK)
+		{
+			g->errors++;
+			break;
+		}
+		n = 0;
+		gen = -1;
+		while((rc = next(&sc, r)) == RC_OK)
+		{
+			getAttr(r, g->schema, 2, &c);
+			if (gen == -1)
+				gen = c->v.intV;
+			g->errors += (c->v.intV != gen) ? 1 : 0;
+			freeVal(c);
+			n++;
+		}
+		if (rc != RC_RM_NO_MORE_TUPLES || n != g->num)
+			g->errors++;
+		closeScan(&sc);
+		g->numScans++;
+	} while (!__atomic_load_n(g->done, __ATOMIC_ACQUIRE));
+	freeRecord(r);
+	closeTable(&table);
+	return NULL;
+}
+
+// While another thread's transaction has updated the record at rids[1] and deleted the one at rids[3], read the
+// committed version of the first, fail to change it, find the second by its key, fail to insert its key again,
+// and insert a record somewhere else than the freed slot
+void *
+openTransactionWorker(void *arg)
+{
+	Generations *g = (Generations *) arg;
+	RM_TableData table;
+	Record *r;
+	Value *c;
+
+	if (openTable(&table, g->tableName) != RC_OK)
+	{
+		g->errors++;
+		return NULL;
+	}
+	createRecord(&r, g->schema);
+	if (getRecord(&table, g->rids[1], r) != RC_OK)
+		g->errors++;
+	else
+	{
+		getAttr(r, g->schema, 2, &c);
+		g->errors += (c->v.intV != 7) ? 1 : 0;
+		freeVal(c);
+	}
+	r->id = g->rids[1];
+	g->errors += (updateRecord(&table, r) != RC_RM_WRITE_CONFLICT) ? 1 : 0;
+	g->errors += (deleteRecord(&table, g->rids[1]) != RC_RM_WRITE_CONFLICT) ? 1 : 0;
+	MAKE_VALUE(c, DT_INT, 3);
+	if (getRecordByKey(&table, &c, r) != RC_OK || r->id.page != g->rids[3].page || r->id.slot != g->rids[3].slot)
+		g->errors++;
+	freeVal(c);
+	freeRecord(r);
+
+	r = testRecord(g->schema, 3, "eeee", 0);
+	g->errors += (insertRecord(&table, r) != RC_IM_KEY_ALREADY_EXISTS) ? 1 : 0;
+	freeRecord(r);
+
+	r = testRecord(g->schema, 3000, "eeee", 0);
+	if (insertRecord(&table, r) != RC_OK)
+		g->errors++;
+	g->errors += (r->id.page == g->rids[3].page && r->id.slot == g->rids[3].slot) ? 1 : 0;
+	freeRecord(r);
+	closeTable(&table);
+	return NULL;
+}
+
 Schema *
 testSchema (void)
 {
@@ -0,0 +1,299 @@
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "record_mgr.h"
+#include "btree_mgr.h"
+#include "dberror.h"
+#include "test_helper.h"
+
+// var to store the current test's name
+char *testName;
+
+// test and helper methods
+static void testInsertFindDelete (void);
+static void testDuplicateKeys (void);
+static void testReopen (void);
+static Schema *keySchema (void);
+static void intKey (Schema *schema, int k, char *key);
+static void shuffle (int *values, int num);
+
+// main method
+int
+main (void)
+{
+	initStorageManager();
+	testName = "";
+
+	testInsertFindDelete();
+	testDuplicateKeys();
+	testReopen();
+
+	return 0;
+}
+
+// ************************************************************
+void
+testInsertFindDelete (void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	Schema *schema = keySchema();
+	BTreeHandle *tree;
+	BT_ScanHandle *sc;
+	PageNumber headerPage;
+	int sizes[] = { 2, 4, 0 };
+	int numKeys = 2000, numPages, i, s, k, num;
+	int *keys = (int *) malloc(sizeof(int) * numKeys);
+	char key[sizeof(int)];
+	RID rid;
+	bool ordered;
+	testName = "inserting, finding, and deleting keys in random order";
+
+	for (s = 0; s < 3; s++)
+	{
+		TEST_CHECK(createPageFile("testbtree.bin"));
+		TEST_CHECK(initBufferPool(bm, "testbtree.bin", 8, RS_LRU, NULL));
+		numPages = 1;
+		TEST_CHECK(createBtree(bm, &numPages, schema, sizes[s], &headerPage));
+		TEST_CHECK(openBtree(&tree, bm, &numPages, schema, headerPage));
+
+		// insert the keys in random order, the RID of key k is (k, k % 7)
+		for (i = 0; i < numKeys; i++)
+			keys[i] = i;
+		shuffle(keys, numKeys);
+		for (i = 0; i < numKeys; i++)
+		{
+			RID r = { keys[i], keys[i] % 7 };
+			intKey(schema, keys[i], key);
+			TEST_CHECK(insertKey(tree, key, r));
+		}
+		getNumEntries(tree, &num);
+		ASSERT_EQUALS_INT(numKeys, num, "all keys are in the tree");
+		intKey(schema, 42, key);
+		rid.page = 42;
+		rid.slot = 0;
+		ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, insertKey(tree, key, rid), "entries are unique");
+
+		for (i = 0; i < numKeys; i++)
+		{
+			intKey(schema, i, key);
+			TEST_CHECK(findKey(tree, key, &rid));
+			if (rid.page != i || rid.slot != i % 7)
+				break;
+		}
+		ASSERT_EQUALS_INT(numKeys, i, "every key is found with its RID");
+		intKey(schema, numKeys, key);
+		ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, findKey(tree, key, &rid), "missing key is not found");
+
+		// a scan returns the entries in key order
+		TEST_CHECK(openTreeScan(tree, &sc));
+		for (i = 0, ordered = TRUE; nextEntry(sc, &rid) == RC_OK; i++)
+			ordered = ordered && rid.page == i;
+		TEST_CHECK(closeTreeScan(sc));
+		ASSERT_TRUE(ordered, "scan is in key order");
+		ASSERT_EQUALS_INT(numKeys, i, "scan returns every entry");
+
+		// delete the keys in another random order, checking the remaining keys half way
+		shuffle(keys, numKeys);
+		for (i = 0; i < numKeys / 2; i++)
+		{
+			RID r = { keys[i], keys[i] % 7 };
+			intKey(schema, keys[i], key);
+			TEST_CHECK(deleteKey(tree, key, r));
+		}
+		ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, deleteKey(tree, key, rid), "deleted key is gone");
+		for (i = 0, k = 0; i < numKeys; i++)
+		{
+			intKey(schema, keys[i], key);
+			if ((findKey(tree, key, &rid) == RC_OK) == (i >= numKeys / 2))
+				k++;
+		}
+		ASSERT_EQUALS_INT(numKeys, k, "only the remaining keys are found");
+
+		TEST_CHECK(openTreeScan(tree, &sc));
+		for (i = 0, k = -1, ordered = TRUE; nextEntry(sc, &rid) == RC_OK; i++)
+		{
+			ordered = ordered && rid.page > k;
+			k = rid.page;
+		}
+		TEST_CHECK(closeTreeScan(sc));
+		ASSERT_TRUE(ordered, "scan is in key order after deletes");
+		ASSERT_EQUALS_INT(numKeys - numKeys / 2, i, "scan returns the remaining entries");
+
+		for (i = numKeys / 2; i < numKeys; i++)
+		{
+			RID r = { keys[i], keys[i] % 7 };
+			intKey(schema, keys[i], key);
+			TEST_CHECK(deleteKey(tree, key, r));
+		}
+		getNumEntries(tree, &num);
+		ASSERT_EQUALS_INT(0, num, "tree is empty");
+		getNumNodes(tree, &num);
+		ASSERT_EQUALS_INT(1, num, "empty tree shrinks to its root");
+
+		TEST_CHECK(closeBtree(tree));
+		TEST_CHECK(deleteBtree(bm, headerPage));
+		TEST_CHECK(shutdownBufferPool(bm));
+	}
+
+	ASSERT_EQUALS_INT(RC_IM_N_TO_LAGE, createBtree(bm, &numPages, schema, PAGE_SIZE, &headerPage), "node does not fit on a page");
+
+	TEST_CHECK(destroyPageFile("testbtree.bin"));
+	free(keys);
+	free(bm);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testDuplicateKeys (void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	Schema *schema = keySchema();
+	BTreeHandle *tree;
+	BT_ScanHandle *sc;
+	PageNumber headerPage;
+	int numPages = 1, i, k;
+	char key[sizeof(int)];
+	RID rid;
+	testName = "several RIDs per key";
+
+	TEST_CHECK(createPageFile("testbtree.bin"));
+	TEST_CHECK(initBufferPool(bm, "testbtree.bin", 8, RS_FIFO, NULL));
+	TEST_CHECK(createBtree(bm, &numPages, schema, 3, &headerPage));
+	TEST_CHECK(openBtree(&tree, bm, &numPages, schema, headerPage));
+
+	// keys 0 to 9, each with the RIDs (10 - j, k) for j = 1..k
+	for (k = 0; k < 10; k++)
+		for (i = 1; i <= k; i++)
+		{
+			RID r = { 10 - i, k };
+			intKey(schema, k, key);
+			TEST_CHECK(insertKey(tree, key, r));
+		}
+
+	intKey(schema, 5, key);
+	TEST_CHECK(findKey(tree, key, &rid));
+	ASSERT_EQUALS_INT(5, rid.page, "find returns the smallest RID of the key");
+
+	// a scan from key 5 starts at its smallest RID
+	TEST_CHECK(openTreeScanFrom(tree, key, &sc));
+	for (i = 0; i < 5; i++)
+	{
+		TEST_CHECK(nextEntry(sc, &rid));
+		ASSERT_TRUE(rid.slot == 5 && rid.page == 5 + i, "RIDs of a key are in order");
+	}
+	TEST_CHECK(nextEntry(sc, &rid));
+	ASSERT_EQUALS_INT(6, rid.slot, "scan continues with the next key");
+	TEST_CHECK(closeTreeScan(sc));
+
+	// deleting one entry of a key keeps the others
+	rid.page = 5;
+	rid.slot = 5;
+	TEST_CHECK(deleteKey(tree, key, rid));
+	TEST_CHECK(findKey(tree, key, &rid));
+	ASSERT_EQUALS_INT(6, rid.page, "other RIDs of the key remain");
+
+	intKey(schema, 0, key);
+	ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, findKey(tree, key, &rid), "key without entries");
+	intKey(schema, 10, key);
+	TEST_CHECK(openTreeScanFrom(tree, key, &sc));
+	ASSERT_EQUALS_INT(RC_IM_NO_MORE_ENTRIES, nextEntry(sc, &rid), "scan after the last key is empty");
+	TEST_CHECK(closeTreeScan(sc));
+
+	TEST_CHECK(closeBtree(tree));
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(destroyPageFile("testbtree.bin"));
+	free(bm);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testReopen (void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	Schema *schema = keySchema();
+	BTreeHandle *tree;
+	PageNumber headerPage;
+	int numPages = 1, i, num;
+	char key[sizeof(int)];
+	RID rid;
+	testName = "closing and reopening an index";
+
+	TEST_CHECK(createPageFile("testbtree.bin"));
+	TEST_CHECK(initBufferPool(bm, "testbtree.bin", 4, RS_CLOCK, NULL));
+	TEST_CHECK(createBtree(bm, &numPages, schema, 0, &headerPage));
+	TEST_CHECK(openBtree(&tree, bm, &numPages, schema, headerPage));
+	for (i = 0; i < 1000; i++)
+	{
+		RID r = { i, 0 };
+		intKey(schema, i * 3, key);
+		TEST_CHECK(insertKey(tree, key, r));
+	}
+	TEST_CHECK(closeBtree(tree));
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	// the index survives flushing the buffer pool
+	TEST_CHECK(initBufferPool(bm, "testbtree.bin", 4, RS_CLOCK, NULL));
+	TEST_CHECK(openBtree(&tree, bm, &numPages, schema, headerPage));
+	getNumEntries(tree, &num);
+	ASSERT_EQUALS_INT(1000, num, "entries after reopening");
+	intKey(schema, 999 * 3, key);
+	TEST_CHECK(findKey(tree, key, &rid));
+	ASSERT_EQUALS_INT(999, rid.page, "key found after reopening");
+	TEST_CHECK(closeBtree(tree));
+
+	TEST_CHECK(deleteBtree(bm, headerPage));
+	ASSERT_TRUE(openBtree(&tree, bm, &numPages, schema, headerPage) != RC_OK, "deleted index cannot be opened");
+
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(destroyPageFile("testbtree.bin"));
+	free(bm);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+Schema *
+keySchema (void)
+{
+	char **names = (char **) malloc(sizeof(char*) * 2);
+	DataType *dt = (DataType *) malloc(sizeof(DataType) * 2);
+	int *sizes = (int *) malloc(sizeof(int) * 2);
+	int *keys = (int *) malloc(sizeof(int));
+
+	names[0] = "k";
+	names[1] = "v";
+	dt[0] = DT_INT;
+	dt[1] = DT_STRING;
+	sizes[0] = 0;
+	sizes[1] = 8;
+	keys[0] = 0;
+
+	return createSchema(2, names, dt, sizes, 1, keys);
+}
+
+void
+intKey (Schema *schema, int k, char *key)
+{
+	Value v;
+	Value *values[] = { &v };
+
+	v.dt = DT_INT;
+	v.v.intV = k;
+	valuesToKey(schema, values, key);
+}
+
+void
+shuffle (int *values, int num)
+{
+	int i;
+	for (i = num - 1; i > 0; i--)
+	{
+		int j = rand() % (i + 1);
+		int tmp = values[i];
+		values[i] = values[j];
+		values[j] = tmp;
+	}
+}
@@ -0,0 +1,614 @@
+#include <pthread.h>
+#include <unistd.h>
+#include "storage_mgr.h"
+#include "buffer_mgr_stat.h"
+#include "buffer_mgr.h"
+#include "dberror.h"
+#include "test_helper.h"
+
+// var to store the current test's name
+char *testName;
+
+// check whether two the content of a buffer pool is the same as an expected content
+// (given in the format produced by sprintPoolContent)
+#define ASSERT_EQUALS_POOL(expected,bm,message)				\
+		do {									\
+			char *real;								\
+			char *_exp = (char *) (expected);                                   \
+			real = sprintPoolContent(bm);					\
+			if (strcmp((_exp),real) != 0)					\
+			{									\
+				printf("[%s-%s-L%i-%s] FAILED: expected <%s> but was <%s>: %s\n",TEST_INFO, _exp, real, message); \
+				free(real);							\
+				exit(1);							\
+			}									\
+			printf("[%s-%s-L%i-%s] OK: expected <%s> and was <%s>: %s\n",TEST_INFO, _exp, real, message); \
+			free(real);								\
+		} while(0)
+
+// test and helper methods
+static void testHitsWithoutIO (void);
+static void testCLOCK (void);
+static void testLRU_K (void);
+static void testAccessRing (void);
+static void testShardedPool (void);
+static void testPageCleaner (void);
+static void testPrefetch (void);
+static void testBatchedTransfers (void);
+static void testFailedLogFlush (void);
+static RC flushTestLog (void *log, long lsn);
+static void countTransfer (SM_IORequest *request);
+static void *incrementPages (void *arg);
+static int countDirtyPages (BM_BufferPool *bm);
+static void waitForReads (BM_BufferPool *bm, int numReadIO);
+static void pinAndUnpin (BM_BufferPool *bm, BM_PageHandle *h, PageNumber pageNum);
+
+// main method
+int
+main (void)
+{
+	initStorageManager();
+	testName = "";
+
+	testHitsWithoutIO();
+	testCLOCK();
+	testLRU_K();
+	testAccessRing();
+	testShardedPool();
+	testPageCleaner();
+	testPrefetch();
+	testBatchedTransfers();
+	testFailedLogFlush();
+
+	return 0;
+}
+
+// ************************************************************
+void
+testHitsWithoutIO (void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	ReplacementStrategy strategies[] = { RS_FIFO, RS_LRU, RS_CLOCK, RS_LRU_K };
+	int i, s;
+	testName = "Pinning resident pages does not read from disk";
+
+	for (s = 0; s < 4; s++)
+	{
+		TEST_CHECK(createPageFile("testbuffer.bin"));
+		TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 3, strategies[s], NULL));
+
+		// write a marker into each page, forcing evictions of dirty pages
+		for (i = 0; i < 5; i++)
+		{
+			TEST_CHECK(pinPage(bm, h, i));
+			sprintf(h->data, "Page-%i", i);
+			TEST_CHECK(markDirty(bm, h));
+			TEST_CHECK(unpinPage(bm, h));
+		}
+		ASSERT_EQUALS_INT(5, getNumReadIO(bm), "every new page is read once");
+		ASSERT_EQUALS_INT(2, getNumWriteIO(bm), "evicted dirty pages are written back");
+
+		// pages 2, 3 and 4 are resident
+		for (i = 0; i < 10; i++)
+			pinAndUnpin(bm, h, 2 + i % 3);
+		ASSERT_EQUALS_INT(5, getNumReadIO(bm), "hits do not read");
+
+		// re-read the evicted pages and check their content
+		for (i = 0; i < 5; i++)
+		{
+			char expected[20];
+			TEST_CHECK(pinPage(bm, h, i));
+			sprintf(expected, "Page-%i", i);
+			ASSERT_EQUALS_STRING(expected, h->data, "page content survives eviction");
+			TEST_CHECK(unpinPage(bm, h));
+		}
+
+		TEST_CHECK(shutdownBufferPool(bm));
+		TEST_CHECK(destroyPageFile("testbuffer.bin"));
+	}
+
+	free(bm);
+	free(h);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testCLOCK (void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	BM_PageHandle *pinned = MAKE_PAGE_HANDLE();
+	testName = "Testing CLOCK page replacement";
+
+	TEST_CHECK(createPageFile("testbuffer.bin"));
+	TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_CLOCK, NULL));
+
+	// fill the pool
+	pinAndUnpin(bm, h, 0);
+	pinAndUnpin(bm, h, 1);
+	pinAndUnpin(bm, h, 2);
+	ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0]", bm, "fill the pool");
+
+	// all frames are referenced: a full sweep clears them and frame 0 is replaced
+	pinAndUnpin(bm, h, 3);
+	ASSERT_EQUALS_POOL("[3 0],[1 0],[2 0]", bm, "replace first frame after a full sweep");
+
+	// page 1 gets a second chance, page 2 is replaced
+	pinAndUnpin(bm, h, 1);
+	pinAndUnpin(bm, h, 4);
+	ASSERT_EQUALS_POOL("[3 0],[1 0],[4 0]", bm, "referenced page gets a second chance");
+
+	// page 3 was referenced when loaded, page 1 lost its reference bit in the last sweep
+	pinAndUnpin(bm, h, 5);
+	ASSERT_EQUALS_POOL("[3 0],[5 0],[4 0]", bm, "unreferenced page is replaced");
+
+	// pinned pages are never replaced
+	TEST_CHECK(pinPage(bm, pinned, 5));
+	TEST_CHECK(markDirty(bm, pinned));
+	pinAndUnpin(bm, h, 6);
+	pinAndUnpin(bm, h, 7);
+	ASSERT_EQUALS_POOL("[6 0],[5x1],[7 0]", bm, "pinned page stays in the pool");
+	TEST_CHECK(unpinPage(bm, pinned));
+
+	ASSERT_EQUALS_INT(8, getNumReadIO(bm), "check number of read I/Os");
+	ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(destroyPageFile("testbuffer.bin"));
+
+	free(bm);
+	free(h);
+	free(pinned);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testLRU_K (void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	int k = 2;
+	testName = "Testing LRU-K page replacement";
+
+	TEST_CHECK(createPageFile("testbuffer.bin"));
+	TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU_K, &k));
+
+	// pages 0 and 1 are accessed twice, page 2 once
+	pinAndUnpin(bm, h, 0);
+	pinAndUnpin(bm, h, 1);
+	pinAndUnpin(bm, h, 2);
+	pinAndUnpin(bm, h, 0);
+	pinAndUnpin(bm, h, 1);
+	ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0]", bm, "fill the pool");
+
+	// a scan only replaces pages with fewer than K accesses
+	pinAndUnpin(bm, h, 3);
+	ASSERT_EQUALS_POOL("[0 0],[1 0],[3 0]", bm, "page with a single access is replaced");
+	pinAndUnpin(bm, h, 4);
+	pinAndUnpin(bm, h, 5);
+	ASSERT_EQUALS_POOL("[0 0],[1 0],[5 0]", bm, "scan does not evict pages accessed twice");
+
+	// page 2 gets back its history, so it now has two accesses and page 0 has the oldest second access
+	pinAndUnpin(bm, h, 2);
+	pinAndUnpin(bm, h, 6);
+	ASSERT_EQUALS_POOL("[6 0],[1 0],[2 0]", bm, "history of evicted pages is retained");
+
+	ASSERT_EQUALS_INT(8, getNumReadIO(bm), "check number of read I/Os");
+
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(destroyPageFile("testbuffer.bin"));
+
+	free(bm);
+	free(h);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testAccessRing (void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	BM_AccessRing *ring;
+	int i;
+	testName = "Testing scans through an access ring";
+
+	TEST_CHECK(createPageFile("testbuffer.bin"));
+	TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_LRU, NULL));
+
+	// the working set
+	pinAndUnpin(bm, h, 0);
+	pinAndUnpin(bm, h, 1);
+	pinAndUnpin(bm, h, 2);
+
+	// a scan over ten pages only uses a single frame
+	ring = createAccessRing(bm, 1);
+	for (i = 10; i < 20; i++)
+	{
+		TEST_CHECK(pinPageWithRing(bm, ring, h, i));
+		ASSERT_EQUALS_INT(i, h->pageNum, "ring pins the requested page");
+		TEST_CHECK(unpinPage(bm, h));
+	}
+	ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0],[19 0]", bm, "scan keeps the working set");
+
+	// resident pages are shared with the scan
+	TEST_CHECK(pinPageWithRing(bm, ring, h, 1));
+	TEST_CHECK(unpinPage(bm, h));
+	ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0],[19 0]", bm, "hit on a working set page");
+	ASSERT_EQUALS_INT(13, getNumReadIO(bm), "check number of read I/Os");
+
+	freeAccessRing(ring);
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(destroyPageFile("testbuffer.bin"));
+
+	free(bm);
+	free(h);
+	TEST_DONE();
+}
+
+// ************************************************************
+#define SHARDED_POOL_PAGES 1024
+#define SHARDED_POOL_THREADS 8
+#define SHARDED_POOL_INCREMENTS 4000
+
+// arguments of the threads of testShardedPool
+typedef struct PoolWorker {
+	BM_BufferPool *bm;
+	unsigned int seed;
+	int errors;
+} PoolWorker;
+
+void
+testShardedPool (void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	ReplacementStrategy strategies[] = { RS_FIFO, RS_LRU, RS_CLOCK, RS_LRU_K };
+	pthread_t threads[SHARDED_POOL_THREADS];
+	PoolWorker workers[SHARDED_POOL_THREADS];
+	int i, s, t, sum, errors;
+	testName = "Concurrent updates through a pool with several shards";
+
+	for (s = 0; s < 4; s++)
+	{
+		TEST_CHECK(createPageFile("testbuffer.bin"));
+		TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 4 * BM_MIN_SHARD_FRAMES, strategies[s], NULL));
+		TEST_CHECK(startPageCleaner(bm, 16));
+
+		// every thread increments a counter on random pages, evicting pages of all shards on the way,
+		// while the page cleaner writes pages back
+		for (t = 0; t < SHARDED_POOL_THREADS; t++)
+		{
+			workers[t].bm = bm;
+			workers[t].seed = t + 1;
+			workers[t].errors = 0;
+			pthread_create(&threads[t], NULL, incrementPages, &workers[t]);
+		}
+		for (t = 0, errors = 0; t < SHARDED_POOL_THREADS; t++)
+		{
+			pthread_join(threads[t], NULL);
+			errors += workers[t].errors;
+		}
+		ASSERT_EQUALS_INT(0, errors, "no failed calls in the threads");
+
+		// no increment is lost, whether the page stayed in the pool or was written back
+		for (i = 0, sum = 0; i < SHARDED_POOL_PAGES; i++)
+		{
+			int counter;
+			TEST_CHECK(pinPage(bm, h, i));
+			memcpy(&counter, h->data, sizeof(int));
+			sum += counter;
+			TEST_CHECK(unpinPage(bm, h));
+		}
+		ASSERT_EQUALS_INT(SHARDED_POOL_THREADS * SHARDED_POOL_INCREMENTS, sum, "all increments are kept");
+
+		TEST_CHECK(shutdownBufferPool(bm));
+		TEST_CHECK(destroyPageFile("testbuffer.bin"));
+	}
+
+	free(bm);
+	free(h);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testPageCleaner (void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	int i, wait;
+	testName = "Writing dirty pages back in the background";
+
+	TEST_CHECK(createPageFile("testbuffer.bin"));
+	TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 16, RS_FIFO, NULL));
+
+	// dirty 12 of the 16 frames
+	for (i = 0; i < 12; i++)
+	{
+		TEST_CHECK(pinPage(bm, h, i));
+		sprintf(h->data, "Page-%i", i);
+		TEST_CHECK(markDirty(bm, h));
+		TEST_CHECK(unpinPage(bm, h));
+	}
+	ASSERT_EQUALS_INT(12, countDirtyPages(bm), "pages are dirty");
+
+	// above the high-water mark of 4, the cleaner writes pages back in FIFO order until 2 are left
+	TEST_CHECK(startPageCleaner(bm, 4));
+	for (wait = 0; wait < 1000 && countDirtyPages(bm) > 2; wait++)
+		usleep(2000);
+	TEST_CHECK(stopPageCleaner(bm));
+	ASSERT_EQUALS_INT(2, countDirtyPages(bm), "cleaner stops at half the high-water mark");
+	ASSERT_EQUALS_INT(10, getNumWriteIO(bm), "cleaner writes the pages back");
+	ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0],[3 0],[4 0],[5 0],[6 0],[7 0],[8 0],[9 0],[10x0],[11x0],[-1 0],[-1 0],[-1 0],[-1 0]",
+			bm, "the oldest pages are clean");
+
+	// the next victims are clean, so reading new pages writes nothing
+	for (i = 100; i < 108; i++)
+		pinAndUnpin(bm, h, i);
+	ASSERT_EQUALS_INT(10, getNumWriteIO(bm), "evicting cleaned pages does not write");
+
+	// all pages reach the file
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 16, RS_FIFO, NULL));
+	for (i = 0; i < 12; i++)
+	{
+		char expected[PAGE_SIZE];
+		TEST_CHECK(pinPage(bm, h, i));
+		sprintf(expected, "Page-%i", i);
+		ASSERT_EQUALS_STRING(expected, h->data, "page written back");
+		TEST_CHECK(unpinPage(bm, h));
+	}
+
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(destroyPageFile("testbuffer.bin"));
+	free(bm);
+	free(h);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testPrefetch (void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	BM_AccessRing *ring;
+	SM_FileHandle fh;
+	char expected[PAGE_SIZE];
+	int i;
+	testName = "Reading pages ahead";
+
+	// a file of 20 pages with a marker in each page
+	TEST_CHECK(createPageFile("testbuffer.bin"));
+	TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_FIFO, NULL));
+	for (i = 0; i < 20; i++)
+	{
+		TEST_CHECK(pinPage(bm, h, i));
+		sprintf(h->data, "Page-%i", i);
+		TEST_CHECK(markDirty(bm, h));
+		TEST_CHECK(unpinPage(bm, h));
+	}
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	// pages read ahead are pinned without reading them again
+	TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 8, RS_FIFO, NULL));
+	TEST_CHECK(prefetchPages(bm, 0, 5));
+	waitForReads(bm, 5);
+	ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0],[3 0],[4 0],[-1 0],[-1 0],[-1 0]", bm, "pages are read ahead");
+
+	// pages behind the end of the file are skipped, the queue is served in order
+	TEST_CHECK(prefetchPages(bm, 30, 2));
+	TEST_CHECK(prefetchPages(bm, 5, 1));
+	waitForReads(bm, 6);
+	for (i = 0; i < 6; i++)
+	{
+		TEST_CHECK(pinPage(bm, h, i));
+		sprintf(expected, "Page-%i", i);
+		ASSERT_EQUALS_STRING(expected, h->data, "page read ahead");
+		TEST_CHECK(unpinPage(bm, h));
+	}
+	ASSERT_EQUALS_INT(6, getNumReadIO(bm), "pins of pages read ahead do not read");
+	TEST_CHECK(openPageFile("testbuffer.bin", &fh));
+	ASSERT_EQUALS_INT(20, fh.totalNumPages, "read-ahead does not grow the file");
+	TEST_CHECK(closePageFile(&fh));
+
+	// a ring takes over the frames of pages read ahead for it
+	ring = createAccessRing(bm, 2);
+	TEST_CHECK(prefetchPages(bm, 10, 4));
+	waitForReads(bm, 10);
+	for (i = 10; i < 14; i++)
+	{
+		TEST_CHECK(pinPageWithRing(bm, ring, h, i));
+		sprintf(expected, "Page-%i", i);
+		ASSERT_EQUALS_STRING(expected, h->data, "page read ahead for the ring");
+		TEST_CHECK(unpinPage(bm, h));
+	}
+	ASSERT_EQUALS_INT(10, getNumReadIO(bm), "ring pins of pages read ahead do not read");
+	TEST_CHECK(pinPageWithRing(bm, ring, h, 14));
+	TEST_CHECK(unpinPage(bm, h));
+	ASSERT_EQUALS_POOL("[14 0],[13 0],[2 0],[3 0],[4 0],[5 0],[10 0],[11 0]", bm, "ring recycles its oldest frame");
+
+	freeAccessRing(ring);
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(destroyPageFile("testbuffer.bin"));
+	free(bm);
+	free(h);
+	TEST_DONE();
+}
+
+// ************************************************************
+#define TRANSFER_PAGES 100
+
+void
+testBatchedTransfers (void)
+{
+	SM_FileHandle fh;
+	SM_IORequest requests[TRANSFER_PAGES + 1];
+	char *pages = malloc(TRANSFER_PAGES * PAGE_SIZE);
+	char *registered = malloc(TRANSFER_PAGES / 2 * PAGE_SIZE);
+	char expected[PAGE_SIZE];
+	int i, numCompleted = 0;
+	testName = "Batched block transfers";
+
+	TEST_CHECK(createPageFile("testbuffer.bin"));
+	TEST_CHECK(openPageFile("testbuffer.bin", &fh));
+	TEST_CHECK(ensureCapacity(TRANSFER_PAGES, &fh));
+
+	// write all pages with one batch, more than fit into the submission queue at once
+	for (i = 0; i < TRANSFER_PAGES; i++)
+	{
+		sprintf(pages + i * PAGE_SIZE, "Page-%i", i);
+		requests[i].pageNum = i;
+		requests[i].memPage = pages + i * PAGE_SIZE;
+		requests[i].isWrite = 1;
+		requests[i].callback = countTransfer;
+		requests[i].context = &numCompleted;
+	}
+	TEST_CHECK(transferBlocks(&fh, requests, TRANSFER_PAGES));
+	ASSERT_EQUALS_INT(TRANSFER_PAGES, numCompleted, "every write completes");
+
+	// read them back, half of them into registered memory, plus a page behind the end of the file
+	registerBlockBuffers(&fh, registered, TRANSFER_PAGES / 2 * PAGE_SIZE);
+	memset(pages, 0, TRANSFER_PAGES * PAGE_SIZE);
+	for (i = 0; i <= TRANSFER_PAGES; i++)
+	{
+		requests[i].pageNum = i;
+		requests[i].memPage = (i < TRANSFER_PAGES / 2) ? registered + i * PAGE_SIZE : pages + (i % TRANSFER_PAGES) * PAGE_SIZE;
+		requests[i].isWrite = 0;
+		requests[i].callback = (i % 2 == 0) ? countTransfer : NULL;
+		requests[i].context = &numCompleted;
+	}
+	numCompleted = 0;
+	TEST_CHECK(transferBlocks(&fh, requests, TRANSFER_PAGES + 1));
+	ASSERT_EQUALS_INT(TRANSFER_PAGES / 2 + 1, numCompleted, "callbacks are called for their requests");
+	ASSERT_EQUALS_INT(RC_READ_NON_EXISTING_PAGE, requests[TRANSFER_PAGES].rc, "page behind the end of the file");
+	for (i = 0; i < TRANSFER_PAGES; i++)
+	{
+		sprintf(expected, "Page-%i", i);
+		ASSERT_EQUALS_INT(RC_OK, requests[i].rc, "read succeeds");
+		ASSERT_EQUALS_STRING(expected, requests[i].memPage, "page read back");
+	}
+	ASSERT_EQUALS_INT(TRANSFER_PAGES, fh.totalNumPages, "transfers do not grow the file");
+
+	TEST_CHECK(closePageFile(&fh));
+	TEST_CHECK(destroyPageFile("testbuffer.bin"));
+	free(pages);
+	free(registered);
+	TEST_DONE();
+}
+
+// ************************************************************
+// A page whose log cannot be flushed is not written, and stays dirty in its frame
+void
+testFailedLogFlush (void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	int logFails = 1;
+	testName = "Pages stay dirty when the log flush fails";
+
+	TEST_CHECK(createPageFile("testbuffer.bin"));
+	TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 1, RS_LRU, NULL));
+	TEST_CHECK(setWriteAheadLog(bm, flushTestLog, &logFails));
+
+	TEST_CHECK(pinPage(bm, h, 0));
+	sprintf(h->data, "%s", "Page-0");
+	TEST_CHECK(setPageLSN(bm, h, 5));
+	TEST_CHECK(markDirty(bm, h));
+	TEST_CHECK(unpinPage(bm, h));
+
+	// neither forcing the page nor evicting it writes it while the log cannot be flushed
+	ASSERT_TRUE(forcePage(bm, h) != RC_OK, "forcePage fails");
+	ASSERT_TRUE(forceFlushPool(bm) != RC_OK, "forceFlushPool fails");
+	ASSERT_TRUE(pinPage(bm, h, 1) != RC_OK, "a pin that has to evict the page fails");
+	ASSERT_EQUALS_INT(1, countDirtyPages(bm), "the page stays dirty");
+	ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "nothing was written");
+
+	// once the log can be flushed, the page is written on eviction and read back whole
+	logFails = 0;
+	pinAndUnpin(bm, h, 1);
+	ASSERT_EQUALS_INT(1, getNumWriteIO(bm), "the evicted page is written");
+	TEST_CHECK(pinPage(bm, h, 0));
+	ASSERT_EQUALS_STRING("Page-0", h->data, "the change survives the failed flushes");
+	TEST_CHECK(unpinPage(bm, h));
+
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(destroyPageFile("testbuffer.bin"));
+
+	free(bm);
+	free(h);
+	TEST_DONE();
+}
+
+// Log hook that fails while the flag it is given is set
+RC
+flushTestLog (void *log, long lsn)
+{
+	(void) lsn;
+	return *(int *) log ? RC_WRITE_FAILED : RC_OK;
+}
+
+void
+countTransfer (SM_IORequest *request)
+{
+	(*(int *) request->context)++;
+}
+
+// Increment the counter at the start of random pages under an exclusive latch
+void *
+incrementPages (void *arg)
+{
+	PoolWorker *w = (PoolWorker *) arg;
+	BM_PageHandle h;
+	int i, counter;
+
+	for (i = 0; i < SHARDED_POOL_INCREMENTS; i++)
+	{
+		if (pinPage(w->bm, &h, rand_r(&w->seed) % SHARDED_POOL_PAGES) != RC_OK)
+		{
+			w->errors++;
+			continue;
+		}
+		latchPage(w->bm, &h, TRUE);
+		memcpy(&counter, h.data, sizeof(int));
+		counter++;
+		memcpy(h.data, &counter, sizeof(int));
+		unlatchPage(w->bm, &h);
+		if (markDirty(w->bm, &h) != RC_OK || unpinPage(w->bm, &h) != RC_OK)
+			w->errors++;
+	}
+	return NULL;
+}
+
+int
+countDirtyPages (BM_BufferPool *bm)
+{
+	bool *dirty = getDirtyFlags(bm);
+	int i, count = 0;
+
+	for (i = 0; i < bm->numPages; i++)
+		count += dirty[i] ? 1 : 0;
+	free(dirty);
+	return count;
+}
+
+// Wait until the pool has read a number of pages, for at most two seconds
+void
+waitForReads (BM_BufferPool *bm, int numReadIO)
+{
+	int wait;
+
+	for (wait = 0; wait < 1000 && getNumReadIO(bm) < numReadIO; wait++)
+		usleep(2000);
+}
+
+void
+pinAndUnpin (BM_BufferPool *bm, BM_PageHandle *h, PageNumber pageNum)
+{
+	TEST_CHECK(pinPage(bm, h, pageNum));
+	TEST_CHECK(unpinPage(bm, h));
+}
@@ -29,6 +29,8 @@
 static void testValueSerialize (void);
 static void testOperators (void);
 static void testExpressions (void);
+static void testCompiledExpressions (void);
+static void testFilterKernels (void);
 
 char *testName;
 
@@ -41,6 +43,8 @@ main (void)
 	testValueSerialize();
 	testOperators();
 	testExpressions();
+	testCompiledExpressions();
+	testFilterKernels();
 
 	return 0;
 }
@@ -123,3 +127,173 @@ testExpressions (void)
 
 	TEST_DONE();
 }
+
+// ************************************************************
+static Schema *
+compiledTestSchema (void)
+{
+	char **names = (char **) malloc(sizeof(char*) * 3);
+	DataType *dt = (DataType *) malloc(sizeof(DataType) * 3);
+	int *sizes = (int *) malloc(sizeof(int) * 3);
+	int *keys = (int *) malloc(sizeof(int));
+
+	names[0] = "a"; names[1] = "b"; names[2] = "c";
+	dt[0] = DT_INT; dt[1] = DT_STRING; dt[2] = DT_FLOAT;
+	sizes[0] = 0; sizes[1] = 4; sizes[2] = 0;
+	keys[0] = 0;
+
+	return createSchema(3, names, dt, sizes, 1, keys);
+}
+
+// check that the compiled expression gives the same result as evalExpr
+#define ASSERT_COMPILED_SAME(expr, record, schema, message)		\
+		do {									\
+			ExprProgram *_prog;							\
+			Value *_res;								\
+			TEST_CHECK(compileExpr(expr, schema, &_prog));			\
+			evalExpr(record, schema, expr, &_res);				\
+			ASSERT_EQUALS_INT((int) _res->v.boolV, (int) evalProgram(_prog, (record)->data), message); \
+			freeVal(_res);							\
+			freeProgram(_prog);							\
+		} while (0)
+
+void
+testCompiledExpressions (void)
+{
+	Schema *schema = compiledTestSchema();
+	Record *r;
+	Expr *attrA, *attrB, *attrC, *cons, *cmpA, *cmpB, *cmpC, *and, *not, *op;
+	ExprProgram *prog;
+	char *strings[] = { "aaaa", "abcd", "ab\0\0", "b\0\0\0" };
+	int i;
+	testName = "test compiled expressions";
+
+	TEST_CHECK(createRecord(&r, schema));
+
+	MAKE_ATTRREF(attrA, 0);
+	MAKE_CONS(cons, stringToValue("i5"));
+	MAKE_BINOP_EXPR(cmpA, attrA, cons, OP_COMP_SMALLER);
+
+	MAKE_ATTRREF(attrB, 1);
+	MAKE_CONS(cons, stringToValue("sabcd"));
+	MAKE_BINOP_EXPR(cmpB, cons, attrB, OP_COMP_EQUAL);
+
+	MAKE_ATTRREF(attrC, 2);
+	MAKE_CONS(cons, stringToValue("f2.5"));
+	MAKE_BINOP_EXPR(cmpC, attrC, cons, OP_COMP_SMALLER);
+
+	for (i = 0; i < 8; i++)
+	{
+		Value *val;
+		float f = i * 0.75;
+
+		MAKE_VALUE(val, DT_INT, i);
+		setAttr(r, schema, 0, val);
+		freeVal(val);
+		memcpy(r->data + getAttributeOffset(schema, 1), strings[i % 4], 4);
+		MAKE_VALUE(val, DT_FLOAT, f);
+		setAttr(r, schema, 2, val);
+		freeVal(val);
+
+		ASSERT_COMPILED_SAME(cmpA, r, schema, "a < 5");
+		ASSERT_COMPILED_SAME(cmpB, r, schema, "'abcd' = b");
+		ASSERT_COMPILED_SAME(cmpC, r, schema, "c < 2.5");
+	}
+
+	// boolean operators over the comparisons
+	MAKE_BINOP_EXPR(and, cmpA, cmpC, OP_BOOL_AND);
+	MAKE_UNOP_EXPR(not, and, OP_BOOL_NOT);
+	MAKE_BINOP_EXPR(op, not, cmpB, OP_BOOL_OR);
+	for (i = 0; i < 8; i++)
+	{
+		Value *val;
+		MAKE_VALUE(val, DT_INT, i);
+		setAttr(r, schema, 0, val);
+		freeVal(val);
+		memcpy(r->data + getAttributeOffset(schema, 1), strings[i % 4], 4);
+
+		ASSERT_COMPILED_SAME(op, r, schema, "NOT (a < 5 AND c < 2.5) OR 'abcd' = b");
+	}
+
+	// type errors are reported when compiling
+	MAKE_CONS(cons, stringToValue("i1"));
+	MAKE_BINOP_EXPR(op, attrB, cons, OP_COMP_EQUAL);
+	ASSERT_EQUALS_INT(RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE, compileExpr(op, schema, &prog), "compare string with int");
+	ASSERT_EQUALS_INT(RC_RM_EXPR_RESULT_IS_NOT_BOOLEAN, compileExpr(attrA, schema, &prog), "condition is not boolean");
+
+	freeRecord(r);
+	TEST_DONE();
+}
+
+// ************************************************************ 
+void
+testFilterKernels (void)
+{
+	Schema *schema = compiledTestSchema();
+	int recordSize = getRecordSize(schema);
+	int numTuples = 203, i, j, isa;
+	char *tuples = (char *) calloc(numTuples, recordSize);
+	uint64_t selection[4];
+	Expr *conds[6], *attr, *cons;
+	char *names[] = { "a = 3", "a < 0", "0 < a", "c = 1.5", "c < 1.5", "1.5 < c" };
+	ExprProgram *prog;
+
+	testName = "test vectorized filter kernels";
+
+	for (i = 0; i < numTuples; i++)
+	{
+		int a = i % 11 - 5;
+		float c = (i % 7) * 0.5;
+		memcpy(tuples + i * recordSize + getAttributeOffset(schema, 0), &a, sizeof(int));
+		memcpy(tuples + i * recordSize + getAttributeOffset(schema, 2), &c, sizeof(float));
+	}
+
+	MAKE_ATTRREF(attr, 0);
+	MAKE_CONS(cons, stringToValue("i3"));
+	MAKE_BINOP_EXPR(conds[0], attr, cons, OP_COMP_EQUAL);
+	MAKE_ATTRREF(attr, 0);
+	MAKE_CONS(cons, stringToValue("i0"));
+	MAKE_BINOP_EXPR(conds[1], attr, cons, OP_COMP_SMALLER);
+	MAKE_ATTRREF(attr, 0);
+	MAKE_CONS(cons, stringToValue("i0"));
+	MAKE_BINOP_EXPR(conds[2], cons, attr, OP_COMP_SMALLER);
+	MAKE_ATTRREF(attr, 2);
+	MAKE_CONS(cons, stringToValue("f1.5"));
+	MAKE_BINOP_EXPR(conds[3], attr, cons, OP_COMP_EQUAL);
+	MAKE_ATTRREF(attr, 2);
+	MAKE_CONS(cons, stringToValue("f1.5"));
+	MAKE_BINOP_EXPR(conds[4], attr, cons, OP_COMP_SMALLER);
+	MAKE_ATTRREF(attr, 2);
+	MAKE_CONS(cons, stringToValue("f1.5"));
+	MAKE_BINOP_EXPR(conds[5], cons, attr, OP_COMP_SMALLER);
+
+	// every kernel selects exactly the tuples the program accepts
+	for (isa = EXPR_KERNEL_SCALAR; isa <= EXPR_KERNEL_AVX2; isa++)
+	{
+		selectFilterKernels(isa);
+		for (j = 0; j < 6; j++)
+		{
+			int mismatches = 0;
+			TEST_CHECK(compileExpr(conds[j], schema, &prog));
+			ASSERT_TRUE(filterProgram(prog, tuples, recordSize, numTuples, selection), names[j]);
+			for (i = 0; i < numTuples; i++)
+				if ((bool) ((selection[i / 64] >> (i % 64)) & 1) != evalProgram(prog, tuples + i * recordSize))
+					mismatches++;
+			ASSERT_TRUE((selection[numTuples / 64] >> (numTuples % 64)) == 0, "no bits after the last tuple");
+			ASSERT_EQUALS_INT(0, mismatches, names[j]);
+			freeProgram(prog);
+		}
+	}
+	selectFilterKernels(EXPR_KERNEL_AVX2);
+
+	// string comparisons have no filter
+	MAKE_ATTRREF(attr, 1);
+	MAKE_CONS(cons, stringToValue("sabcd"));
+	MAKE_BINOP_EXPR(conds[0], attr, cons, OP_COMP_EQUAL);
+	TEST_CHECK(compileExpr(conds[0], schema, &prog));
+	ASSERT_TRUE(!filterProgram(prog, tuples, recordSize, numTuples, selection), "no filter for strings");
+	freeProgram(prog);
+
+	free(tuples);
+	TEST_DONE();
+}
@@ -0,0 +1,157 @@
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "record_mgr.h"
+#include "hash_mgr.h"
+#include "dberror.h"
+#include "test_helper.h"
+
+// var to store the current test's name
+char *testName;
+
+// test and helper methods
+static void testInsertFindDelete (void);
+static void testStringKeys (void);
+static Schema *keySchema (DataType keyType, int keyLength);
+
+// main method
+int
+main (void)
+{
+	initStorageManager();
+	testName = "";
+
+	testInsertFindDelete();
+	testStringKeys();
+
+	return 0;
+}
+
+// ************************************************************
+void
+testInsertFindDelete (void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	Schema *schema = keySchema(DT_INT, 0);
+	HashHandle *hash;
+	PageNumber headerPage;
+	int numKeys = 50000, numPages = 1, i, k, num;
+	RID rid;
+	testName = "inserting, finding, and deleting keys with bucket splits";
+
+	TEST_CHECK(createPageFile("testhash.bin"));
+	TEST_CHECK(initBufferPool(bm, "testhash.bin", 8, RS_LRU, NULL));
+	TEST_CHECK(createHash(bm, &numPages, schema, &headerPage));
+	TEST_CHECK(openHash(&hash, bm, &numPages, schema, headerPage));
+
+	// the RID of key k is (k, -k)
+	for (i = 0; i < numKeys; i++)
+	{
+		RID r = { i, -i };
+		TEST_CHECK(insertHashKey(hash, (char *) &i, r));
+	}
+	getNumHashEntries(hash, &num);
+	ASSERT_EQUALS_INT(numKeys, num, "all keys are in the index");
+	getNumBuckets(hash, &num);
+	ASSERT_TRUE(num > numKeys / 400, "full buckets were split");
+	k = 42;
+	ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, insertHashKey(hash, (char *) &k, rid), "keys are unique");
+
+	for (i = 0; i < numKeys; i++)
+	{
+		TEST_CHECK(findHashKey(hash, (char *) &i, &rid));
+		if (rid.page != i || rid.slot != -i)
+			break;
+	}
+	ASSERT_EQUALS_INT(numKeys, i, "every key is found with its RID");
+	ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, findHashKey(hash, (char *) &numKeys, &rid), "missing key is not found");
+
+	// delete the even keys
+	for (i = 0; i < numKeys; i += 2)
+		TEST_CHECK(deleteHashKey(hash, (char *) &i));
+	k = 0;
+	ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, deleteHashKey(hash, (char *) &k), "deleted key is gone");
+	TEST_CHECK(closeHash(hash));
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	// the index survives flushing the buffer pool, including its directory
+	TEST_CHECK(initBufferPool(bm, "testhash.bin", 8, RS_LRU, NULL));
+	TEST_CHECK(openHash(&hash, bm, &numPages, schema, headerPage));
+	getNumHashEntries(hash, &num);
+	ASSERT_EQUALS_INT(numKeys / 2, num, "entries after reopening");
+	for (i = 0, k = 0; i < numKeys; i++)
+		if ((findHashKey(hash, (char *) &i, &rid) == RC_OK) == (i % 2 == 1))
+			k++;
+	ASSERT_EQUALS_INT(numKeys, k, "only the odd keys are found after reopening");
+	TEST_CHECK(closeHash(hash));
+
+	TEST_CHECK(deleteHash(bm, headerPage));
+	ASSERT_TRUE(openHash(&hash, bm, &numPages, schema, headerPage) != RC_OK, "deleted index cannot be opened");
+
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(destroyPageFile("testhash.bin"));
+	free(bm);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testStringKeys (void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	Schema *schema = keySchema(DT_STRING, 8);
+	HashHandle *hash;
+	PageNumber headerPage;
+	int numPages = 1;
+	char stored[8] = { 'a', 'b', 'c', '\0', 'x', 'y', 'z', 'w' };
+	char probe[8];
+	Value v;
+	Value *values[] = { &v };
+	RID rid = { 7, 3 };
+	testName = "string keys compare and hash up to their terminator";
+
+	TEST_CHECK(createPageFile("testhash.bin"));
+	TEST_CHECK(initBufferPool(bm, "testhash.bin", 4, RS_FIFO, NULL));
+	TEST_CHECK(createHash(bm, &numPages, schema, &headerPage));
+	TEST_CHECK(openHash(&hash, bm, &numPages, schema, headerPage));
+
+	// the bytes after the terminator of a stored string do not belong to the key
+	TEST_CHECK(insertHashKey(hash, stored, rid));
+	v.dt = DT_STRING;
+	v.v.stringV = "abc";
+	TEST_CHECK(valuesToKey(schema, values, probe));
+	TEST_CHECK(findHashKey(hash, probe, &rid));
+	ASSERT_EQUALS_INT(7, rid.page, "key found by value");
+	ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, insertHashKey(hash, probe, rid), "same string is the same key");
+
+	v.v.stringV = "abcd";
+	TEST_CHECK(valuesToKey(schema, values, probe));
+	ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, findHashKey(hash, probe, &rid), "longer string is another key");
+
+	TEST_CHECK(closeHash(hash));
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(destroyPageFile("testhash.bin"));
+	free(bm);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+Schema *
+keySchema (DataType keyType, int keyLength)
+{
+	char **names = (char **) malloc(sizeof(char*) * 2);
+	DataType *dt = (DataType *) malloc(sizeof(DataType) * 2);
+	int *sizes = (int *) malloc(sizeof(int) * 2);
+	int *keys = (int *) malloc(sizeof(int));
+
+	names[0] = "k";
+	names[1] = "v";
+	dt[0] = keyType;
+	dt[1] = DT_INT;
+	sizes[0] = keyLength;
+	sizes[1] = 0;
+	keys[0] = 0;
+
+	return createSchema(2, names, dt, sizes, 1, keys);
+}
@@ -0,0 +1,307 @@
+#include <pthread.h>
+#include "storage_mgr.h"
+#include "log_mgr.h"
+#include "dberror.h"
+#include "test_helper.h"
+
+// var to store the current test's name
+char *testName;
+
+// arguments of a committing thread
+typedef struct CommitWorker {
+	LogHandle *log;
+	long xid;
+	int numCommits;
+	int errors;
+} CommitWorker;
+
+// test and helper methods
+static void testAppendAndRead (void);
+static void testTornRecord (void);
+static void testGroupCommit (void);
+static void testTruncate (void);
+static void *commitWorker (void *arg);
+static void fillBody (char *body, int i, int size);
+static int checkRecords (LogHandle *log, int numRecords);
+
+// main method
+int
+main (void)
+{
+	initStorageManager();
+	testName = "";
+
+	testAppendAndRead();
+	testTornRecord();
+	testGroupCommit();
+	testTruncate();
+
+	return 0;
+}
+
+// ************************************************************
+void
+testAppendAndRead (void)
+{
+	LogHandle *log;
+	LogRecord *record;
+	LSN lsn, prev = NO_LSN, end, endBefore;
+	char body[300];
+	int numRecords = 1000, i, flushes;
+	testName = "appending and reading log records across pages";
+
+	TEST_CHECK(createLog("testlog.log"));
+	TEST_CHECK(openLog(&log, "testlog.log"));
+	getLogStart(log, &lsn);
+	getLogEnd(log, &end);
+	ASSERT_TRUE(lsn == end, "new log is empty");
+	ASSERT_EQUALS_INT(RC_LOG_NO_MORE_RECORDS, readLogRecord(log, lsn, &record), "nothing to read in an empty log");
+
+	// more records than the log buffer holds, so appending writes the buffer out
+	for (i = 0; i < numRecords; i++)
+	{
+		fillBody(body, i, i % 300);
+		TEST_CHECK(appendLogRecord(log, LOG_INSERT, i % 7, prev, body, i % 300, &lsn));
+		if (lsn <= prev)
+			break;
+		prev = lsn;
+	}
+	ASSERT_EQUALS_INT(numRecords, i, "LSNs grow with every record");
+	ASSERT_EQUALS_INT(numRecords, checkRecords(log, numRecords), "every record is read back, also from the buffer");
+
+	TEST_CHECK(flushLog(log, lsn));
+	getNumLogFlushes(log, &flushes);
+	TEST_CHECK(flushLog(log, lsn));
+	getNumLogFlushes(log, &i);
+	ASSERT_EQUALS_INT(flushes, i, "flushing a durable record does not write the log");
+	getLogEnd(log, &endBefore);
+	TEST_CHECK(closeLog(log));
+
+	// reopening finds the end behind the last record, new records follow it
+	TEST_CHECK(openLog(&log, "testlog.log"));
+	getLogEnd(log, &end);
+	ASSERT_TRUE(end == endBefore, "reopened log ends behind the last record");
+	ASSERT_EQUALS_INT(numRecords, checkRecords(log, numRecords), "every record is read back from the file");
+	TEST_CHECK(appendLogRecord(log, LOG_COMMIT, 1, prev, NULL, 0, &lsn));
+	ASSERT_TRUE(lsn == end, "next record is appended at the end");
+	TEST_CHECK(closeLog(log));
+
+	TEST_CHECK(openLog(&log, "testlog.log"));
+	TEST_CHECK(readLogRecord(log, end, &record));
+	ASSERT_EQUALS_INT(LOG_COMMIT, record->type, "appended record survives a reopen");
+	ASSERT_TRUE(record->prevLSN == prev, "record keeps its previous LSN");
+	free(record);
+	TEST_CHECK(closeLog(log));
+
+	TEST_CHECK(destroyPageFile("testlog.log"));
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testTornRecord (void)
+{
+	SM_FileHandle fh;
+	LogHandle *log;
+	LogRecord *record;
+	LSN first, lsn, end;
+	char body[100], page[PAGE_SIZE];
+	int i;
+	testName = "a torn record ends the log";
+
+	TEST_CHECK(createLog("testlog.log"));
+	TEST_CHECK(openLog(&log, "testlog.log"));
+	getLogStart(log, &first);
+	for (i = 0; i < 10; i++)
+	{
+		fillBody(body, i, 100);
+		TEST_CHECK(appendLogRecord(log, LOG_UPDATE, 1, NO_LSN, body, 100, &lsn));
+	}
+	TEST_CHECK(closeLog(log));
+
+	// damage the body of the last record, as a crash during its write would
+	TEST_CHECK(openPageFile("testlog.log", &fh));
+	TEST_CHECK(readBlock(1 + (lsn - first) / PAGE_SIZE, &fh, page));
+	page[(lsn - first) % PAGE_SIZE + sizeof(LogRecord) + 10] ^= 1;
+	TEST_CHECK(writeBlock(1 + (lsn - first) / PAGE_SIZE, &fh, page));
+	TEST_CHECK(closePageFile(&fh));
+
+	TEST_CHECK(openLog(&log, "testlog.log"));
+	getLogEnd(log, &end);
+	ASSERT_TRUE(end == lsn, "log ends before the torn record");
+	ASSERT_EQUALS_INT(RC_LOG_NO_MORE_RECORDS, readLogRecord(log, lsn, &record), "torn record is not read");
+	ASSERT_EQUALS_INT(9, checkRecords(log, 9), "records before it are intact");
+
+	// a shorter record replaces it, the rest of the torn record is not taken for another one
+	TEST_CHECK(appendLogRecord(log, LOG_COMMIT, 1, NO_LSN, NULL, 0, &lsn));
+	TEST_CHECK(closeLog(log));
+	TEST_CHECK(openLog(&log, "testlog.log"));
+	getLogEnd(log, &end);
+	ASSERT_TRUE(end == lsn + (LSN) sizeof(LogRecord), "log ends behind the new record");
+	TEST_CHECK(closeLog(log));
+
+	TEST_CHECK(destroyPageFile("testlog.log"));
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testGroupCommit (void)
+{
+	LogHandle *log;
+	LogRecord *record;
+	LSN lsn;
+	pthread_t threads[8];
+	CommitWorker workers[8];
+	int numThreads = 8, numCommits = 100, t, flushes, errors = 0, commits = 0;
+	testName = "concurrent commits share log flushes";
+
+	TEST_CHECK(createLog("testlog.log"));
+	TEST_CHECK(openLog(&log, "testlog.log"));
+
+	for (t = 0; t < numThreads; t++)
+	{
+		workers[t].log = log;
+		workers[t].xid = t + 1;
+		workers[t].numCommits = numCommits;
+		workers[t].errors = 0;
+		pthread_create(&threads[t], NULL, commitWorker, &workers[t]);
+	}
+	for (t = 0; t < numThreads; t++)
+	{
+		pthread_join(threads[t], NULL);
+		errors += workers[t].errors;
+	}
+	ASSERT_EQUALS_INT(0, errors, "no failed appends or flushes");
+
+	getNumLogFlushes(log, &flushes);
+	printf("%d commits with %d log flushes\n", numThreads * numCommits, flushes);
+	ASSERT_TRUE(flushes < numThreads * numCommits, "commits share log flushes");
+	TEST_CHECK(closeLog(log));
+
+	// every commit is in the log
+	TEST_CHECK(openLog(&log, "testlog.log"));
+	getLogStart(log, &lsn);
+	while (readLogRecord(log, lsn, &record) == RC_OK)
+	{
+		if (record->type == LOG_COMMIT)
+			commits++;
+		lsn += record->size;
+		free(record);
+	}
+	ASSERT_EQUALS_INT(numThreads * numCommits, commits, "every commit is durable");
+	TEST_CHECK(closeLog(log));
+
+	TEST_CHECK(destroyPageFile("testlog.log"));
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testTruncate (void)
+{
+	LogHandle *log;
+	LogRecord *record;
+	LSN lsns[1000], lsn, start, end, checkpoint;
+	char body[300];
+	int numRecords = 1000, i;
+	testName = "truncating the log keeps the LSNs of the records left";
+
+	TEST_CHECK(createLog("testlog.log"));
+	TEST_CHECK(openLog(&log, "testlog.log"));
+	getLogCheckpoint(log, &checkpoint);
+	ASSERT_TRUE(checkpoint == NO_LSN, "new log has no checkpoint");
+	for (i = 0; i < numRecords; i++)
+	{
+		fillBody(body, i, i % 300);
+		TEST_CHECK(appendLogRecord(log, LOG_INSERT, 1, NO_LSN, body, i % 300, &lsns[i]));
+	}
+
+	TEST_CHECK(flushLog(log, lsns[numRecords - 1]));
+	TEST_CHECK(setLogCheckpoint(log, lsns[600]));
+	TEST_CHECK(truncateLog(log, lsns[600]));
+	getLogStart(log, &start);
+	getLogEnd(log, &end);
+	ASSERT_TRUE(start == lsns[600], "log starts at the truncation point");
+	for (i = 600; i < numRecords && readLogRecord(log, lsns[i], &record) == RC_OK; i++)
+	{
+		fillBody(body, i, i % 300);
+		if (record->size != (int) sizeof(LogRecord) + i % 300 || memcmp(body, LOG_BODY(record), i % 300) != 0)
+		{
+			free(record);
+			break;
+		}
+		free(record);
+	}
+	ASSERT_EQUALS_INT(numRecords, i, "records behind the truncation point keep their LSNs");
+	TEST_CHECK(appendLogRecord(log, LOG_COMMIT, 1, lsns[numRecords - 1], NULL, 0, &lsn));
+	ASSERT_TRUE(lsn == end, "records are appended at the old end");
+	TEST_CHECK(closeLog(log));
+
+	TEST_CHECK(openLog(&log, "testlog.log"));
+	getLogStart(log, &lsn);
+	ASSERT_TRUE(lsn == start, "truncation survives a reopen");
+	getLogCheckpoint(log, &checkpoint);
+	ASSERT_TRUE(checkpoint == lsns[600], "checkpoint survives a reopen");
+	TEST_CHECK(readLogRecord(log, end, &record));
+	ASSERT_EQUALS_INT(LOG_COMMIT, record->type, "record appended after truncating survives a reopen");
+	free(record);
+	TEST_CHECK(closeLog(log));
+
+	TEST_CHECK(destroyPageFile("testlog.log"));
+	TEST_DONE();
+}
+
+// Log a change and a commit, and wait until the commit is durable
+void *
+commitWorker (void *arg)
+{
+	CommitWorker *w = (CommitWorker *) arg;
+	char body[64];
+	LSN lsn;
+	int i;
+
+	for (i = 0; i < w->numCommits; i++)
+	{
+		fillBody(body, i, 64);
+		if (appendLogRecord(w->log, LOG_INSERT, w->xid, NO_LSN, body, 64, &lsn) != RC_OK ||
+				appendLogRecord(w->log, LOG_COMMIT, w->xid, lsn, NULL, 0, &lsn) != RC_OK ||
+				flushLog(w->log, lsn) != RC_OK)
+			w->errors++;
+	}
+	return NULL;
+}
+
+// Body of the i-th test record
+void
+fillBody (char *body, int i, int size)
+{
+	int j;
+	for (j = 0; j < size; j++)
+		body[j] = (char) (i + j);
+}
+
+// Read the first records of the log and return how many match the ones appended by the tests
+int
+checkRecords (LogHandle *log, int numRecords)
+{
+	LogRecord *record;
+	LSN lsn;
+	char body[300];
+	int i, size;
+
+	getLogStart(log, &lsn);
+	for (i = 0; i < numRecords && readLogRecord(log, lsn, &record) == RC_OK; i++)
+	{
+		size = record->size - (int) sizeof(LogRecord);
+		fillBody(body, i, size);
+		if (memcmp(body, LOG_BODY(record), size) != 0 || (record->type == LOG_INSERT && size != i % 300))
+		{
+			free(record);
+			break;
+		}
+		lsn += record->size;
+		free(record);
+	}
+	return i;
+}